@@ -0,0 +1,1092 @@
+#include "bitPackUtils.h"
+
+/**
+ * This function loads a packed group into two 64 bit words, most significant bit first.
+ *
+ * Every group is bitWidth bytes holding 8 pixels, so a group of up to 16 bit pixels fits in 128 bits.
+ *
+ * @param packed The packed bytes of the group
+ * @param bitWidth The number of bits per pixel
+ * @param high Where to store the first 64 bits of the group
+ * @param low Where to store the rest of the group, starting at its most significant bit
+ */
+static inline void bpuLoadGroup(const unsigned char *packed, int bitWidth, unsigned long long *high, unsigned long long *low)
+{
+    *high = 0;
+    *low = 0;
+    for (int byteIndex = 0; byteIndex < bitWidth; byteIndex++)
+    { // The loop runs a constant number of times in every kernel, so it is unrolled
+        if (byteIndex < 8)
+        {
+            *high |= (unsigned long long)packed[byteIndex] << (56 - 8 * byteIndex);
+        }
+        else
+        {
+            *low |= (unsigned long long)packed[byteIndex] << (56 - 8 * (byteIndex - 8));
+        }
+    }
+}
+
+/**
+ * This function stores a group held in two 64 bit words, the reverse of bpuLoadGroup().
+ *
+ * @param packed The array to store the bitWidth bytes of the group in
+ * @param bitWidth The number of bits per pixel
+ * @param high The first 64 bits of the group
+ * @param low The rest of the group, starting at its most significant bit
+ */
+static inline void bpuStoreGroup(unsigned char *packed, int bitWidth, unsigned long long high, unsigned long long low)
+{
+    for (int byteIndex = 0; byteIndex < bitWidth; byteIndex++)
+    {
+        packed[byteIndex] = (unsigned char)((byteIndex < 8 ? high : low) >> (56 - 8 * (byteIndex & 7)));
+    }
+}
+
+// The pixel of a group that starts start bits in, taken from the two words made by bpuLoadGroup().
+// start and bitWidth are constants in every kernel, so this folds down to one or two constant shifts.
+#define BPU_FIELD(high, low, start, bitWidth) \
+    (((start) < 64 ? ((high) << ((start) & 63)) | ((low) >> 1 >> (63 - ((start) & 63))) : (low) << ((start) & 63)) >> (64 - (bitWidth)))
+
+// Puts a pixel into the two words of a group start bits in, the reverse of BPU_FIELD().
+#define BPU_PLACE(high, low, value, start, bitWidth)                                                                  \
+    do                                                                                                                \
+    {                                                                                                                 \
+        unsigned long long field = ((unsigned long long)(value) & ((1ull << (bitWidth)) - 1)) << (64 - (bitWidth)); \
+        if ((start) < 64)                                                                                             \
+        {                                                                                                             \
+            (high) |= field >> ((start) & 63);                                                                        \
+            (low) |= field << 1 << (63 - ((start) & 63));                                                             \
+        }                                                                                                             \
+        else                                                                                                          \
+        {                                                                                                             \
+            (low) |= field >> ((start) & 63);                                                                         \
+        }                                                                                                             \
+    } while (0)
+
+/**
+ * Defines the scalar group kernels of one bit width and value type.
+ *
+ * Every group is bitWidth bytes holding 8 values, the first value in the most significant bits.
+ * The 8 values are written out one by one so every shift is a constant.
+ *
+ * unpackName(packed, store, groups) unpacks groups whole groups from packed into store.
+ * packName(values, packed, groups) packs groups whole groups of values into packed.
+ */
+#define BPU_DEFINE_TYPED_KERNELS(unpackName, packName, Type, bitWidth)                         \
+    static void unpackName(const unsigned char *packed, Type *store, long groups)             \
+    {                                                                                         \
+        for (long group = 0; group < groups; group++)                                        \
+        {                                                                                     \
+            unsigned long long high;                                                          \
+            unsigned long long low;                                                           \
+            bpuLoadGroup(packed, bitWidth, &high, &low);                                      \
+            store[0] = (Type)BPU_FIELD(high, low, 0 * bitWidth, bitWidth);                    \
+            store[1] = (Type)BPU_FIELD(high, low, 1 * bitWidth, bitWidth);                    \
+            store[2] = (Type)BPU_FIELD(high, low, 2 * bitWidth, bitWidth);                    \
+            store[3] = (Type)BPU_FIELD(high, low, 3 * bitWidth, bitWidth);                    \
+            store[4] = (Type)BPU_FIELD(high, low, 4 * bitWidth, bitWidth);                    \
+            store[5] = (Type)BPU_FIELD(high, low, 5 * bitWidth, bitWidth);                    \
+            store[6] = (Type)BPU_FIELD(high, low, 6 * bitWidth, bitWidth);                    \
+            store[7] = (Type)BPU_FIELD(high, low, 7 * bitWidth, bitWidth);                    \
+            packed += bitWidth;                                                               \
+            store += BPU_GROUP_PIXELS;                                                        \
+        }                                                                                     \
+    }                                                                                         \
+    static void packName(const Type *values, unsigned char *packed, long groups)              \
+    {                                                                                         \
+        for (long group = 0; group < groups; group++)                                        \
+        {                                                                                     \
+            unsigned long long high = 0;                                                      \
+            unsigned long long low = 0;                                                       \
+            BPU_PLACE(high, low, values[0], 0 * bitWidth, bitWidth);                          \
+            BPU_PLACE(high, low, values[1], 1 * bitWidth, bitWidth);                          \
+            BPU_PLACE(high, low, values[2], 2 * bitWidth, bitWidth);                          \
+            BPU_PLACE(high, low, values[3], 3 * bitWidth, bitWidth);                          \
+            BPU_PLACE(high, low, values[4], 4 * bitWidth, bitWidth);                          \
+            BPU_PLACE(high, low, values[5], 5 * bitWidth, bitWidth);                          \
+            BPU_PLACE(high, low, values[6], 6 * bitWidth, bitWidth);                          \
+            BPU_PLACE(high, low, values[7], 7 * bitWidth, bitWidth);                          \
+            bpuStoreGroup(packed, bitWidth, high, low);                                       \
+            values += BPU_GROUP_PIXELS;                                                       \
+            packed += bitWidth;                                                               \
+        }                                                                                     \
+    }
+
+// The kernels of pixels, bpuUnpackN() and bpuPackN(), are only needed up to BPU_MAX_PIXEL_BITS
+#define BPU_DEFINE_KERNELS(bitWidth) BPU_DEFINE_TYPED_KERNELS(bpuUnpack##bitWidth, bpuPack##bitWidth, Pixel, bitWidth)
+// The kernels of paradigm block indices, bpuUnpackIndicesN() and bpuPackIndicesN(), go up to BPU_MAX_BIT_WIDTH
+#define BPU_DEFINE_INDEX_KERNELS(bitWidth) BPU_DEFINE_TYPED_KERNELS(bpuUnpackIndices##bitWidth, bpuPackIndices##bitWidth, EbIndex, bitWidth)
+
+BPU_DEFINE_KERNELS(1)
+BPU_DEFINE_KERNELS(2)
+BPU_DEFINE_KERNELS(3)
+BPU_DEFINE_KERNELS(4)
+BPU_DEFINE_KERNELS(5)
+BPU_DEFINE_KERNELS(6)
+BPU_DEFINE_KERNELS(7)
+BPU_DEFINE_KERNELS(8)
+
+BPU_DEFINE_INDEX_KERNELS(1)
+BPU_DEFINE_INDEX_KERNELS(2)
+BPU_DEFINE_INDEX_KERNELS(3)
+BPU_DEFINE_INDEX_KERNELS(4)
+BPU_DEFINE_INDEX_KERNELS(5)
+BPU_DEFINE_INDEX_KERNELS(6)
+BPU_DEFINE_INDEX_KERNELS(7)
+BPU_DEFINE_INDEX_KERNELS(8)
+BPU_DEFINE_INDEX_KERNELS(9)
+BPU_DEFINE_INDEX_KERNELS(10)
+BPU_DEFINE_INDEX_KERNELS(11)
+BPU_DEFINE_INDEX_KERNELS(12)
+BPU_DEFINE_INDEX_KERNELS(13)
+BPU_DEFINE_INDEX_KERNELS(14)
+BPU_DEFINE_INDEX_KERNELS(15)
+BPU_DEFINE_INDEX_KERNELS(16)
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BPU_X86 // Build the SSSE3 and AVX2 kernels, they are only used when the CPU reports support
+#include <immintrin.h>
+
+/**
+ * Constants for the vector unpackers.
+ *
+ * The spread control is a byte shuffle that gives pixel k of a group its own 16 bit lane holding the
+ * (big endian) two bytes it lies in; -128 leaves a byte zero where the pixel fits in one byte.
+ * The shift multipliers are 2^(16 - s), so an unsigned high multiply shifts lane k right by the s
+ * that lines the pixel up with bit 0.
+ */
+static const signed char bpuSpread5[16] = {-128, 0, 1, 0, -128, 1, 2, 1, 3, 2, -128, 3, 4, 3, -128, 4};
+static const signed char bpuSpread7[16] = {-128, 0, 1, 0, 2, 1, 3, 2, 4, 3, 5, 4, 6, 5, -128, 6};
+static const unsigned short bpuShift5[8] = {32, 1024, 128, 4096, 512, 64, 2048, 256};
+static const unsigned short bpuShift7[8] = {128, 16384, 8192, 4096, 2048, 1024, 512, 256};
+
+/**
+ * Constants for the vector packers.
+ *
+ * After merging, each 64 bit lane holds two groups as one little endian number; the gather control
+ * takes its low bytes most significant first, which is the order they go in the file.
+ */
+static const signed char bpuGather5[16] = {4, 3, 2, 1, 0, 12, 11, 10, 9, 8, -128, -128, -128, -128, -128, -128};
+static const signed char bpuGather7[16] = {6, 5, 4, 3, 2, 1, 0, 14, 13, 12, 11, 10, 9, 8, -128, -128};
+
+/**
+ * This function stores one group that has been unpacked into eight 16 bit lanes.
+ *
+ * @param store Where to store the 8 pixels
+ * @param lanes The unpacked pixels, one in every 16 bit lane
+ */
+__attribute__((target("ssse3"))) static inline void bpuStoreGroupSsse3(Pixel *store, __m128i lanes)
+{
+#ifdef EB_WIDE_PIXELS
+    _mm_storeu_si128((__m128i *)store, _mm_unpacklo_epi16(lanes, _mm_setzero_si128()));
+    _mm_storeu_si128((__m128i *)(store + 4), _mm_unpackhi_epi16(lanes, _mm_setzero_si128()));
+#else
+    _mm_storel_epi64((__m128i *)store, _mm_packus_epi16(lanes, lanes)); // Every lane fits in a byte
+#endif
+}
+
+/**
+ * This function loads 4 pixels into the four 32 bit lanes the vector packers work on.
+ *
+ * @param values The pixels to load
+ * @return A register holding one pixel in every 32 bit lane
+ */
+__attribute__((target("ssse3"))) static inline __m128i bpuLoadQuadSsse3(const Pixel *values)
+{
+#ifdef EB_WIDE_PIXELS
+    return _mm_loadu_si128((const __m128i *)values);
+#else
+    int quad; // The 4 pixels as one 32 bit load
+    memcpy(&quad, values, sizeof(quad));
+    __m128i zero = _mm_setzero_si128();
+    return _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(quad), zero), zero);
+#endif
+}
+
+/**
+ * This function unpacks whole groups of 5 or 7 bit pixels with SSSE3, 32 pixels per loop.
+ *
+ * Every group is shuffled into eight 16 bit lanes, shifted into place with one multiply and masked.
+ *
+ * @param packed The packed bytes, starting on a group boundary
+ * @param store The array to store the pixels in
+ * @param groups The number of groups to unpack
+ * @param bitWidth The number of bits per pixel (5 or 7)
+ */
+__attribute__((target("ssse3"))) static void bpuUnpackSsse3(const unsigned char *packed, Pixel *store, long groups, int bitWidth)
+{
+    __m128i spread = _mm_loadu_si128((const __m128i *)(bitWidth == 5 ? bpuSpread5 : bpuSpread7)); // Puts each pixel in its own lane
+    __m128i shift = _mm_loadu_si128((const __m128i *)(bitWidth == 5 ? bpuShift5 : bpuShift7));    // Lines each lane up with bit 0
+    __m128i mask = _mm_set1_epi16((short)((1 << bitWidth) - 1));                                // Clears the bits of the neighbouring pixels
+
+    long group = 0;
+    for (; (groups - group) * bitWidth >= 3 * bitWidth + 16; group += 4)
+    { // Every load reads 16 bytes, so stop while the last load of the loop still lies inside the groups
+        for (int part = 0; part < 4; part++)
+        {
+            __m128i lanes = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(packed + part * bitWidth)), spread);
+            lanes = _mm_and_si128(_mm_mulhi_epu16(lanes, shift), mask);
+            bpuStoreGroupSsse3(store + part * BPU_GROUP_PIXELS, lanes);
+        }
+        packed += 4 * bitWidth;
+        store += 4 * BPU_GROUP_PIXELS;
+    }
+
+    if (bitWidth == 5)
+    { // The scalar kernel finishes the groups near the end
+        bpuUnpack5(packed, store, groups - group);
+    }
+    else
+    {
+        bpuUnpack7(packed, store, groups - group);
+    }
+}
+
+/**
+ * This function unpacks whole groups of 5 or 7 bit pixels with AVX2, 32 pixels per loop.
+ *
+ * Works like bpuUnpackSsse3() with one group in each 128 bit half of the register.
+ *
+ * @param packed The packed bytes, starting on a group boundary
+ * @param store The array to store the pixels in
+ * @param groups The number of groups to unpack
+ * @param bitWidth The number of bits per pixel (5 or 7)
+ */
+__attribute__((target("avx2"))) static void bpuUnpackAvx2(const unsigned char *packed, Pixel *store, long groups, int bitWidth)
+{
+    __m256i spread = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)(bitWidth == 5 ? bpuSpread5 : bpuSpread7)));
+    __m256i shift = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)(bitWidth == 5 ? bpuShift5 : bpuShift7)));
+    __m256i mask = _mm256_set1_epi16((short)((1 << bitWidth) - 1));
+
+    long group = 0;
+    for (; (groups - group) * bitWidth >= 3 * bitWidth + 16; group += 4)
+    { // Same bound as the SSSE3 kernel
+        for (int part = 0; part < 2; part++)
+        {
+            const unsigned char *pair = packed + part * 2 * bitWidth; // The two groups of this half of the loop
+            __m256i lanes = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)pair)),
+                                                    _mm_loadu_si128((const __m128i *)(pair + bitWidth)), 1);
+            lanes = _mm256_and_si256(_mm256_mulhi_epu16(_mm256_shuffle_epi8(lanes, spread), shift), mask);
+            Pixel *target = store + part * 2 * BPU_GROUP_PIXELS;
+#ifdef EB_WIDE_PIXELS
+            _mm256_storeu_si256((__m256i *)target, _mm256_cvtepu16_epi32(_mm256_castsi256_si128(lanes)));
+            _mm256_storeu_si256((__m256i *)(target + BPU_GROUP_PIXELS), _mm256_cvtepu16_epi32(_mm256_extracti128_si256(lanes, 1)));
+#else
+            lanes = _mm256_packus_epi16(lanes, lanes); // Every lane fits in a byte, the packing stays within each half
+            _mm_storel_epi64((__m128i *)target, _mm256_castsi256_si128(lanes));
+            _mm_storel_epi64((__m128i *)(target + BPU_GROUP_PIXELS), _mm256_extracti128_si256(lanes, 1));
+#endif
+        }
+        packed += 4 * bitWidth;
+        store += 4 * BPU_GROUP_PIXELS;
+    }
+
+    if (bitWidth == 5)
+    { // The scalar kernel finishes the groups near the end
+        bpuUnpack5(packed, store, groups - group);
+    }
+    else
+    {
+        bpuUnpack7(packed, store, groups - group);
+    }
+}
+
+/**
+ * This function merges neighbouring 64 bit lanes of two registers: (low << shift) | high.
+ *
+ * @param first The register holding the earlier pixels of each pair of lanes
+ * @param second The register holding the later pixels of each pair of lanes
+ * @param shift How many bits the later pixels take up
+ * @return A register holding first[0] merged with first[1] and second[0] merged with second[1]
+ */
+__attribute__((target("ssse3"))) static inline __m128i bpuMergeSsse3(__m128i first, __m128i second, __m128i shift)
+{
+    return _mm_or_si128(_mm_sll_epi64(_mm_unpacklo_epi64(first, second), shift), _mm_unpackhi_epi64(first, second));
+}
+
+/**
+ * This function packs whole groups of 5 or 7 bit pixels with SSSE3, 32 pixels per loop.
+ *
+ * Pixels are merged pairwise into 64 bit lanes (2, 4 and then 8 pixels per lane) and the
+ * bytes of each lane are shuffled into file order.
+ *
+ * @param values The pixels to pack
+ * @param packed The array to store the packed bytes in
+ * @param groups The number of groups to pack
+ * @param bitWidth The number of bits per pixel (5 or 7)
+ */
+__attribute__((target("ssse3"))) static void bpuPackSsse3(const Pixel *values, unsigned char *packed, long groups, int bitWidth)
+{
+    __m128i gather = _mm_loadu_si128((const __m128i *)(bitWidth == 5 ? bpuGather5 : bpuGather7)); // Puts the bytes in file order
+    __m128i mask = _mm_set1_epi32((1 << bitWidth) - 1);                                         // Clears bits above the pixel width
+    __m128i lowHalf = _mm_set_epi32(0, -1, 0, -1);                                              // Keeps the earlier pixel of each pair
+    __m128i shift1 = _mm_cvtsi32_si128(bitWidth);
+    __m128i shift2 = _mm_cvtsi32_si128(2 * bitWidth);
+    __m128i shift4 = _mm_cvtsi32_si128(4 * bitWidth);
+    unsigned char bytes[16]; // The shuffled bytes, of which the first 2 * bitWidth are stored
+
+    long group = 0;
+    for (; groups - group >= 4; group += 4)
+    {
+        for (int part = 0; part < 2; part++)
+        {
+            __m128i pairs[4]; // Pixels 4k to 4k + 3 merged into two lanes of two pixels
+            for (int k = 0; k < 4; k++)
+            {
+                __m128i pixels = _mm_and_si128(bpuLoadQuadSsse3(values + 4 * k), mask);
+                pairs[k] = _mm_or_si128(_mm_sll_epi64(_mm_and_si128(pixels, lowHalf), shift1), _mm_srli_epi64(pixels, 32));
+            }
+            __m128i lanes = bpuMergeSsse3(bpuMergeSsse3(pairs[0], pairs[1], shift2), bpuMergeSsse3(pairs[2], pairs[3], shift2), shift4);
+            _mm_storeu_si128((__m128i *)bytes, _mm_shuffle_epi8(lanes, gather));
+            memcpy(packed, bytes, 2 * bitWidth);
+            values += 2 * BPU_GROUP_PIXELS;
+            packed += 2 * bitWidth;
+        }
+    }
+
+    if (bitWidth == 5)
+    { // The scalar kernel packs the groups left over
+        bpuPack5(values, packed, groups - group);
+    }
+    else
+    {
+        bpuPack7(values, packed, groups - group);
+    }
+}
+
+/**
+ * This function merges neighbouring 64 bit lanes of two registers, see bpuMergeSsse3().
+ *
+ * @param first The register holding the earlier pixels of each pair of lanes
+ * @param second The register holding the later pixels of each pair of lanes
+ * @param shift How many bits the later pixels take up
+ * @return The merged register
+ */
+__attribute__((target("avx2"))) static inline __m256i bpuMergeAvx2(__m256i first, __m256i second, __m128i shift)
+{
+    return _mm256_or_si256(_mm256_sll_epi64(_mm256_unpacklo_epi64(first, second), shift), _mm256_unpackhi_epi64(first, second));
+}
+
+/**
+ * This function loads 8 pixels into the eight 32 bit lanes the AVX2 packer works on.
+ *
+ * @param values The pixels to load
+ * @return A register holding one pixel in every 32 bit lane
+ */
+__attribute__((target("avx2"))) static inline __m256i bpuLoadOctAvx2(const Pixel *values)
+{
+#ifdef EB_WIDE_PIXELS
+    return _mm256_loadu_si256((const __m256i *)values);
+#else
+    return _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)values));
+#endif
+}
+
+/**
+ * This function packs whole groups of 5 or 7 bit pixels with AVX2, 32 pixels per loop.
+ *
+ * Works like bpuPackSsse3() with pixels 0-15 in the low half of the registers and 16-31 in the high half.
+ *
+ * @param values The pixels to pack
+ * @param packed The array to store the packed bytes in
+ * @param groups The number of groups to pack
+ * @param bitWidth The number of bits per pixel (5 or 7)
+ */
+__attribute__((target("avx2"))) static void bpuPackAvx2(const Pixel *values, unsigned char *packed, long groups, int bitWidth)
+{
+    __m256i gather = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)(bitWidth == 5 ? bpuGather5 : bpuGather7)));
+    __m256i mask = _mm256_set1_epi32((1 << bitWidth) - 1);
+    __m256i lowHalf = _mm256_set_epi32(0, -1, 0, -1, 0, -1, 0, -1);
+    __m128i shift1 = _mm_cvtsi32_si128(bitWidth);
+    __m128i shift2 = _mm_cvtsi32_si128(2 * bitWidth);
+    __m128i shift4 = _mm_cvtsi32_si128(4 * bitWidth);
+    unsigned char bytes[32]; // The shuffled bytes, 2 * bitWidth from each half are stored
+
+    long group = 0;
+    for (; groups - group >= 4; group += 4)
+    {
+        __m256i first = _mm256_and_si256(bpuLoadOctAvx2(values), mask);       // Pixels 0-7
+        __m256i second = _mm256_and_si256(bpuLoadOctAvx2(values + 8), mask);  // Pixels 8-15
+        __m256i third = _mm256_and_si256(bpuLoadOctAvx2(values + 16), mask);  // Pixels 16-23
+        __m256i fourth = _mm256_and_si256(bpuLoadOctAvx2(values + 24), mask);
+        __m256i quads[4] = {_mm256_permute2x128_si256(first, third, 0x20), _mm256_permute2x128_si256(first, third, 0x31),
+                            _mm256_permute2x128_si256(second, fourth, 0x20), _mm256_permute2x128_si256(second, fourth, 0x31)}; // Pixels 4k to 4k + 3 and 16 + 4k to 16 + 4k + 3
+        for (int k = 0; k < 4; k++)
+        {
+            quads[k] = _mm256_or_si256(_mm256_sll_epi64(_mm256_and_si256(quads[k], lowHalf), shift1), _mm256_srli_epi64(quads[k], 32));
+        }
+        __m256i lanes = bpuMergeAvx2(bpuMergeAvx2(quads[0], quads[1], shift2), bpuMergeAvx2(quads[2], quads[3], shift2), shift4);
+        _mm256_storeu_si256((__m256i *)bytes, _mm256_shuffle_epi8(lanes, gather));
+        memcpy(packed, bytes, 2 * bitWidth);
+        memcpy(packed + 2 * bitWidth, bytes + 16, 2 * bitWidth);
+        values += 4 * BPU_GROUP_PIXELS;
+        packed += 4 * bitWidth;
+    }
+
+    if (bitWidth == 5)
+    { // The scalar kernel packs the groups left over
+        bpuPack5(values, packed, groups - group);
+    }
+    else
+    {
+        bpuPack7(values, packed, groups - group);
+    }
+}
+
+static void bpuUnpack5Ssse3(const unsigned char *packed, Pixel *store, long groups) { bpuUnpackSsse3(packed, store, groups, 5); }
+static void bpuUnpack7Ssse3(const unsigned char *packed, Pixel *store, long groups) { bpuUnpackSsse3(packed, store, groups, 7); }
+static void bpuUnpack5Avx2(const unsigned char *packed, Pixel *store, long groups) { bpuUnpackAvx2(packed, store, groups, 5); }
+static void bpuUnpack7Avx2(const unsigned char *packed, Pixel *store, long groups) { bpuUnpackAvx2(packed, store, groups, 7); }
+static void bpuPack5Ssse3(const Pixel *values, unsigned char *packed, long groups) { bpuPackSsse3(values, packed, groups, 5); }
+static void bpuPack7Ssse3(const Pixel *values, unsigned char *packed, long groups) { bpuPackSsse3(values, packed, groups, 7); }
+static void bpuPack5Avx2(const Pixel *values, unsigned char *packed, long groups) { bpuPackAvx2(values, packed, groups, 5); }
+static void bpuPack7Avx2(const Pixel *values, unsigned char *packed, long groups) { bpuPackAvx2(values, packed, groups, 7); }
+#endif
+
+// The group kernels in use for every pixel bit width, bpuSelectKernels() swaps in the widest vector ones the CPU supports
+static void (*bpuUnpackKernel[BPU_MAX_PIXEL_BITS + 1])(const unsigned char *packed, Pixel *store, long groups) = {
+    NULL, bpuUnpack1, bpuUnpack2, bpuUnpack3, bpuUnpack4, bpuUnpack5, bpuUnpack6, bpuUnpack7, bpuUnpack8};
+static void (*bpuPackKernel[BPU_MAX_PIXEL_BITS + 1])(const Pixel *values, unsigned char *packed, long groups) = {
+    NULL, bpuPack1, bpuPack2, bpuPack3, bpuPack4, bpuPack5, bpuPack6, bpuPack7, bpuPack8};
+
+// The group kernels of paradigm block indices for every bit width, indices are a ninth of the data so they stay scalar
+static void (*const bpuUnpackIndexKernel[BPU_MAX_BIT_WIDTH + 1])(const unsigned char *packed, EbIndex *store, long groups) = {
+    NULL, bpuUnpackIndices1, bpuUnpackIndices2, bpuUnpackIndices3, bpuUnpackIndices4, bpuUnpackIndices5, bpuUnpackIndices6,
+    bpuUnpackIndices7, bpuUnpackIndices8, bpuUnpackIndices9, bpuUnpackIndices10, bpuUnpackIndices11, bpuUnpackIndices12,
+    bpuUnpackIndices13, bpuUnpackIndices14, bpuUnpackIndices15, bpuUnpackIndices16};
+static void (*const bpuPackIndexKernel[BPU_MAX_BIT_WIDTH + 1])(const EbIndex *values, unsigned char *packed, long groups) = {
+    NULL, bpuPackIndices1, bpuPackIndices2, bpuPackIndices3, bpuPackIndices4, bpuPackIndices5, bpuPackIndices6,
+    bpuPackIndices7, bpuPackIndices8, bpuPackIndices9, bpuPackIndices10, bpuPackIndices11, bpuPackIndices12,
+    bpuPackIndices13, bpuPackIndices14, bpuPackIndices15, bpuPackIndices16};
+
+/**
+ * This function finds the widest kernels the CPU the program is running on supports.
+ *
+ * SSE2 has no byte shuffle, so CPUs without SSSE3 get the scalar kernels.
+ *
+ * @return BPU_TIER_AVX2, BPU_TIER_SSSE3 or BPU_TIER_SCALAR
+ */
+static int bpuBestTier(void)
+{
+#ifdef BPU_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return BPU_TIER_AVX2;
+    }
+    if (__builtin_cpu_supports("ssse3"))
+    {
+        return BPU_TIER_SSSE3;
+    }
+#endif
+    return BPU_TIER_SCALAR;
+}
+
+/**
+ * This function puts the group kernels of a tier in place.
+ *
+ * There are vector kernels for 5 and 7 bits, every other width always uses the scalar kernels.
+ *
+ * @param tier The tier to use, one the CPU supports
+ */
+static void bpuSetKernels(int tier)
+{
+    bpuUnpackKernel[5] = bpuUnpack5;
+    bpuUnpackKernel[7] = bpuUnpack7;
+    bpuPackKernel[5] = bpuPack5;
+    bpuPackKernel[7] = bpuPack7;
+#ifdef BPU_X86
+    if (tier == BPU_TIER_AVX2)
+    {
+        bpuUnpackKernel[5] = bpuUnpack5Avx2;
+        bpuUnpackKernel[7] = bpuUnpack7Avx2;
+        bpuPackKernel[5] = bpuPack5Avx2;
+        bpuPackKernel[7] = bpuPack7Avx2;
+    }
+    else if (tier == BPU_TIER_SSSE3)
+    {
+        bpuUnpackKernel[5] = bpuUnpack5Ssse3;
+        bpuUnpackKernel[7] = bpuUnpack7Ssse3;
+        bpuPackKernel[5] = bpuPack5Ssse3;
+        bpuPackKernel[7] = bpuPack7Ssse3;
+    }
+#else
+    (void)tier; // Only the scalar kernels are built
+#endif
+}
+
+/**
+ * This function picks the group kernels for the CPU the program is running on, AVX2 is preferred, then SSSE3.
+ */
+static void bpuPickKernels(void)
+{
+    bpuSetKernels(bpuBestTier());
+}
+
+/**
+ * This function picks the group kernels the first time a reader or writer is set up, however many threads do so at the same time.
+ */
+static void bpuSelectKernels(void)
+{
+    static pthread_once_t selected = PTHREAD_ONCE_INIT; // Whether the kernels have already been picked
+    pthread_once(&selected, bpuPickKernels);
+}
+
+/**
+ * This function makes every reader and writer use the group kernels of one tier, so that tests can check each of them.
+ *
+ * It must not be called while another thread is reading or writing.
+ *
+ * @param tier BPU_TIER_SCALAR, BPU_TIER_SSSE3 or BPU_TIER_AVX2
+ * @return 0 on success; BAD_ARGS if the CPU does not support the tier
+ */
+int bpuUseKernels(int tier)
+{
+    bpuSelectKernels(); // Pick first, so the kernels are not picked again over the ones set here
+    if (tier < BPU_TIER_SCALAR || tier > bpuBestTier())
+    {
+        return BAD_ARGS;
+    }
+    bpuSetKernels(tier);
+    return SUCCESS;
+}
+
+/**
+ * This function prepares a bit reader to read pixels from a file.
+ *
+ * The reader never reads more bytes than the pixels need, so the file can be read
+ * on from where the packed data ends.
+ *
+ * @param reader The reader to prepare
+ * @param fp The file pointer to read from, positioned at the first packed byte
+ * @param bitWidth The number of bits per pixel (1 to 16)
+ * @param pixelAmount The number of pixels that will be read
+ */
+void bpuReaderInit(BitReader *reader, FILE *fp, int bitWidth, long pixelAmount)
+{
+    reader->fp = fp;
+    reader->bytes = reader->buffer;
+    reader->bufferStart = 0;
+    reader->bufferEnd = 0;
+    reader->bytesLeft = (pixelAmount * bitWidth + 7) / 8; // The packed data is padded to a whole byte
+    reader->accumulator = 0;
+    reader->bitsInAccumulator = 0;
+    reader->bitWidth = bitWidth;
+    bpuSelectKernels();
+}
+
+/**
+ * This function prepares a bit reader to read pixels straight from bytes in memory, such as a mapped file.
+ *
+ * @param reader The reader to prepare
+ * @param bytes The first packed byte
+ * @param byteAmount The number of bytes that can be read from bytes onwards
+ * @param bitWidth The number of bits per pixel (1 to 16)
+ * @param pixelAmount The number of pixels that will be read
+ */
+void bpuReaderInitMemory(BitReader *reader, const unsigned char *bytes, long byteAmount, int bitWidth, long pixelAmount)
+{
+    bpuReaderInit(reader, NULL, bitWidth, pixelAmount);
+    reader->bytes = bytes;
+    reader->bufferEnd = byteAmount < reader->bytesLeft ? byteAmount : reader->bytesLeft; // Never read past the packed data
+    reader->bytesLeft = 0;
+}
+
+/**
+ * This function moves the undecoded bytes to the front of the buffer and tops it up from the file.
+ *
+ * @param reader The reader to refill
+ * @return The number of undecoded bytes in the buffer after the refill
+ */
+static long bpuReaderFill(BitReader *reader)
+{
+    if (reader->fp == NULL)
+    { // A reader over memory holds all of its bytes from the start
+        return reader->bufferEnd - reader->bufferStart;
+    }
+
+    long remaining = reader->bufferEnd - reader->bufferStart; // Bytes that have not been decoded yet
+    memmove(reader->buffer, reader->buffer + reader->bufferStart, remaining);
+    reader->bufferStart = 0;
+    reader->bufferEnd = remaining;
+
+    long toRead = BPU_BUFFER_SIZE - remaining; // Read as much as fits in the buffer
+    if (toRead > reader->bytesLeft)
+    { // But never past the end of the packed data
+        toRead = reader->bytesLeft;
+    }
+    if (toRead > 0)
+    {
+        long bytesRead = (long)fread(reader->buffer + remaining, 1, toRead, reader->fp);
+        reader->bufferEnd += bytesRead;
+        reader->bytesLeft -= bytesRead;
+        if (bytesRead != toRead)
+        { // The file ended early, no further read can succeed
+            reader->bytesLeft = 0;
+        }
+    }
+    return reader->bufferEnd - reader->bufferStart;
+}
+
+/**
+ * This function reads a single value through the accumulator.
+ *
+ * @param reader The reader to read from
+ * @param value Where to store the value
+ * @return 0 on success; BAD_DATA if the file ran out of data
+ */
+static int bpuReadValue(BitReader *reader, unsigned int *value)
+{
+    while (reader->bitsInAccumulator < reader->bitWidth)
+    { // The accumulator does not hold a whole pixel, take the next byte
+        if (reader->bufferStart == reader->bufferEnd && bpuReaderFill(reader) == 0)
+        {
+            return BAD_DATA; // There are no bytes left to take
+        }
+        reader->accumulator = (reader->accumulator << 8) | reader->bytes[reader->bufferStart++];
+        reader->bitsInAccumulator += 8;
+    }
+    reader->bitsInAccumulator -= reader->bitWidth;
+    *value = (unsigned int)(reader->accumulator >> reader->bitsInAccumulator) & ((1u << reader->bitWidth) - 1);
+    return SUCCESS;
+}
+
+/**
+ * This function reads the next count values of the stream into pixels or into paradigm block indices.
+ *
+ * Values are decoded one at a time until the stream is on a group boundary, then whole
+ * groups are decoded straight from the buffer and any remainder is decoded one at a time again.
+ * Successive calls carry on from where the last one stopped, so a 2D array can be read row by row.
+ *
+ * @param reader The reader to read from
+ * @param pixels The array to store pixels in, NULL when reading indices
+ * @param indices The array to store indices in, NULL when reading pixels
+ * @param count The number of values to read
+ * @return 0 on success; BAD_DATA if the file ran out of data
+ */
+static int bpuReadValues(BitReader *reader, Pixel *pixels, EbIndex *indices, int count)
+{
+    unsigned int value; // A value read on its own
+    int pixelIndex = 0; // The number of values read so far
+    while (pixelIndex < count && reader->bitsInAccumulator != 0)
+    { // Read single values until the accumulator is empty, which is when the stream is on a group boundary
+        if (bpuReadValue(reader, &value) != SUCCESS)
+        {
+            return BAD_DATA;
+        }
+        if (pixels != NULL)
+        {
+            pixels[pixelIndex++] = (Pixel)value;
+        }
+        else
+        {
+            indices[pixelIndex++] = (EbIndex)value;
+        }
+    }
+
+    while ((pixels == NULL || reader->bitWidth <= BPU_MAX_PIXEL_BITS) && count - pixelIndex >= BPU_GROUP_PIXELS)
+    { // Read whole groups straight from the buffer
+        long available = reader->bufferEnd - reader->bufferStart; // The bytes ready to be decoded
+        if (available < reader->bitWidth)
+        {
+            available = bpuReaderFill(reader);
+            if (available < reader->bitWidth)
+            { // Not a whole group left in the file, let the single pixel reads report it
+                break;
+            }
+        }
+        long groups = (count - pixelIndex) / BPU_GROUP_PIXELS; // The groups that are wanted
+        if (groups > available / reader->bitWidth)
+        { // Limit to the groups that are in the buffer
+            groups = available / reader->bitWidth;
+        }
+        if (pixels != NULL)
+        {
+            bpuUnpackKernel[reader->bitWidth](reader->bytes + reader->bufferStart, pixels + pixelIndex, groups);
+        }
+        else
+        {
+            bpuUnpackIndexKernel[reader->bitWidth](reader->bytes + reader->bufferStart, indices + pixelIndex, groups);
+        }
+        reader->bufferStart += groups * reader->bitWidth;
+        pixelIndex += groups * BPU_GROUP_PIXELS;
+    }
+
+    while (pixelIndex < count)
+    { // Read the values that do not make a whole group
+        if (bpuReadValue(reader, &value) != SUCCESS)
+        {
+            return BAD_DATA;
+        }
+        if (pixels != NULL)
+        {
+            pixels[pixelIndex++] = (Pixel)value;
+        }
+        else
+        {
+            indices[pixelIndex++] = (EbIndex)value;
+        }
+    }
+    return SUCCESS;
+}
+
+/**
+ * This function reads the next count pixels of the stream, see bpuReadValues().
+ *
+ * @param reader The reader to read from, at most BPU_MAX_PIXEL_BITS bits per pixel
+ * @param store The array to store the pixels in
+ * @param count The number of pixels to read
+ * @return 0 on success; BAD_DATA if the file ran out of data
+ */
+int bpuReadPixels(BitReader *reader, Pixel *store, int count)
+{
+    return bpuReadValues(reader, store, NULL, count);
+}
+
+/**
+ * This function reads the next count paradigm block indices of the stream, see bpuReadValues().
+ *
+ * @param reader The reader to read from
+ * @param store The array to store the indices in
+ * @param count The number of indices to read
+ * @return 0 on success; BAD_DATA if the file ran out of data
+ */
+int bpuReadIndices(BitReader *reader, EbIndex *store, int count)
+{
+    return bpuReadValues(reader, NULL, store, count);
+}
+
+/**
+ * This function prepares a bit writer to write pixels to a file.
+ *
+ * @param writer The writer to prepare
+ * @param fp The file pointer to write to
+ * @param bitWidth The number of bits per pixel (1 to 16)
+ */
+void bpuWriterInit(BitWriter *writer, FILE *fp, int bitWidth)
+{
+    writer->fp = fp;
+    writer->bytes = writer->buffer;
+    writer->bufferEnd = 0;
+    writer->byteCapacity = BPU_BUFFER_SIZE;
+    writer->accumulator = 0;
+    writer->bitsInAccumulator = 0;
+    writer->bitWidth = bitWidth;
+    bpuSelectKernels();
+}
+
+/**
+ * This function prepares a bit writer to pack pixels straight into memory.
+ *
+ * The memory is never emptied, so it has to hold every byte that will be written. Packing starts on a
+ * byte boundary, and bpuWriterFlush() pads the last byte without writing anything anywhere else.
+ *
+ * @param writer The writer to prepare
+ * @param bytes The memory to pack into
+ * @param byteAmount The number of bytes of memory
+ * @param bitWidth The number of bits per pixel (1 to 16)
+ */
+void bpuWriterInitMemory(BitWriter *writer, unsigned char *bytes, long byteAmount, int bitWidth)
+{
+    bpuWriterInit(writer, NULL, bitWidth);
+    writer->bytes = bytes;
+    writer->byteCapacity = byteAmount;
+}
+
+/**
+ * This function writes the buffered bytes to the file.
+ *
+ * @param writer The writer to empty
+ * @return 0 on success; BAD_OUTPUT if the file cannot be written to
+ */
+static int bpuWriterDrain(BitWriter *writer)
+{
+    if (writer->fp == NULL)
+    { // Memory cannot be emptied, it is only drained when it is full
+        return BAD_OUTPUT;
+    }
+    if (writer->bufferEnd > 0 && fwrite(writer->buffer, 1, writer->bufferEnd, writer->fp) != (size_t)writer->bufferEnd)
+    { // Check for write errors
+        return BAD_OUTPUT;
+    }
+    writer->bufferEnd = 0;
+    return SUCCESS;
+}
+
+/**
+ * This function writes a single value through the accumulator.
+ *
+ * @param writer The writer to write to
+ * @param value The value to write
+ * @return 0 on success; BAD_OUTPUT if the file cannot be written to
+ */
+static int bpuWriteValue(BitWriter *writer, unsigned int value)
+{
+    writer->accumulator = (writer->accumulator << writer->bitWidth) | (value & ((1u << writer->bitWidth) - 1));
+    writer->bitsInAccumulator += writer->bitWidth;
+    while (writer->bitsInAccumulator >= 8)
+    { // A whole byte is ready
+        if (writer->bufferEnd == writer->byteCapacity && bpuWriterDrain(writer) != SUCCESS)
+        {
+            return BAD_OUTPUT;
+        }
+        writer->bitsInAccumulator -= 8;
+        writer->bytes[writer->bufferEnd++] = (unsigned char)(writer->accumulator >> writer->bitsInAccumulator);
+    }
+    return SUCCESS;
+}
+
+/**
+ * This function writes count pixels or count paradigm block indices to the stream.
+ *
+ * Works like bpuReadValues() in reverse, so a 2D array can be written row by row.
+ * bpuWriterFlush() must be called after the last value.
+ *
+ * @param writer The writer to write to
+ * @param pixels The pixels to write, NULL when writing indices
+ * @param indices The indices to write, NULL when writing pixels
+ * @param count The number of values to write
+ * @return 0 on success; BAD_OUTPUT if the file cannot be written to
+ */
+static int bpuWriteValues(BitWriter *writer, const Pixel *pixels, const EbIndex *indices, int count)
+{
+    int pixelIndex = 0; // The number of values written so far
+    while (pixelIndex < count && writer->bitsInAccumulator != 0)
+    { // Write single values until the stream is on a group boundary
+        if (bpuWriteValue(writer, pixels != NULL ? pixels[pixelIndex] : indices[pixelIndex]) != SUCCESS)
+        {
+            return BAD_OUTPUT;
+        }
+        pixelIndex++;
+    }
+
+    while ((pixels == NULL || writer->bitWidth <= BPU_MAX_PIXEL_BITS) && count - pixelIndex >= BPU_GROUP_PIXELS)
+    { // Write whole groups straight into the buffer
+        long space = writer->byteCapacity - writer->bufferEnd; // The bytes free in the buffer
+        if (space < writer->bitWidth)
+        {
+            if (bpuWriterDrain(writer) != SUCCESS)
+            {
+                return BAD_OUTPUT;
+            }
+            space = writer->byteCapacity;
+        }
+        long groups = (count - pixelIndex) / BPU_GROUP_PIXELS; // The groups that are left
+        if (groups > space / writer->bitWidth)
+        { // Limit to the groups that fit in the buffer
+            groups = space / writer->bitWidth;
+        }
+        if (pixels != NULL)
+        {
+            bpuPackKernel[writer->bitWidth](pixels + pixelIndex, writer->bytes + writer->bufferEnd, groups);
+        }
+        else
+        {
+            bpuPackIndexKernel[writer->bitWidth](indices + pixelIndex, writer->bytes + writer->bufferEnd, groups);
+        }
+        writer->bufferEnd += groups * writer->bitWidth;
+        pixelIndex += groups * BPU_GROUP_PIXELS;
+    }
+
+    while (pixelIndex < count)
+    { // Write the values that do not make a whole group
+        if (bpuWriteValue(writer, pixels != NULL ? pixels[pixelIndex] : indices[pixelIndex]) != SUCCESS)
+        {
+            return BAD_OUTPUT;
+        }
+        pixelIndex++;
+    }
+    return SUCCESS;
+}
+
+/**
+ * This function writes count pixels to the stream, see bpuWriteValues().
+ *
+ * @param writer The writer to write to, at most BPU_MAX_PIXEL_BITS bits per pixel
+ * @param values The pixels to write
+ * @param count The number of pixels to write
+ * @return 0 on success; BAD_OUTPUT if the file cannot be written to
+ */
+int bpuWritePixels(BitWriter *writer, Pixel *values, int count)
+{
+    return bpuWriteValues(writer, values, NULL, count);
+}
+
+/**
+ * This function writes count paradigm block indices to the stream, see bpuWriteValues().
+ *
+ * @param writer The writer to write to
+ * @param values The indices to write
+ * @param count The number of indices to write
+ * @return 0 on success; BAD_OUTPUT if the file cannot be written to
+ */
+int bpuWriteIndices(BitWriter *writer, EbIndex *values, int count)
+{
+    return bpuWriteValues(writer, NULL, values, count);
+}
+
+/**
+ * This function packs a row in which every pixel is repeated, without building the repeated row first.
+ *
+ * The packed row starts on a byte boundary and a partly filled last byte is padded with zero bits,
+ * so it can be handed to bpuWriteBits() as many times as needed.
+ *
+ * @param values The pixels to pack
+ * @param count The number of pixels in values
+ * @param repeat How many times every pixel is repeated, at most 8
+ * @param bitWidth The number of bits per pixel (5 or 7)
+ * @param packed The array to store the packed bytes in, at least (count * repeat * bitWidth + 7) / 8 bytes
+ * @return The number of bits in the packed row
+ */
+long bpuPackRepeated(const Pixel *values, int count, int repeat, int bitWidth, unsigned char *packed)
+{
+    unsigned long long spread = 0; // Multiplying a pixel by this repeats it repeat times
+    for (int repeatIndex = 0; repeatIndex < repeat; repeatIndex++)
+    {
+        spread = (spread << bitWidth) | 1;
+    }
+    int runBits = repeat * bitWidth;               // The number of bits in one repeated pixel
+    unsigned int mask = (1u << bitWidth) - 1;      // Keeps only the bits of a pixel
+    unsigned long long accumulator = 0;            // Bits that do not fill a whole byte yet
+    int bitsInAccumulator = 0;                     // How many of the low bits of the accumulator are valid
+    long byteIndex = 0;                            // The number of bytes packed so far
+    for (int pixelIndex = 0; pixelIndex < count; pixelIndex++)
+    {
+        accumulator = (accumulator << runBits) | ((values[pixelIndex] & mask) * spread);
+        bitsInAccumulator += runBits;
+        while (bitsInAccumulator >= 8)
+        { // Take out every whole byte
+            bitsInAccumulator -= 8;
+            packed[byteIndex++] = (unsigned char)(accumulator >> bitsInAccumulator);
+        }
+    }
+    if (bitsInAccumulator > 0)
+    { // Pad the last bits out to a whole byte
+        packed[byteIndex] = (unsigned char)(accumulator << (8 - bitsInAccumulator));
+    }
+    return (long)count * runBits;
+}
+
+/**
+ * This function packs a row made of fragments that are already packed, picked out by a list of indices.
+ *
+ * The fragments are joined 32 bits at a time with no branch on their contents. As with bpuPackRepeated(),
+ * the packed row starts on a byte boundary and a partly filled last byte is padded with zero bits.
+ *
+ * @param fragments The fragments, each in the low fragmentBits bits
+ * @param indices The index of the fragment that goes in every place of the row
+ * @param count The number of fragments in the row
+ * @param fragmentBits The number of bits in every fragment, at most 32
+ * @param packed The array to store the packed bytes in, at least (count * fragmentBits + 7) / 8 + 4 bytes
+ * @return The number of bits in the packed row
+ */
+long bpuPackGathered(const uint32_t *fragments, const EbIndex *indices, int count, int fragmentBits, unsigned char *packed)
+{
+    unsigned long long accumulator = 0; // Bits that do not fill a whole word yet
+    int bitsInAccumulator = 0;          // How many of the low bits of the accumulator are valid, always below 32 between fragments
+    long byteIndex = 0;                 // The number of bytes packed so far
+    for (int fragmentIndex = 0; fragmentIndex < count; fragmentIndex++)
+    {
+        accumulator = (accumulator << fragmentBits) | fragments[indices[fragmentIndex]];
+        bitsInAccumulator += fragmentBits;
+        if (bitsInAccumulator >= 32)
+        { // Take out a whole word, most significant byte first
+            bitsInAccumulator -= 32;
+            uint32_t word = (uint32_t)(accumulator >> bitsInAccumulator);
+            packed[byteIndex] = (unsigned char)(word >> 24);
+            packed[byteIndex + 1] = (unsigned char)(word >> 16);
+            packed[byteIndex + 2] = (unsigned char)(word >> 8);
+            packed[byteIndex + 3] = (unsigned char)word;
+            byteIndex += 4;
+        }
+    }
+    while (bitsInAccumulator > 0)
+    { // Take out the last bytes, padding the last bits out to a whole byte
+        packed[byteIndex++] = (unsigned char)(bitsInAccumulator >= 8 ? accumulator >> (bitsInAccumulator - 8) : accumulator << (8 - bitsInAccumulator));
+        bitsInAccumulator -= 8;
+    }
+    return (long)count * fragmentBits;
+}
+
+/**
+ * This function writes bits that have already been packed, such as a row from bpuPackRepeated().
+ *
+ * When the stream is on a byte boundary the bytes are copied as they are, otherwise every byte
+ * is shifted through the accumulator to line up with the bits already written.
+ *
+ * @param writer The writer to write to
+ * @param bytes The packed bits, the first bit in the most significant bit of the first byte
+ * @param bitCount The number of bits to write
+ * @return 0 on success; BAD_OUTPUT if the file cannot be written to
+ */
+int bpuWriteBits(BitWriter *writer, const unsigned char *bytes, long bitCount)
+{
+    long byteAmount = bitCount / 8; // The whole bytes to write
+    long byteIndex = 0;             // The number of whole bytes written so far
+    while (byteIndex < byteAmount)
+    {
+        if (writer->bufferEnd == writer->byteCapacity && bpuWriterDrain(writer) != SUCCESS)
+        {
+            return BAD_OUTPUT;
+        }
+        long chunk = writer->byteCapacity - writer->bufferEnd; // The bytes free in the buffer
+        if (chunk > byteAmount - byteIndex)
+        {
+            chunk = byteAmount - byteIndex;
+        }
+        if (writer->bitsInAccumulator == 0)
+        { // On a byte boundary the bytes go in unchanged
+            memcpy(writer->bytes + writer->bufferEnd, bytes + byteIndex, chunk);
+        }
+        else
+        {
+            for (long chunkIndex = 0; chunkIndex < chunk; chunkIndex++)
+            { // Shift every byte past the bits that are already waiting
+                writer->accumulator = (writer->accumulator << 8) | bytes[byteIndex + chunkIndex];
+                writer->bytes[writer->bufferEnd + chunkIndex] = (unsigned char)(writer->accumulator >> writer->bitsInAccumulator);
+            }
+        }
+        writer->bufferEnd += chunk;
+        byteIndex += chunk;
+    }
+
+    int tailBits = (int)(bitCount % 8); // The bits left over in the last, partly used byte
+    if (tailBits > 0)
+    {
+        writer->accumulator = (writer->accumulator << tailBits) | (bytes[byteAmount] >> (8 - tailBits));
+        writer->bitsInAccumulator += tailBits;
+        if (writer->bitsInAccumulator >= 8)
+        { // A whole byte is ready
+            if (writer->bufferEnd == writer->byteCapacity && bpuWriterDrain(writer) != SUCCESS)
+            {
+                return BAD_OUTPUT;
+            }
+            writer->bitsInAccumulator -= 8;
+            writer->bytes[writer->bufferEnd++] = (unsigned char)(writer->accumulator >> writer->bitsInAccumulator);
+        }
+    }
+    return SUCCESS;
+}
+
+/**
+ * This function writes out everything the writer still holds.
+ *
+ * A partly filled last byte is padded with zero bits.
+ *
+ * @param writer The writer to flush
+ * @return 0 on success; BAD_OUTPUT if the file cannot be written to
+ */
+int bpuWriterFlush(BitWriter *writer)
+{
+    if (writer->bitsInAccumulator > 0)
+    { // Pad the last pixel bits out to a whole byte
+        if (writer->bufferEnd == writer->byteCapacity && bpuWriterDrain(writer) != SUCCESS)
+        {
+            return BAD_OUTPUT;
+        }
+        writer->bytes[writer->bufferEnd++] = (unsigned char)(writer->accumulator << (8 - writer->bitsInAccumulator));
+        writer->bitsInAccumulator = 0;
+    }
+    return writer->fp != NULL ? bpuWriterDrain(writer) : SUCCESS; // Memory holds the bytes where they are
+}
@@ -0,0 +1,55 @@
+#ifndef BITPACKUTILS_H
+#define BITPACKUTILS_H
+
+#include "ebUniversalUtils.h"
+#include <string.h>
+#include <pthread.h>
+
+#define BPU_BUFFER_SIZE 65536 // The number of packed bytes held between the codec and the file
+#define BPU_GROUP_PIXELS 8    // Every 8 pixels of any bit width end on a byte boundary
+#define BPU_MAX_BIT_WIDTH 16  // The widest values the packers handle, paradigm block indices go up to 12 bits
+#define BPU_MAX_PIXEL_BITS 8  // The widest values that are packed as pixels rather than as indices
+
+#define BPU_TIER_SCALAR 0 // The group kernels written in plain C
+#define BPU_TIER_SSSE3 1  // The SSSE3 group kernels for 5 and 7 bits
+#define BPU_TIER_AVX2 2   // The AVX2 group kernels for 5 and 7 bits
+
+typedef struct bitReader{
+    FILE *fp;                              // The file the packed bytes are read from, NULL when reading from memory
+    unsigned char buffer[BPU_BUFFER_SIZE]; // Packed bytes that have been read from the file but not decoded yet
+    const unsigned char *bytes;            // The bytes being decoded, the buffer or the memory being read from
+    long bufferStart;                      // Index of the next undecoded byte in bytes
+    long bufferEnd;                        // Index one past the last valid byte in bytes
+    long bytesLeft;                        // Packed bytes of this stream that have not been read from the file yet
+    unsigned long long accumulator;        // Bits taken from the buffer that have not been turned into pixels yet
+    int bitsInAccumulator;                 // How many of the low bits of the accumulator are valid
+    int bitWidth;                          // How many bits every pixel takes (1 to 16)
+} BitReader;
+
+typedef struct bitWriter{
+    FILE *fp;                              // The file the packed bytes are written to, NULL when writing to memory
+    unsigned char buffer[BPU_BUFFER_SIZE]; // Packed bytes that have not been written to the file yet
+    unsigned char *bytes;                  // The bytes being packed into, the buffer or the memory being written to
+    long bufferEnd;                        // Index one past the last valid byte in bytes
+    long byteCapacity;                     // The number of bytes that fit in bytes
+    unsigned long long accumulator;        // Bits of pixels that do not fill a whole byte yet
+    int bitsInAccumulator;                 // How many of the low bits of the accumulator are valid
+    int bitWidth;                          // How many bits every pixel takes (1 to 16)
+} BitWriter;
+
+// function prototypes
+void bpuReaderInit(BitReader *reader, FILE *fp, int bitWidth, long pixelAmount);
+void bpuReaderInitMemory(BitReader *reader, const unsigned char *bytes, long byteAmount, int bitWidth, long pixelAmount);
+int bpuReadPixels(BitReader *reader, Pixel *store, int count);
+int bpuReadIndices(BitReader *reader, EbIndex *store, int count);
+void bpuWriterInit(BitWriter *writer, FILE *fp, int bitWidth);
+void bpuWriterInitMemory(BitWriter *writer, unsigned char *bytes, long byteAmount, int bitWidth);
+int bpuWritePixels(BitWriter *writer, Pixel *values, int count);
+int bpuWriteIndices(BitWriter *writer, EbIndex *values, int count);
+long bpuPackRepeated(const Pixel *values, int count, int repeat, int bitWidth, unsigned char *packed);
+long bpuPackGathered(const uint32_t *fragments, const EbIndex *indices, int count, int fragmentBits, unsigned char *packed);
+int bpuWriteBits(BitWriter *writer, const unsigned char *bytes, long bitCount);
+int bpuWriterFlush(BitWriter *writer);
+int bpuUseKernels(int tier);
+
+#endif
@@ -1,5 +1,70 @@
 #include "blockUtils.h"
 
+/**
+ * This function allocates an array of blocks together with the pixels of every block.
+ *
+ * The blocks and their pixels share one allocation, so blockFreeArena() releases them all at once.
+ * Every block starts out as a standard BLOCK_WIDTH x BLOCK_HEIGHT block.
+ *
+ * @param blockAmount The number of blocks to allocate
+ * @return The array of blocks on success, NULL if memory allocation fails
+ */
+Block *blockCreateArena(int blockAmount)
+{
+    Block *block = (Block *)malloc((sizeof(Block) + BLOCK_SIZE * sizeof(Pixel)) * (size_t)blockAmount); // The blocks followed by their pixels
+    if (block == NULL)
+    {
+        return NULL; // Return if memory allocation failed
+    }
+
+    Pixel *pixels = (Pixel *)(block + blockAmount); // The pixels start after the last block
+    for (int currentBlockIndex = 0; currentBlockIndex < blockAmount; currentBlockIndex++)
+    { // Point every block at its own pixels
+        block[currentBlockIndex].width = BLOCK_WIDTH;
+        block[currentBlockIndex].height = BLOCK_HEIGHT;
+        block[currentBlockIndex].data = (Pixel(*)[BLOCK_WIDTH])(pixels + (size_t)currentBlockIndex * BLOCK_SIZE);
+    }
+    return block;
+}
+
+/**
+ * This function frees an array of blocks allocated with blockCreateArena().
+ *
+ * @param block The array of blocks to free
+ */
+void blockFreeArena(Block *block)
+{
+    free(block); // The pixels are part of the same allocation
+}
+
+/**
+ * This function makes an arena of blocks ready for another image, only allocating when the image needs more blocks than the arena has.
+ *
+ * Every block is reset to a standard BLOCK_WIDTH x BLOCK_HEIGHT block, its pixels are not cleared.
+ *
+ * @param block The arena to reuse, from blockCreateArena() or this function; NULL for none yet
+ * @param blockCapacity The number of blocks the arena has room for, updated when it grows
+ * @param blockAmount The number of blocks needed
+ * @return The arena, which may have moved; NULL if memory allocation fails, in which case the old arena has been freed
+ */
+Block *blockReuseArena(Block *block, int *blockCapacity, int blockAmount)
+{
+    if (block == NULL || blockAmount > *blockCapacity)
+    { // Too small, so start again with one that fits
+        blockFreeArena(block);
+        block = blockCreateArena(blockAmount);
+        *blockCapacity = block != NULL ? blockAmount : 0;
+        return block;
+    }
+
+    for (int currentBlockIndex = 0; currentBlockIndex < blockAmount; currentBlockIndex++)
+    { // The blocks still point at their own pixels, only their size may have changed
+        block[currentBlockIndex].width = BLOCK_WIDTH;
+        block[currentBlockIndex].height = BLOCK_HEIGHT;
+    }
+    return block;
+}
+
 /**
  * This function takes in an ebimage and a block array and fills the block array with the data from the image.
  * The normal block size is 3x3
@@ -8,11 +73,11 @@
  * @param block The block array to be filled
  * @param height The height of the image
  * @param width The width of the image
- * @return 0 on success, BAD_MALLOC if memory allocation fails
+ * @return 0 on success
  *
- * Note: The Block struct must be initialized with the correct amount of blocks before calling this function or else the behavior is undefined
+ * Note: The block array must be allocated with blockCreateArena() with the correct amount of blocks before calling this function or else the behavior is undefined
  */
-int blockerize(unsigned int **pixels, Block *block, int height, int width)
+int blockerize(Pixel **pixels, Block *block, int height, int width)
 {
     int currentBlockIndex = 0; // The current block index
     for (int imageY = 0; imageY < height; imageY = imageY + BLOCK_HEIGHT)
@@ -25,13 +90,8 @@ int blockerize(unsigned int **pixels, Block *block, int height, int width)
             int blockWidth = widthRemaining < BLOCK_WIDTH ? widthRemaining : BLOCK_WIDTH;      // If the width remaining is less than the block width, set the block width to the width remaining else set it to the block width constant
             int blockHeight = heightRemaining < BLOCK_HEIGHT ? heightRemaining : BLOCK_HEIGHT; // If the height remaining is less than the block height, set the block height to the height remaining else set it to the block height constant
 
-            block[currentBlockIndex].width = blockWidth;                              // Set the block width
-            block[currentBlockIndex].height = blockHeight;                            // Set the block height
-            block[currentBlockIndex].data = ebCreate2DArray(blockHeight, blockWidth); // Allocate the memory for the block data
-            if (block[currentBlockIndex].data == NULL)
-            {                      // Check if the memory allocation failed
-                return BAD_MALLOC; // Return if memory allocation failed
-            }
+            block[currentBlockIndex].width = blockWidth;   // Set the block width
+            block[currentBlockIndex].height = blockHeight; // Set the block height
 
             for (int blockY = 0; blockY < blockHeight; blockY++)
             { // Loop through the block and fill every element with the data from the image
@@ -57,7 +117,7 @@ int blockerize(unsigned int **pixels, Block *block, int height, int width)
  *
  * Note: The image struct must have the correct height and width values set before calling this function of else the behavior is undefined
  */
-int unblockerize(unsigned int **target, Block *block, int height, int width)
+int unblockerize(Pixel **target, Block *block, int height, int width)
 {
     int currentBlockIndex = 0;
     for (int imgY = 0; imgY < height; imgY = imgY + BLOCK_HEIGHT)
@@ -77,8 +137,22 @@ int unblockerize(unsigned int **target, Block *block, int height, int width)
     return SUCCESS;
 }
 
+/**
+ * This function divides the sum of a block by its pixel count, rounding halves up.
+ * Only integer arithmetic is used, so no pixel is ever converted to a double.
+ *
+ * @param sum The sum of the pixels of the block
+ * @param count The number of pixels in the block
+ * @return The rounded average of the block
+ */
+static int blockRoundedMean(int sum, int count)
+{
+    return (2 * sum + count) / (2 * count); // sum / count + 1/2, rounded down
+}
+
 /**
  * This function calculates the average value of a block
+ * Blocks smaller than the standard block size are averaged over the pixels they actually have
  *
  * @param block The block to be averaged
  * @return The average value of the block
@@ -93,7 +167,7 @@ int blockAverage(Block block)
             sum += block.data[blockY][blockX]; // Add the value of the current element to the sum
         }
     }
-    return round((double)sum / BLOCK_SIZE); // Return the average of the block
+    return blockRoundedMean(sum, block.height * block.width); // Return the average of the block
 }
 
 /**
@@ -134,40 +208,15 @@ double diffBlockSum(DiffBlock block)
     return sum; // Return the sum of the block
 }
 
-/**
- * This function calculates the difference between two blocks
- *
- * @param block1 The first block
- * @param block2 The second block
- * @return The difference between the two blocks
- */
-int blockDifference(Block block1, Block block2)
-{
-    if (block1.width != block2.width || block1.height != block2.height)
-    {                    // Check if the blocks are the same size
-        return BAD_DATA; // Return if the blocks are not the same size
-    }
-
-    int sum = 0; // The sum of the difference
-    for (int blockY = 0; blockY < block1.height; blockY++)
-    { // Loop through the blocks
-        for (int blockX = 0; blockX < block1.width; blockX++)
-        {
-            sum += abs(((int)block1.data[blockY][blockX]) - ((int)block2.data[blockY][blockX])); // Add the difference between the two blocks to the sum
-        }
-    }
-    return sum; // Return the sum of the difference
-}
-
 /**
  * This function takes in an ebimage and a block array and fills the block array with the data from the image.
  * However, unlike blockerize() this function forces all blocks to be the same size.
  *
  * @param image The image to be blocked
  * @param block The block array to be filled
- * @return 0 on success, BAD_MALLOC if memory allocation fails
+ * @return 0 on success
  * Note: The image struct must have the correct height and width values set before calling this function of else the behavior is undefined
- * Note: The block array must be large enough to hold all the blocks in the image
+ * Note: The block array must be allocated with blockCreateArena() and be large enough to hold all the blocks in the image
  */
 int uniformBlockerize(Image *image, Block *block)
 {
@@ -184,13 +233,8 @@ int uniformBlockerize(Image *image, Block *block)
                 break; // Break out of the loop if the block is smaller than the standard block size
             }
 
-            block[currentBlockIndex].height = BLOCK_HEIGHT;                             // Set the height of the block
-            block[currentBlockIndex].width = BLOCK_WIDTH;                               // Set the width of the block
-            block[currentBlockIndex].data = ebCreate2DArray(BLOCK_HEIGHT, BLOCK_WIDTH); // Allocate memory for the block
-            if (block[currentBlockIndex].data == NULL)
-            {
-                return BAD_MALLOC; // Return if memory allocation fails
-            }
+            block[currentBlockIndex].height = BLOCK_HEIGHT; // Set the height of the block
+            block[currentBlockIndex].width = BLOCK_WIDTH;   // Set the width of the block
 
             for (int blockY = 0; blockY < BLOCK_HEIGHT; blockY++)
             { // Loop through the block and fill every element with the data from the image
@@ -203,4 +247,48 @@ int uniformBlockerize(Image *image, Block *block)
         }
     }
     return SUCCESS;
-}
\ No newline at end of file
+}
+
+/**
+ * This function averages every block in a strip of image rows, giving one row of the block compressed image.
+ * Blocks at the right edge of the strip and strips at the bottom of the image may be smaller than a
+ * standard block, these are averaged over the pixels they actually have.
+ *
+ * @param strip The rows of the image that make up the strip
+ * @param stripHeight How many rows are in the strip, at most BLOCK_HEIGHT
+ * @param width The width of the image
+ * @param averages The array the averages are stored in, one for every BLOCK_WIDTH pixels of the width
+ */
+void blockAverageStrip(Pixel **strip, int stripHeight, int width, Pixel *averages)
+{
+    int imageX = 0; // The left edge of the current block
+    if (stripHeight == BLOCK_HEIGHT)
+    { // Full height strips sum the standard blocks straight from their three rows
+        const Pixel *top = strip[0];    // The top row of the strip
+        const Pixel *middle = strip[1]; // The middle row of the strip
+        const Pixel *bottom = strip[2]; // The bottom row of the strip
+        for (; imageX + BLOCK_WIDTH <= width; imageX = imageX + BLOCK_WIDTH)
+        { // Loop through the standard blocks of the strip
+            int sum = top[imageX] + top[imageX + 1] + top[imageX + 2] +
+                      middle[imageX] + middle[imageX + 1] + middle[imageX + 2] +
+                      bottom[imageX] + bottom[imageX + 1] + bottom[imageX + 2]; // The sum of the block
+            averages[imageX / BLOCK_WIDTH] = blockRoundedMean(sum, BLOCK_SIZE);  // Store the average of the block
+        }
+    }
+
+    for (; imageX < width; imageX = imageX + BLOCK_WIDTH)
+    { // Loop through the remaining blocks, which may be smaller than a standard block
+        int widthRemaining = width - imageX;                                          // The width remaining in the image
+        int blockWidth = widthRemaining < BLOCK_WIDTH ? widthRemaining : BLOCK_WIDTH; // The width of this block
+
+        int sum = 0; // The sum of the block
+        for (int blockY = 0; blockY < stripHeight; blockY++)
+        { // Loop through the block
+            for (int blockX = 0; blockX < blockWidth; blockX++)
+            {
+                sum += strip[blockY][imageX + blockX]; // Add the value of the current element to the sum
+            }
+        }
+        averages[imageX / BLOCK_WIDTH] = blockRoundedMean(sum, stripHeight * blockWidth); // Store the average of the block
+    }
+}
\ No newline at end of file
@@ -11,7 +11,7 @@
 typedef struct block{
     int width;
     int height;
-    unsigned int **data;
+    Pixel (*data)[BLOCK_WIDTH]; // The rows of the block, a view into the block arena
 } Block;
 
 typedef struct diffBlock{
@@ -21,12 +21,15 @@ typedef struct diffBlock{
 } DiffBlock;
 
 // function prototypes
-int blockerize(unsigned int ** pixels, Block * block, int height, int width);
+Block * blockCreateArena(int blockAmount);
+void blockFreeArena(Block * block);
+Block * blockReuseArena(Block * block, int * blockCapacity, int blockAmount);
+int blockerize(Pixel ** pixels, Block * block, int height, int width);
 int blockAverage(Block block);
-int unblockerize(unsigned int ** target, Block * block, int height, int width);
+int unblockerize(Pixel ** target, Block * block, int height, int width);
 int uniformBlockerize(Image * image, Block * block);
 double diffBlockAverage(DiffBlock block);
 double diffBlockSum(DiffBlock block);
-int blockDifference(Block block1, Block block2);
+void blockAverageStrip(Pixel ** strip, int stripHeight, int width, Pixel * averages);
 
 #endif
\ No newline at end of file
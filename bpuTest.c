@@ -0,0 +1,875 @@
+#include "bpuTest.h"
+
+static long bpuTestChecks = 0;                        // The number of comparisons made
+static long bpuTestFailures = 0;                      // The number of comparisons that failed
+static unsigned long long bpuTestState = 0x853c49e6748fea9bull; // The state of the random number generator, fixed so every run checks the same values
+static BitReader bpuTestReader;                       // Readers and writers hold a 64 KiB buffer, so they are kept off the stack
+static BitWriter bpuTestWriter;
+
+/**
+ * This function makes the next pseudo random number, with xorshift64*.
+ *
+ * @return A pseudo random number
+ */
+static unsigned int bpuTestRandom(void)
+{
+    bpuTestState ^= bpuTestState >> 12;
+    bpuTestState ^= bpuTestState << 25;
+    bpuTestState ^= bpuTestState >> 27;
+    return (unsigned int)((bpuTestState * 2685821657736338717ull) >> 32);
+}
+
+/**
+ * This function counts a comparison, printing it if it failed.
+ *
+ * @param passed Whether the comparison passed
+ * @param what What was compared
+ * @param tierName The kernels that were in use
+ * @param bitWidth The number of bits per value
+ * @param length The number of values
+ */
+static void bpuTestCheck(int passed, const char *what, const char *tierName, int bitWidth, long length)
+{
+    bpuTestChecks++;
+    if (!passed)
+    {
+        bpuTestFailures++;
+        if (bpuTestFailures <= 20)
+        { // Enough to see the pattern without flooding the output
+            printf("FAILED %s: %s kernels, %d bits, %ld values\n", what, tierName, bitWidth, length);
+        }
+    }
+}
+
+/**
+ * This function works out how many values the next call of a read or write pattern handles.
+ *
+ * Pattern 0 handles every value in one call, pattern 1 in rows of 1 to 13 values, so row boundaries fall
+ * anywhere in a group, and pattern 2 in two calls split at split.
+ *
+ * @param pattern The pattern, 0 to 2
+ * @param length The number of values
+ * @param done The number of values already handled
+ * @param split Where pattern 2 splits the values
+ * @return The number of values the next call handles
+ */
+static long bpuTestNextCall(int pattern, long length, long done, long split)
+{
+    long count = length - done; // Everything that is left
+    if (pattern == 1 && count > 1 + length % 13)
+    {
+        count = 1 + length % 13;
+    }
+    if (pattern == 2 && done < split)
+    {
+        count = split - done;
+    }
+    return count;
+}
+
+/**
+ * This function packs values bit by bit, most significant bit first, the plainest reading of the ebc format.
+ *
+ * @param values The values to pack
+ * @param count The number of values
+ * @param bitWidth The number of bits per value (1 to 32)
+ * @param packed The array to store the packed bytes in
+ * @return The number of packed bytes, the last padded with zero bits
+ */
+static long bpuTestNaivePack(const unsigned int *values, long count, int bitWidth, unsigned char *packed)
+{
+    long byteAmount = (count * bitWidth + 7) / 8; // The bytes the values take
+    memset(packed, 0, (size_t)byteAmount);
+    long bit = 0; // The next bit to set
+    for (long index = 0; index < count; index++)
+    {
+        for (int valueBit = bitWidth - 1; valueBit >= 0; valueBit--)
+        {
+            if ((values[index] >> valueBit) & 1u)
+            {
+                packed[bit / 8] |= (unsigned char)(0x80 >> (bit % 8));
+            }
+            bit++;
+        }
+    }
+    return byteAmount;
+}
+
+/**
+ * This function sets up the masks of the mask-table codec.
+ *
+ * These are the tables the ebc format was first read and written with, before the accumulator codec.
+ *
+ * @param mask The array of 14 masks to set up
+ * @param mode The number of bits per pixel (5 or 7)
+ * @param writing Whether the masks are for writing rather than reading
+ * @return The number of masks
+ */
+static int bpuTestMaskInit(BpuTestMask *mask, int mode, int writing)
+{
+    static const unsigned char read5[] = {248, 7, 192, 62, 1, 240, 15, 128, 124, 3, 224, 31};
+    static const int readShift5[] = {3, -2, 6, 1, -4, 4, -1, 7, 2, -3, 5, 0};
+    static const unsigned char read7[] = {254, 1, 252, 3, 248, 7, 240, 15, 224, 31, 192, 63, 128, 127};
+    static const int readShift7[] = {1, -6, 2, -5, 3, -4, 4, -3, 5, -2, 6, -1, 7, 0};
+    static const unsigned char write5[] = {31, 28, 3, 31, 16, 15, 30, 1, 31, 24, 7, 31};
+    static const int writeShift5[] = {-3, 2, -6, -1, 4, -4, 1, -7, -2, 3, -5, 0};
+    static const unsigned char write7[] = {127, 64, 63, 96, 31, 112, 15, 120, 7, 124, 3, 126, 1, 127};
+    static const int writeShift7[] = {-1, 6, -2, 5, -3, 4, -4, 3, -5, 2, -6, 1, -7, 0};
+
+    const unsigned char *masks = mode == 5 ? (writing ? write5 : read5) : (writing ? write7 : read7);
+    const int *shifts = mode == 5 ? (writing ? writeShift5 : readShift5) : (writing ? writeShift7 : readShift7);
+    int maskAmount = mode == 5 ? 12 : 14;
+    for (int i = 0; i < maskAmount; i++)
+    {
+        mask[i].mask = masks[i];
+        mask[i].shift = shifts[i];
+        mask[i].noBitsGathered = btuPopCount(masks[i]);
+    }
+    return maskAmount;
+}
+
+/**
+ * This function packs pixels with the mask-table writer, into memory rather than a file.
+ *
+ * The mask steps run until the last pixel has been taken in whole, as the mask-table writer did for an image
+ * that ends on a byte boundary.
+ *
+ * @param values The pixels to pack
+ * @param count The number of pixels, at least 1
+ * @param mode The number of bits per pixel (5 or 7)
+ * @param packed The array to store the packed bytes in
+ * @return The number of packed bytes
+ */
+static long bpuTestMaskPack(const unsigned int *values, long count, int mode, unsigned char *packed)
+{
+    BpuTestMask mask[14];                        // The array of masks
+    int maskAmount = bpuTestMaskInit(mask, mode, 1);
+    int bitsRead = mode;                         // Number of bits taken from the current pixel
+    int bitsGathered = 0;                        // Number of bits that have been added to the cleanBuffer
+    unsigned char cleanBuffer = 0;               // The byte being put together
+    unsigned char currentByte = 0;               // The current pixel
+    long pixelCount = 0;                         // How many pixels have been taken
+    long byteAmount = 0;                         // How many bytes have been packed
+    int run = 1;
+    while (run)
+    {
+        for (int i = 0; i < maskAmount; i++)
+        {
+            if (bitsRead == mode)
+            { // Take the next pixel
+                currentByte = (unsigned char)values[pixelCount];
+                bitsRead = 0;
+                pixelCount++;
+            }
+            unsigned char dirtyBuffer = currentByte & mask[i].mask; // Mask the pixel with the mask
+            btuMultiDirectionBitShift(&dirtyBuffer, mask[i].shift); // Shift the bits according to the shift value in the mask
+            cleanBuffer = cleanBuffer | dirtyBuffer;
+            bitsRead = bitsRead + mask[i].noBitsGathered;
+            bitsGathered = bitsGathered + mask[i].noBitsGathered;
+            if (bitsGathered == 8)
+            { // A whole byte has been put together
+                packed[byteAmount++] = cleanBuffer;
+                bitsGathered = 0;
+                cleanBuffer = 0;
+            }
+            if (pixelCount == count && bitsRead == mode)
+            { // The last pixel has been taken in whole, write out the partly filled byte
+                if (bitsGathered != 0)
+                {
+                    packed[byteAmount++] = cleanBuffer;
+                }
+                run = 0;
+                break;
+            }
+        }
+    }
+    return byteAmount;
+}
+
+/**
+ * This function unpacks pixels with the mask-table reader, from memory rather than a file.
+ *
+ * @param packed The packed bytes
+ * @param count The number of pixels, at least 1
+ * @param mode The number of bits per pixel (5 or 7)
+ * @param store The array to store the pixels in
+ */
+static void bpuTestMaskUnpack(const unsigned char *packed, long count, int mode, unsigned int *store)
+{
+    BpuTestMask mask[14];          // The array of masks
+    int maskAmount = bpuTestMaskInit(mask, mode, 0);
+    int bitsLeft = 0;              // The number of bits left in the current byte
+    int bitsGathered = 0;          // The number of bits that have been added to the cleanBuffer
+    unsigned char cleanBuffer = 0; // The pixel being put together
+    unsigned char currentByte = 0; // The current byte
+    long byteIndex = 0;            // The next byte to take
+    long pixelCount = 0;           // The number of pixels that have been unpacked
+    int run = 1;
+    while (run)
+    {
+        for (int i = 0; i < maskAmount; i++)
+        {
+            if (bitsLeft == 0)
+            { // Take the next byte
+                currentByte = packed[byteIndex++];
+                bitsLeft = 8;
+            }
+            unsigned char dirtyBuffer = currentByte & mask[i].mask; // Mask the byte with the mask
+            btuMultiDirectionBitShift(&dirtyBuffer, mask[i].shift); // Shift the bits according to the shift value in the mask
+            cleanBuffer = cleanBuffer | dirtyBuffer;
+            bitsLeft = bitsLeft - mask[i].noBitsGathered;
+            bitsGathered = bitsGathered + mask[i].noBitsGathered;
+            if (bitsGathered == mode)
+            { // A whole pixel has been put together
+                store[pixelCount++] = cleanBuffer;
+                bitsGathered = 0;
+                cleanBuffer = 0;
+            }
+            if (pixelCount == count)
+            {
+                run = 0;
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * This function checks the bit by bit packer against the mask-table codec at 5 and 7 bits, for every length.
+ *
+ * Every other check compares against the bit by bit packer, so this ties all of them to the original codec.
+ */
+static void bpuTestAgainstMasks(void)
+{
+    static unsigned int values[BPU_TEST_MAX_LENGTH];
+    static unsigned int unpacked[BPU_TEST_MAX_LENGTH];
+    static unsigned char expected[BPU_TEST_MAX_LENGTH + 1];
+    static unsigned char packed[BPU_TEST_MAX_LENGTH + 1];
+    for (int mode = 5; mode <= 7; mode += 2)
+    {
+        for (long length = 1; length <= BPU_TEST_MAX_LENGTH; length++)
+        {
+            for (long index = 0; index < length; index++)
+            {
+                values[index] = bpuTestRandom() & ((1u << mode) - 1);
+            }
+            long byteAmount = bpuTestNaivePack(values, length, mode, expected);
+            long maskBytes = bpuTestMaskPack(values, length, mode, packed);
+            bpuTestCheck(maskBytes == byteAmount && memcmp(packed, expected, (size_t)byteAmount) == 0, "bit by bit packer against the mask-table writer", "reference", mode, length);
+            bpuTestMaskUnpack(expected, length, mode, unpacked);
+            bpuTestCheck(memcmp(unpacked, values, sizeof(unsigned int) * (size_t)length) == 0, "bit by bit packer against the mask-table reader", "reference", mode, length);
+        }
+    }
+}
+
+/**
+ * This function packs and unpacks every length of row at every width, as pixels and as indices, in every read and write pattern.
+ *
+ * @param tierName The kernels in use
+ * @param file A temporary file to write through
+ */
+static void bpuTestRows(const char *tierName, FILE *file)
+{
+    static unsigned int values[BPU_TEST_MAX_LENGTH];
+    static Pixel pixels[BPU_TEST_MAX_LENGTH];
+    static EbIndex indices[BPU_TEST_MAX_LENGTH];
+    static Pixel pixelsRead[BPU_TEST_MAX_LENGTH];
+    static EbIndex indicesRead[BPU_TEST_MAX_LENGTH];
+    static unsigned char expected[2 * BPU_TEST_MAX_LENGTH + 1];
+    static unsigned char written[2 * BPU_TEST_MAX_LENGTH + 1];
+    for (int bitWidth = 1; bitWidth <= BPU_MAX_BIT_WIDTH; bitWidth++)
+    {
+        for (long length = 0; length <= BPU_TEST_MAX_LENGTH; length++)
+        {
+            for (long index = 0; index < length; index++)
+            {
+                values[index] = bpuTestRandom() & ((1u << bitWidth) - 1);
+                pixels[index] = (Pixel)values[index];
+                indices[index] = (EbIndex)values[index];
+            }
+            long byteAmount = bpuTestNaivePack(values, length, bitWidth, expected);
+            long split = length > 0 ? (long)(bpuTestRandom() % (unsigned int)(length + 1)) : 0; // Where pattern 2 splits the row
+
+            for (int pattern = 0; pattern < 3; pattern++)
+            {
+                for (int asIndices = bitWidth > BPU_MAX_PIXEL_BITS; asIndices <= 1; asIndices++)
+                { // Pixels only go up to BPU_MAX_PIXEL_BITS, indices go up to BPU_MAX_BIT_WIDTH
+                    int check = SUCCESS;
+                    bpuReaderInitMemory(&bpuTestReader, expected, byteAmount, bitWidth, length);
+                    for (long done = 0; done < length && check == SUCCESS;)
+                    {
+                        int count = (int)bpuTestNextCall(pattern, length, done, split);
+                        check = asIndices ? bpuReadIndices(&bpuTestReader, indicesRead + done, count) : bpuReadPixels(&bpuTestReader, pixelsRead + done, count);
+                        done += count;
+                    }
+                    bpuTestCheck(check == SUCCESS && (asIndices ? memcmp(indicesRead, indices, sizeof(EbIndex) * (size_t)length) : memcmp(pixelsRead, pixels, sizeof(Pixel) * (size_t)length)) == 0,
+                                 asIndices ? "reading indices from memory" : "reading pixels from memory", tierName, bitWidth, length);
+
+                    rewind(file);
+                    bpuWriterInit(&bpuTestWriter, file, bitWidth);
+                    for (long done = 0; done < length && check == SUCCESS;)
+                    {
+                        int count = (int)bpuTestNextCall(pattern, length, done, split);
+                        check = asIndices ? bpuWriteIndices(&bpuTestWriter, indices + done, count) : bpuWritePixels(&bpuTestWriter, pixels + done, count);
+                        done += count;
+                    }
+                    if (check == SUCCESS)
+                    {
+                        check = bpuWriterFlush(&bpuTestWriter);
+                    }
+                    long writtenAmount = ftell(file); // The bytes the writer wrote
+                    rewind(file);
+                    bpuTestCheck(check == SUCCESS && writtenAmount == byteAmount && (long)fread(written, 1, (size_t)byteAmount, file) == byteAmount && memcmp(written, expected, (size_t)byteAmount) == 0,
+                                 asIndices ? "writing indices" : "writing pixels", tierName, bitWidth, length);
+                }
+            }
+
+            if (length > 0)
+            { // A stream that ends a byte early runs out of data
+                bpuReaderInitMemory(&bpuTestReader, expected, byteAmount - 1, bitWidth, length);
+                int check = bitWidth <= BPU_MAX_PIXEL_BITS ? bpuReadPixels(&bpuTestReader, pixelsRead, (int)length) : bpuReadIndices(&bpuTestReader, indicesRead, (int)length);
+                bpuTestCheck(check == BAD_DATA, "reading a stream a byte short", tierName, bitWidth, length);
+            }
+        }
+    }
+}
+
+/**
+ * This function writes and reads back a long stream through a file, so both buffers are refilled and drained many times.
+ *
+ * @param tierName The kernels in use
+ * @param file A temporary file to write through
+ */
+static void bpuTestLong(const char *tierName, FILE *file)
+{
+    static unsigned int values[BPU_TEST_LONG_LENGTH];
+    static Pixel pixels[BPU_TEST_LONG_LENGTH];
+    static EbIndex indices[BPU_TEST_LONG_LENGTH];
+    static Pixel pixelsRead[BPU_TEST_LONG_LENGTH];
+    static EbIndex indicesRead[BPU_TEST_LONG_LENGTH];
+    static unsigned char expected[2 * BPU_TEST_LONG_LENGTH + 1];
+    static unsigned char written[2 * BPU_TEST_LONG_LENGTH + 1];
+    const int bitWidths[] = {5, 7, 12}; // The ebc and E5 widths, E7, and the indices of 4096 paradigm blocks
+    for (int widthIndex = 0; widthIndex < 3; widthIndex++)
+    {
+        int bitWidth = bitWidths[widthIndex];
+        for (long index = 0; index < BPU_TEST_LONG_LENGTH; index++)
+        {
+            values[index] = bpuTestRandom() & ((1u << bitWidth) - 1);
+            pixels[index] = (Pixel)values[index];
+            indices[index] = (EbIndex)values[index];
+        }
+        long byteAmount = bpuTestNaivePack(values, BPU_TEST_LONG_LENGTH, bitWidth, expected);
+        for (int asIndices = bitWidth > BPU_MAX_PIXEL_BITS; asIndices <= 1; asIndices++)
+        {
+            int check = SUCCESS;
+            rewind(file);
+            bpuWriterInit(&bpuTestWriter, file, bitWidth);
+            for (long done = 0; done < BPU_TEST_LONG_LENGTH && check == SUCCESS; done += BPU_TEST_CHUNK_WIDTH)
+            { // Rows of an odd width, so the row boundaries fall anywhere in a group
+                int count = (int)(BPU_TEST_LONG_LENGTH - done < BPU_TEST_CHUNK_WIDTH ? BPU_TEST_LONG_LENGTH - done : BPU_TEST_CHUNK_WIDTH);
+                check = asIndices ? bpuWriteIndices(&bpuTestWriter, indices + done, count) : bpuWritePixels(&bpuTestWriter, pixels + done, count);
+            }
+            if (check == SUCCESS)
+            {
+                check = bpuWriterFlush(&bpuTestWriter);
+            }
+            long writtenAmount = ftell(file); // The bytes the writer wrote
+            rewind(file);
+            bpuTestCheck(check == SUCCESS && writtenAmount == byteAmount && (long)fread(written, 1, (size_t)byteAmount, file) == byteAmount && memcmp(written, expected, (size_t)byteAmount) == 0,
+                         asIndices ? "writing a long stream of indices" : "writing a long stream of pixels", tierName, bitWidth, BPU_TEST_LONG_LENGTH);
+
+            rewind(file);
+            bpuReaderInit(&bpuTestReader, file, bitWidth, BPU_TEST_LONG_LENGTH);
+            for (long done = 0; done < BPU_TEST_LONG_LENGTH && check == SUCCESS; done += BPU_TEST_CHUNK_HEIGHT)
+            { // Read in rows of another width than they were written in
+                int count = (int)(BPU_TEST_LONG_LENGTH - done < BPU_TEST_CHUNK_HEIGHT ? BPU_TEST_LONG_LENGTH - done : BPU_TEST_CHUNK_HEIGHT);
+                check = asIndices ? bpuReadIndices(&bpuTestReader, indicesRead + done, count) : bpuReadPixels(&bpuTestReader, pixelsRead + done, count);
+            }
+            bpuTestCheck(check == SUCCESS && (asIndices ? memcmp(indicesRead, indices, sizeof(indices)) : memcmp(pixelsRead, pixels, sizeof(pixels))) == 0,
+                         asIndices ? "reading a long stream of indices from a file" : "reading a long stream of pixels from a file", tierName, bitWidth, BPU_TEST_LONG_LENGTH);
+        }
+    }
+}
+
+/**
+ * This function checks the chunked reader against the bit by bit packer for every number of chunks it makes.
+ *
+ * @param tierName The kernels in use
+ */
+static void bpuTestChunks(const char *tierName)
+{
+    long pixelAmount = (long)BPU_TEST_CHUNK_HEIGHT * BPU_TEST_CHUNK_WIDTH; // The pixels of the image
+    unsigned int *values = (unsigned int *)malloc(sizeof(unsigned int) * (size_t)pixelAmount);
+    unsigned char *packed = (unsigned char *)malloc((size_t)pixelAmount);
+    Pixel **store = ebCreate2DArray(BPU_TEST_CHUNK_HEIGHT, BPU_TEST_CHUNK_WIDTH);
+    if (values == NULL || packed == NULL || store == NULL)
+    {
+        bpuTestCheck(0, "allocating the chunked image", tierName, 0, pixelAmount);
+        free(values);
+        free(packed);
+        if (store != NULL)
+        {
+            ebFree2DArray(store);
+        }
+        return;
+    }
+
+    for (int mode = 5; mode <= 7; mode += 2)
+    {
+        for (long index = 0; index < pixelAmount; index++)
+        {
+            values[index] = bpuTestRandom() & ((1u << mode) - 1);
+        }
+        long byteAmount = bpuTestNaivePack(values, pixelAmount, mode, packed);
+        for (int threadAmount = 1; threadAmount <= 4; threadAmount++)
+        {
+            memset(store[0], 0xff, sizeof(Pixel) * (size_t)pixelAmount);
+            long offset = 0; // Where the packed data starts, moved past it once it is read
+            int check = ebcUniversalParallelReader(store, packed, byteAmount, &offset, mode, BPU_TEST_CHUNK_HEIGHT, BPU_TEST_CHUNK_WIDTH, threadAmount);
+            int same = check == SUCCESS && offset == byteAmount;
+            for (long index = 0; index < pixelAmount && same; index++)
+            {
+                same = store[0][index] == values[index];
+            }
+            bpuTestCheck(same, "reading in chunks", tierName, mode, pixelAmount);
+
+            offset = 0;
+            check = ebcUniversalParallelReader(store, packed, byteAmount - 1, &offset, mode, BPU_TEST_CHUNK_HEIGHT, BPU_TEST_CHUNK_WIDTH, threadAmount);
+            bpuTestCheck(check == BAD_DATA, "reading chunks a byte short", tierName, mode, pixelAmount);
+        }
+    }
+    free(values);
+    free(packed);
+    ebFree2DArray(store);
+}
+
+/**
+ * This function packs a row of the image in a BpuTestRows bit by bit, for ebcWritePackedRows().
+ *
+ * @param source The image, a BpuTestRows
+ * @param y The row to pack
+ * @param packed Where to store the packed row
+ */
+static void bpuTestPackRow(const void *source, int y, unsigned char *packed)
+{
+    const BpuTestRows *rows = (const BpuTestRows *)source;
+    bpuTestNaivePack(rows->values + (long)y * rows->width, rows->width, rows->bitWidth, packed);
+}
+
+/**
+ * This function checks the chunked writer of the decompressors against the bit by bit packer for every number of chunks it makes.
+ *
+ * The image is written in two calls, the first a few rows that leave the second starting partway through a byte.
+ *
+ * @param file A temporary file to write through
+ */
+static void bpuTestPackedRows(FILE *file)
+{
+    static EbcWriter writer; // Holds a 64 KiB buffer, so it is kept off the stack
+    long pixelAmount = (long)BPU_TEST_CHUNK_HEIGHT * BPU_TEST_CHUNK_WIDTH; // The pixels of the image
+    unsigned int *values = (unsigned int *)malloc(sizeof(unsigned int) * (size_t)pixelAmount);
+    unsigned char *expected = (unsigned char *)malloc((size_t)pixelAmount);
+    unsigned char *written = (unsigned char *)malloc((size_t)pixelAmount);
+    if (values == NULL || expected == NULL || written == NULL)
+    {
+        bpuTestCheck(0, "allocating the image to write in chunks", "scalar", 0, pixelAmount);
+        free(values);
+        free(expected);
+        free(written);
+        return;
+    }
+
+    EbcWorkspace workspace; // Where the chunks are packed
+    ebcInitWorkspace(&workspace);
+    BpuTestRows rows;
+    rows.width = BPU_TEST_CHUNK_WIDTH;
+    for (int mode = 5; mode <= 7; mode += 2)
+    {
+        for (long index = 0; index < pixelAmount; index++)
+        {
+            values[index] = bpuTestRandom() & ((1u << mode) - 1);
+        }
+        long byteAmount = bpuTestNaivePack(values, pixelAmount, mode, expected);
+        rows.bitWidth = mode;
+        for (int threadAmount = 1; threadAmount <= 4; threadAmount++)
+        {
+            for (int firstRows = 0; firstRows <= 5; firstRows += 5)
+            {
+                workspace.threadAmount = threadAmount;
+                rewind(file);
+                writer.fp = file;
+                writer.width = BPU_TEST_CHUNK_WIDTH;
+                writer.symbols = NULL;
+                bpuWriterInit(&writer.bits, file, mode);
+                rows.values = values;
+                int check = ebcWritePackedRows(&writer, firstRows, bpuTestPackRow, &rows, &workspace);
+                rows.values = values + (long)firstRows * BPU_TEST_CHUNK_WIDTH;
+                if (check == SUCCESS)
+                {
+                    check = ebcWritePackedRows(&writer, BPU_TEST_CHUNK_HEIGHT - firstRows, bpuTestPackRow, &rows, &workspace);
+                }
+                if (check == SUCCESS)
+                {
+                    check = bpuWriterFlush(&writer.bits);
+                }
+                long writtenAmount = ftell(file); // The bytes the writer wrote
+                rewind(file);
+                bpuTestCheck(check == SUCCESS && writtenAmount == byteAmount && (long)fread(written, 1, (size_t)byteAmount, file) == byteAmount && memcmp(written, expected, (size_t)byteAmount) == 0,
+                             firstRows == 0 ? "writing rows in chunks" : "writing rows in chunks after a partial byte", "scalar", mode, pixelAmount);
+            }
+        }
+    }
+    ebcFreeWorkspace(&workspace);
+    free(values);
+    free(expected);
+    free(written);
+}
+
+/**
+ * This function checks the row packers of ebcUnblock and the R family decompressors against the bit by bit packer.
+ */
+static void bpuTestRowPackers(void)
+{
+    static unsigned int values[8 * 200];
+    static Pixel pixels[200];
+    static EbIndex indices[200];
+    static uint32_t fragments[64];
+    static unsigned char expected[8 * 200 + 8];
+    static unsigned char packed[8 * 200 + 8];
+    for (int mode = 5; mode <= 7; mode += 2)
+    {
+        for (int repeat = 1; repeat <= 8; repeat++)
+        {
+            for (int length = 0; length <= 200; length++)
+            {
+                for (int index = 0; index < length; index++)
+                {
+                    pixels[index] = (Pixel)(bpuTestRandom() & ((1u << mode) - 1));
+                    for (int copy = 0; copy < repeat; copy++)
+                    {
+                        values[index * repeat + copy] = pixels[index];
+                    }
+                }
+                long byteAmount = bpuTestNaivePack(values, (long)length * repeat, mode, expected);
+                long bits = bpuPackRepeated(pixels, length, repeat, mode, packed);
+                bpuTestCheck(bits == (long)length * repeat * mode && memcmp(packed, expected, (size_t)byteAmount) == 0, "packing repeated pixels", "scalar", mode, length);
+            }
+        }
+    }
+
+    for (int fragmentBits = 1; fragmentBits <= 32; fragmentBits++)
+    {
+        for (int fragmentIndex = 0; fragmentIndex < 64; fragmentIndex++)
+        {
+            fragments[fragmentIndex] = fragmentBits == 32 ? bpuTestRandom() : bpuTestRandom() & ((1u << fragmentBits) - 1);
+        }
+        for (int length = 0; length <= 200; length++)
+        {
+            for (int index = 0; index < length; index++)
+            {
+                indices[index] = (EbIndex)(bpuTestRandom() % 64);
+                values[index] = fragments[indices[index]];
+            }
+            long byteAmount = bpuTestNaivePack(values, length, fragmentBits, expected);
+            long bits = bpuPackGathered(fragments, indices, length, fragmentBits, packed);
+            bpuTestCheck(bits == (long)length * fragmentBits && memcmp(packed, expected, (size_t)byteAmount) == 0, "packing gathered fragments", "scalar", fragmentBits, length);
+        }
+    }
+}
+
+/**
+ * This function codes and decodes every length of index stream with rANS, reading it back in rows.
+ */
+static void bpuTestRans(void)
+{
+    static EbIndex symbols[BPU_TEST_MAX_LENGTH];
+    static EbIndex decoded[BPU_TEST_MAX_LENGTH];
+    const int symbolAmounts[] = {2, 32, 4096}; // The fewest, the E5 and the most paradigm blocks
+    for (long length = 0; length <= BPU_TEST_MAX_LENGTH; length++)
+    {
+        int symbolAmount = symbolAmounts[length % 3];
+        for (long index = 0; index < length; index++)
+        { // Skewed like real indices, a few common symbols and a long tail
+            unsigned int draw = bpuTestRandom();
+            symbols[index] = (EbIndex)((draw & 3) != 0 ? (draw >> 8) % (symbolAmount < 8 ? symbolAmount : 8) : (draw >> 8) % symbolAmount);
+        }
+        unsigned char *coded = NULL; // The coded symbols
+        long codedSize = 0;          // The number of bytes of coded symbols
+        int check = ransEncode(symbols, length, symbolAmount, &coded, &codedSize);
+        RansDecoder decoder; // Decodes the symbols back
+        if (check == SUCCESS)
+        {
+            check = ransOpenDecoder(&decoder, coded, codedSize, symbolAmount);
+            for (long done = 0; done < length && check == SUCCESS;)
+            {
+                long count = bpuTestNextCall(1, length, done, 0);
+                check = ransDecode(&decoder, decoded + done, count);
+                done += count;
+            }
+            int closeCheck = check == SUCCESS ? ransCloseDecoder(&decoder) : SUCCESS;
+            check = check == SUCCESS ? closeCheck : check;
+        }
+        bpuTestCheck(check == SUCCESS && memcmp(decoded, symbols, sizeof(EbIndex) * (size_t)length) == 0, "rANS round trip", "scalar", symbolAmount, length);
+
+        if (check == SUCCESS && length > 0 && codedSize > 2)
+        { // A stream a word short fails, without being read past its end
+            unsigned char *shortened = (unsigned char *)malloc((size_t)codedSize - 2); // Exactly the bytes left, so a sanitizer catches reading past them
+            int shortCheck = shortened == NULL ? BAD_MALLOC : SUCCESS;
+            if (shortCheck == SUCCESS)
+            {
+                memcpy(shortened, coded, (size_t)codedSize - 2);
+                shortCheck = ransOpenDecoder(&decoder, shortened, codedSize - 2, symbolAmount);
+            }
+            if (shortCheck == SUCCESS)
+            {
+                shortCheck = ransDecode(&decoder, decoded, length);
+                int closeCheck = ransCloseDecoder(&decoder);
+                shortCheck = shortCheck == SUCCESS ? closeCheck : shortCheck;
+            }
+            bpuTestCheck(shortCheck == BAD_DATA, "rANS stream a word short", "scalar", symbolAmount, length);
+            free(shortened);
+        }
+        free(coded);
+    }
+}
+
+/**
+ * This function writes an EA image with more indices than fit in one coded block and reads it back from memory.
+ *
+ * The rows are an odd width, so one of them runs on from the first block into the second.
+ *
+ * @param file A temporary file to write through
+ */
+static void bpuTestCodedBlocks(FILE *file)
+{
+    static EbcWriter writer; // Writers and readers hold a 64 KiB buffer, so they are kept off the stack
+    static EbcReader reader;
+    Image image;
+    image.width = BPU_TEST_CHUNK_WIDTH;
+    image.height = EBC_CODED_BLOCK_INDICES / BPU_TEST_CHUNK_WIDTH + 2;
+    image.paradigmBlockAmount = 32;
+    long indexAmount = (long)image.height * image.width; // The indices of the image
+    image.paradigm = ebCreate2DArray(BLOCK_HEIGHT, image.paradigmBlockAmount * BLOCK_WIDTH);
+    EbIndex *indices = (EbIndex *)malloc(sizeof(EbIndex) * (size_t)indexAmount);
+    EbIndex *row = (EbIndex *)malloc(sizeof(EbIndex) * (size_t)image.width);
+    unsigned char *bytes = (unsigned char *)malloc(sizeof(EbIndex) * (size_t)indexAmount + 65536); // The written file, never bigger than the indices unpacked
+    if (image.paradigm == NULL || indices == NULL || row == NULL || bytes == NULL)
+    {
+        bpuTestCheck(0, "allocating the image to code in blocks", "scalar", 0, indexAmount);
+    }
+    else
+    {
+        memset(image.paradigm[0], 0, (size_t)BLOCK_HEIGHT * image.paradigmBlockAmount * BLOCK_WIDTH * sizeof(Pixel));
+        for (long index = 0; index < indexAmount; index++)
+        { // Skewed like real indices
+            unsigned int draw = bpuTestRandom();
+            indices[index] = (EbIndex)((draw & 3) != 0 ? (draw >> 8) % 4 : (draw >> 8) % 32);
+        }
+        rewind(file);
+        int check = ebcOpenStreamWriter(&writer, &image, file, MAGIC_NUMBER_EBCRA);
+        for (int y = 0; y < image.height && check == SUCCESS; y++)
+        {
+            check = ebcWriteIndexRow(&writer, indices + (long)y * image.width);
+        }
+        int closeCheck = check == SUCCESS ? ebcCloseWriter(&writer) : SUCCESS;
+        check = check == SUCCESS ? closeCheck : check;
+        long size = ftell(file); // The bytes of the EA file
+        rewind(file);
+        if (check == SUCCESS && (size > (long)sizeof(EbIndex) * indexAmount + 65536 || (long)fread(bytes, 1, (size_t)size, file) != size))
+        {
+            check = BAD_FILE;
+        }
+
+        for (int cut = 0; cut <= 1; cut++)
+        { // Read back the whole file, then the file a byte short
+            Image readImage;
+            int readCheck = check == SUCCESS ? ebcOpenMemoryReader(&reader, &readImage, bytes, size - cut, MAGIC_NUMBER_EBCRA) : check;
+            int same = readCheck == SUCCESS;
+            if (readCheck == SUCCESS)
+            {
+                for (int y = 0; y < readImage.height && readCheck == SUCCESS; y++)
+                {
+                    readCheck = ebcReadIndexRow(&reader, row);
+                    same = same && memcmp(row, indices + (long)y * image.width, sizeof(EbIndex) * (size_t)image.width) == 0;
+                }
+                closeCheck = ebcCloseReader(&reader);
+                readCheck = readCheck == SUCCESS ? closeCheck : readCheck;
+                ebFree2DArray(readImage.paradigm);
+            }
+            if (cut == 0)
+            {
+                bpuTestCheck(readCheck == SUCCESS && same, "coding indices in blocks", "scalar", image.paradigmBlockAmount, indexAmount);
+            }
+            else
+            {
+                bpuTestCheck(check == SUCCESS && readCheck == BAD_DATA, "coded blocks a byte short", "scalar", image.paradigmBlockAmount, indexAmount);
+            }
+        }
+    }
+    if (image.paradigm != NULL)
+    {
+        ebFree2DArray(image.paradigm);
+    }
+    free(indices);
+    free(row);
+    free(bytes);
+}
+
+/**
+ * This function finds the closest paradigm block to an image block one pixel at a time, the first one if several are equally close.
+ *
+ * @param imageBlock The image block
+ * @param paradigmBlock The array of paradigm blocks
+ * @param paradigmBlockAmount The number of paradigm blocks
+ * @return The index of the closest paradigm block
+ */
+static int bpuTestNearest(const Block *imageBlock, const Block *paradigmBlock, int paradigmBlockAmount)
+{
+    int best = 0;            // The closest paradigm block so far
+    int bestDistance = -1;   // Its distance, -1 before the first one
+    for (int pbIndex = 0; pbIndex < paradigmBlockAmount; pbIndex++)
+    {
+        int distance = 0; // The sum of absolute differences to this paradigm block
+        for (int blockY = 0; blockY < BLOCK_HEIGHT; blockY++)
+        {
+            for (int blockX = 0; blockX < BLOCK_WIDTH; blockX++)
+            {
+                distance += abs((int)imageBlock->data[blockY][blockX] - (int)paradigmBlock[pbIndex].data[blockY][blockX]);
+            }
+        }
+        if (bestDistance < 0 || distance < bestDistance)
+        { // Only a strictly closer block takes over, so the first of equally close ones wins
+            best = pbIndex;
+            bestDistance = distance;
+        }
+    }
+    return best;
+}
+
+/**
+ * This function checks every paradigm search, with the cache on and off, finds the same blocks as the full search.
+ *
+ * The random sets draw every pixel from 0 to 31. The tie-heavy sets only use the pixels 0 and 31, copy some paradigm
+ * blocks onto later ones and repeat a few image blocks, so most image blocks are equally close to several paradigm
+ * blocks and the lowest index has to win in every search. The full search is itself checked against a plain loop.
+ */
+static void bpuTestSearches(void)
+{
+    const int paradigmAmounts[] = {1, 2, 17, EBR_TABLE_MAX_PARADIGMS, EBR_TABLE_MAX_PARADIGMS + 1, 1000}; // Past EBR_TABLE_MAX_PARADIGMS the table search stands down
+    const int searches[] = {EBR_SEARCH_FULL, EBR_SEARCH_PRUNED, EBR_SEARCH_TABLE, EBR_SEARCH_TREE};
+    const char *searchNames[] = {"full", "pruned", "table", "tree"}; // Indexed by the EBR_SEARCH constants
+    const int maxParadigms = 1000;                                   // The most paradigm blocks of any set
+    int rowAmount = (BPU_TEST_SEARCH_BLOCKS + BPU_TEST_SEARCH_WIDTH - 1) / BPU_TEST_SEARCH_WIDTH; // The rows of the compressed image
+    Block *imageBlock = blockCreateArena(BPU_TEST_SEARCH_BLOCKS);
+    Block *paradigmBlock = blockCreateArena(maxParadigms);
+    EbIndexBuffer fullBuffer;   // The indices the full search finds
+    EbIndexBuffer searchBuffer; // The indices the search being checked finds
+    ebInitIndexBuffer(&fullBuffer);
+    ebInitIndexBuffer(&searchBuffer);
+    EbIndex **fullIndices = ebReuseIndexArray(&fullBuffer, rowAmount, BPU_TEST_SEARCH_WIDTH);
+    EbIndex **searchIndices = ebReuseIndexArray(&searchBuffer, rowAmount, BPU_TEST_SEARCH_WIDTH);
+    if (imageBlock == NULL || paradigmBlock == NULL || fullIndices == NULL || searchIndices == NULL)
+    {
+        bpuTestCheck(0, "allocating the blocks to search", "scalar", 0, BPU_TEST_SEARCH_BLOCKS);
+    }
+    for (int tieHeavy = 0; tieHeavy <= 1 && !(imageBlock == NULL || paradigmBlock == NULL || fullIndices == NULL || searchIndices == NULL); tieHeavy++)
+    {
+        for (int amountIndex = 0; amountIndex < (int)(sizeof(paradigmAmounts) / sizeof(paradigmAmounts[0])); amountIndex++)
+        {
+            int paradigmBlockAmount = paradigmAmounts[amountIndex];
+            for (int pbIndex = 0; pbIndex < paradigmBlockAmount; pbIndex++)
+            {
+                int copyOf = tieHeavy && pbIndex > 0 && bpuTestRandom() % 4 == 0 ? (int)(bpuTestRandom() % (unsigned int)pbIndex) : -1; // An earlier block to copy, -1 for none
+                for (int pixel = 0; pixel < BLOCK_SIZE; pixel++)
+                {
+                    Pixel value = (Pixel)(tieHeavy ? (bpuTestRandom() & 1) * 31 : bpuTestRandom() % 32);
+                    paradigmBlock[pbIndex].data[pixel / BLOCK_WIDTH][pixel % BLOCK_WIDTH] = copyOf < 0 ? value : paradigmBlock[copyOf].data[pixel / BLOCK_WIDTH][pixel % BLOCK_WIDTH];
+                }
+            }
+            for (int blockIndex = 0; blockIndex < BPU_TEST_SEARCH_BLOCKS; blockIndex++)
+            {
+                int copyOf = tieHeavy && blockIndex >= 16 && bpuTestRandom() % 2 == 0 ? (int)(bpuTestRandom() % 16) : -1; // One of the first image blocks to repeat, -1 for none
+                for (int pixel = 0; pixel < BLOCK_SIZE; pixel++)
+                {
+                    Pixel value = (Pixel)(tieHeavy ? (bpuTestRandom() & 1) * 31 : bpuTestRandom() % 32);
+                    imageBlock[blockIndex].data[pixel / BLOCK_WIDTH][pixel % BLOCK_WIDTH] = copyOf < 0 ? value : imageBlock[copyOf].data[pixel / BLOCK_WIDTH][pixel % BLOCK_WIDTH];
+                }
+            }
+
+            for (int searchIndex = 0; searchIndex < (int)(sizeof(searches) / sizeof(searches[0])); searchIndex++)
+            {
+                for (int cache = EBR_CACHE_OFF; cache <= EBR_CACHE_ON; cache++)
+                {
+                    EbrOptions options;
+                    options.threadAmount = 1 + (amountIndex + searchIndex) % 3; // The rows are shared out the same whatever the thread count
+                    options.search = searches[searchIndex];
+                    options.cache = cache;
+                    options.paradigmBlockAmount = paradigmBlockAmount;
+                    options.entropyCoded = 0;
+                    int full = searches[searchIndex] == EBR_SEARCH_FULL && cache == EBR_CACHE_OFF; // The run the others are checked against
+                    Image compressedImage;
+                    compressedImage.width = BPU_TEST_SEARCH_WIDTH;
+                    compressedImage.height = rowAmount;
+                    compressedImage.paradigmBlockAmount = paradigmBlockAmount;
+                    compressedImage.indices = full ? fullIndices : searchIndices;
+                    int check = ebrFindBestParadigmBlock(imageBlock, BPU_TEST_SEARCH_BLOCKS, paradigmBlock, &compressedImage, &options, NULL);
+                    int same = check == SUCCESS;
+                    for (int blockIndex = 0; blockIndex < BPU_TEST_SEARCH_BLOCKS && same; blockIndex++)
+                    {
+                        EbIndex found = compressedImage.indices[blockIndex / BPU_TEST_SEARCH_WIDTH][blockIndex % BPU_TEST_SEARCH_WIDTH];
+                        same = full ? found == (EbIndex)bpuTestNearest(&imageBlock[blockIndex], paradigmBlock, paradigmBlockAmount)
+                                    : found == fullIndices[blockIndex / BPU_TEST_SEARCH_WIDTH][blockIndex % BPU_TEST_SEARCH_WIDTH];
+                    }
+                    char what[96]; // What was compared, for the failure message
+                    snprintf(what, sizeof(what), "%s search of %d %s paradigm blocks, cache %s", searchNames[searches[searchIndex]], paradigmBlockAmount,
+                             tieHeavy ? "tie-heavy" : "random", cache == EBR_CACHE_ON ? "on" : "off");
+                    bpuTestCheck(same, what, "scalar", 5, BPU_TEST_SEARCH_BLOCKS);
+                }
+            }
+        }
+    }
+    if (imageBlock != NULL)
+    {
+        blockFreeArena(imageBlock);
+    }
+    if (paradigmBlock != NULL)
+    {
+        blockFreeArena(paradigmBlock);
+    }
+    ebFreeIndexBuffer(&fullBuffer);
+    ebFreeIndexBuffer(&searchBuffer);
+}
+
+int main(void)
+{
+    const char *tierNames[] = {"scalar", "SSSE3", "AVX2"}; // Indexed by BPU_TIER_SCALAR, BPU_TIER_SSSE3 and BPU_TIER_AVX2
+    FILE *file = tmpfile();                                 // The writers are checked through a real file
+    if (file == NULL)
+    {
+        printf("bpuTest: cannot create a temporary file\n");
+        return BAD_FILE;
+    }
+
+    bpuTestAgainstMasks();
+    bpuTestRowPackers();
+    bpuTestPackedRows(file);
+    bpuTestRans();
+    bpuTestCodedBlocks(file);
+    bpuTestSearches();
+    for (int tier = BPU_TIER_SCALAR; tier <= BPU_TIER_AVX2; tier++)
+    {
+        if (bpuUseKernels(tier) != SUCCESS)
+        {
+            printf("bpuTest: skipping the %s kernels, this CPU does not support them\n", tierNames[tier]);
+            continue;
+        }
+        bpuTestRows(tierNames[tier], file);
+        bpuTestLong(tierNames[tier], file);
+        bpuTestChunks(tierNames[tier]);
+    }
+    fclose(file);
+
+    printf("bpuTest: %ld checks, %ld failed\n", bpuTestChecks, bpuTestFailures);
+    return bpuTestFailures == 0 ? SUCCESS : BAD_DATA;
+}
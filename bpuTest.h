@@ -0,0 +1,32 @@
+#ifndef BPU_TEST_H
+#define BPU_TEST_H
+
+#include "bitPackUtils.h"
+#include "bitTwiddlingUtils.h"
+#include "ebcUtils.h"
+#include "ransUtils.h"
+#include "ebcrUtils.h"
+#include "ebUniversalUtils.h"
+
+#define BPU_TEST_MAX_LENGTH 4000       // Every row length from 0 to this is packed and unpacked at every width
+#define BPU_TEST_LONG_LENGTH 200003    // A row long enough to run through the 64 KiB buffers of a reader and a writer several times
+#define BPU_TEST_CHUNK_HEIGHT 701      // The height of the image the chunked reader is checked on, big enough for three chunks
+#define BPU_TEST_CHUNK_WIDTH 1123      // The width of that image, so the chunks split rows
+#define BPU_TEST_SEARCH_BLOCKS 2500    // The image blocks every paradigm search is checked on
+#define BPU_TEST_SEARCH_WIDTH 37       // The blocks in a row of that image, so the last row is cut short
+
+// The rows ebcWritePackedRows() is checked with, packed by bpuTestPackRow()
+typedef struct bpuTestRows{
+    const unsigned int *values; // The pixels of the image, row after row
+    int width;                  // How many pixels are in a row
+    int bitWidth;               // The bits of every pixel
+} BpuTestRows;
+
+// The mask-table codec the ebc format started out with, kept to check the packers against
+typedef struct bpuTestMask{
+    unsigned char mask; // The bits of the byte or pixel the step takes
+    int shift;          // How far they are shifted, right when positive and left when negative
+    int noBitsGathered; // How many bits the step takes
+} BpuTestMask;
+
+#endif
@@ -1,28 +1,33 @@
 #include "ebUniversalUtils.h"
+#include <ctype.h>
+#include <string.h>
+
+static int ebMessagesToStderr = 0; // Whether the image goes to stdout, so the messages have to go to stderr
 
 /**
- * Creates a 2D array of unsigned ints using only 2 mallocs
+ * Creates a 2D array of pixels using only 2 mallocs
  *
  * @param height The height of the 2D array
  * @param width The width of the 2D array
- * @return A 2D array of unsigned ints
+ * @return A 2D array of pixels
  * @return NULL if the malloc fails
  */
-unsigned int **ebCreate2DArray(int height, int width)
+Pixel **ebCreate2DArray(int height, int width)
 {
-    unsigned int **imageArray;                  // The 2D array to return
+    Pixel **imageArray;                         // The 2D array to return
     long numBytes = (long)height * (long)width; // Calculates the number of bytes needed for the 2D array
 
-    imageArray = (unsigned int **)malloc(height * sizeof(unsigned int *)); // Allocate memory for the rows of the 2D array
+    imageArray = (Pixel **)malloc(height * sizeof(Pixel *)); // Allocate memory for the rows of the 2D array
     if (imageArray == NULL)
     {
         return NULL; // return NULL if malloc failed
     }
 
-    unsigned int *imageArrayData = (unsigned int *)malloc(numBytes * sizeof(unsigned int)); // Allocate memory the individual elements of the 2D array
+    Pixel *imageArrayData = (Pixel *)malloc(numBytes * sizeof(Pixel)); // Allocate memory the individual elements of the 2D array
     if (imageArrayData == NULL)
     {
-        return NULL; // return NULL if malloc failed
+        free(imageArray); // Free the rows again
+        return NULL;      // return NULL if malloc failed
     }
 
     for (int i = 0; i < height; i++)
@@ -34,16 +39,176 @@ unsigned int **ebCreate2DArray(int height, int width)
 }
 
 /**
- * Frees a 2D array of unsigned ints that was created using ebCreate2DArray
+ * Frees a 2D array of pixels that was created using ebCreate2DArray
+ *
+ * @param array The 2D array to free
+ */
+void ebFree2DArray(Pixel **array)
+{
+    free(array[0]); // Free the 1D array
+    free(array);    // Free the 2D array
+}
+
+/**
+ * Prepares an empty buffer for ebReuse2DArray()
+ *
+ * @param buffer The buffer to prepare
+ */
+void ebInitBuffer(EbBuffer *buffer)
+{
+    buffer->rows = NULL;
+    buffer->pixels = NULL;
+    buffer->rowCapacity = 0;
+    buffer->pixelCapacity = 0;
+}
+
+/**
+ * Shapes a buffer into a 2D array of pixels, like ebCreate2DArray() but reusing the memory of the buffer
+ *
+ * The memory is only allocated again when the array does not fit in what the buffer already has,
+ * so a buffer used for image after image soon stops allocating at all. The pixels are not cleared.
+ *
+ * @param buffer The buffer to shape, prepared with ebInitBuffer()
+ * @param height The height of the 2D array
+ * @param width The width of the 2D array
+ * @return The rows of the 2D array, which stay valid until the buffer is shaped again or freed
+ * @return NULL if the malloc fails, in which case the buffer is left empty
+ */
+Pixel **ebReuse2DArray(EbBuffer *buffer, int height, int width)
+{
+    long pixelAmount = (long)height * (long)width; // The number of pixels needed
+    if (buffer->rows == NULL || height > buffer->rowCapacity || pixelAmount > buffer->pixelCapacity)
+    { // Grow the buffer to fit, dropping what it held
+        ebFreeBuffer(buffer);
+        buffer->rows = (Pixel **)malloc((size_t)height * sizeof(Pixel *));
+        buffer->pixels = (Pixel *)malloc((size_t)pixelAmount * sizeof(Pixel));
+        if (buffer->rows == NULL || buffer->pixels == NULL)
+        {
+            ebFreeBuffer(buffer);
+            return NULL; // return NULL if malloc failed
+        }
+        buffer->rowCapacity = height;
+        buffer->pixelCapacity = pixelAmount;
+    }
+
+    for (int i = 0; i < height; i++)
+    { // Point the rows at the pixels for this width
+        buffer->rows[i] = buffer->pixels + (long)i * width;
+    }
+    return buffer->rows;
+}
+
+/**
+ * Frees the memory of a buffer, leaving it empty
+ *
+ * @param buffer The buffer to free
+ */
+void ebFreeBuffer(EbBuffer *buffer)
+{
+    free(buffer->rows);
+    free(buffer->pixels);
+    ebInitBuffer(buffer);
+}
+
+/**
+ * Creates a 2D array of paradigm block indices using only 2 mallocs, like ebCreate2DArray()
+ *
+ * @param height The height of the 2D array
+ * @param width The width of the 2D array
+ * @return A 2D array of indices
+ * @return NULL if the malloc fails
+ */
+EbIndex **ebCreateIndexArray(int height, int width)
+{
+    EbIndex **indexArray = (EbIndex **)malloc((size_t)height * sizeof(EbIndex *)); // Allocate memory for the rows of the 2D array
+    if (indexArray == NULL)
+    {
+        return NULL; // return NULL if malloc failed
+    }
+
+    EbIndex *indexArrayData = (EbIndex *)malloc((size_t)height * (size_t)width * sizeof(EbIndex)); // Allocate memory the individual elements of the 2D array
+    if (indexArrayData == NULL)
+    {
+        free(indexArray); // Free the rows again
+        return NULL;      // return NULL if malloc failed
+    }
+
+    for (int i = 0; i < height; i++)
+    { // Point the rows at the indices
+        indexArray[i] = indexArrayData + (long)i * width;
+    }
+    return indexArray;
+}
+
+/**
+ * Frees a 2D array of indices that was created using ebCreateIndexArray
  *
  * @param array The 2D array to free
  */
-void ebFree2DArray(unsigned int **array)
+void ebFreeIndexArray(EbIndex **array)
 {
     free(array[0]); // Free the 1D array
     free(array);    // Free the 2D array
 }
 
+/**
+ * Prepares an empty buffer for ebReuseIndexArray()
+ *
+ * @param buffer The buffer to prepare
+ */
+void ebInitIndexBuffer(EbIndexBuffer *buffer)
+{
+    buffer->rows = NULL;
+    buffer->indices = NULL;
+    buffer->rowCapacity = 0;
+    buffer->indexCapacity = 0;
+}
+
+/**
+ * Shapes a buffer into a 2D array of indices, like ebReuse2DArray() does for pixels
+ *
+ * @param buffer The buffer to shape, prepared with ebInitIndexBuffer()
+ * @param height The height of the 2D array
+ * @param width The width of the 2D array
+ * @return The rows of the 2D array, which stay valid until the buffer is shaped again or freed
+ * @return NULL if the malloc fails, in which case the buffer is left empty
+ */
+EbIndex **ebReuseIndexArray(EbIndexBuffer *buffer, int height, int width)
+{
+    long indexAmount = (long)height * (long)width; // The number of indices needed
+    if (buffer->rows == NULL || height > buffer->rowCapacity || indexAmount > buffer->indexCapacity)
+    { // Grow the buffer to fit, dropping what it held
+        ebFreeIndexBuffer(buffer);
+        buffer->rows = (EbIndex **)malloc((size_t)height * sizeof(EbIndex *));
+        buffer->indices = (EbIndex *)malloc((size_t)indexAmount * sizeof(EbIndex));
+        if (buffer->rows == NULL || buffer->indices == NULL)
+        {
+            ebFreeIndexBuffer(buffer);
+            return NULL; // return NULL if malloc failed
+        }
+        buffer->rowCapacity = height;
+        buffer->indexCapacity = indexAmount;
+    }
+
+    for (int i = 0; i < height; i++)
+    { // Point the rows at the indices for this width
+        buffer->rows[i] = buffer->indices + (long)i * width;
+    }
+    return buffer->rows;
+}
+
+/**
+ * Frees the memory of an index buffer, leaving it empty
+ *
+ * @param buffer The buffer to free
+ */
+void ebFreeIndexBuffer(EbIndexBuffer *buffer)
+{
+    free(buffer->rows);
+    free(buffer->indices);
+    ebInitIndexBuffer(buffer);
+}
+
 /**
  * Reads the header of an eb file and checks that it is valid
  *
@@ -66,12 +231,105 @@ int ebReadHeader(FILE *fp, Image *image, int expectedMagicNumber)
         return BAD_MAGIC_NUMBER; // If the magic number is different, return an error code
     }
 
+    return ebReadDimensions(fp, image); // Read the rest of the header
+}
+
+/**
+ * Reads the width and height that follow the magic number of an eb file and checks that they are valid
+ *
+ * @param fp The file pointer to the file to read, just past the magic number
+ * @param image The image struct to store the dimensions in
+ * @return 0 if the dimensions are valid else BAD_DIM
+ */
+int ebReadDimensions(FILE *fp, Image *image)
+{
     // Read and validate the width and height
     fscanf(fp, "%d %d", &image->height, &image->width); // Read in the width and height
     if (image->width < MIN_DIMENSION || image->width > MAX_DIMENSION || image->height < MIN_DIMENSION || image->height > MAX_DIMENSION)
     {                   // Check that the width and height are valid
         return BAD_DIM; // If width or height are not valid, return an error code
     }
+    return SUCCESS; // If we get here, the dimensions are valid and we return success
+}
+
+/**
+ * Parses a decimal integer the way fscanf's %d does, skipping leading whitespace
+ *
+ * @param bytes The bytes to parse
+ * @param size The number of bytes available
+ * @param offset The position to start at, moved past the integer
+ * @param value Where to store the integer
+ * @return 0 if an integer was parsed else BAD_DIM
+ */
+int ebParseInt(const unsigned char *bytes, long size, long *offset, int *value)
+{
+    long position = *offset;
+    while (position < size && isspace(bytes[position]))
+    { // Skip whitespace like fscanf does
+        position++;
+    }
+    int negative = 0;
+    if (position < size && (bytes[position] == '-' || bytes[position] == '+'))
+    { // Take an optional sign
+        negative = bytes[position] == '-';
+        position++;
+    }
+    if (position >= size || !isdigit(bytes[position]))
+    { // There has to be at least one digit
+        return BAD_DIM;
+    }
+    long long number = 0;
+    while (position < size && isdigit(bytes[position]))
+    {
+        if (number <= MAX_DIMENSION)
+        { // Stop growing once the number can only be a bad dimension so it cannot overflow
+            number = number * 10 + (bytes[position] - '0');
+        }
+        position++;
+    }
+    *value = (int)(negative ? -number : number);
+    *offset = position;
+    return SUCCESS;
+}
+
+/**
+ * Parses the header of an eb file held in memory and checks that it is valid
+ *
+ * Accepts exactly what ebReadHeader() accepts from a file.
+ *
+ * @param bytes The bytes of the file
+ * @param size The number of bytes in the file
+ * @param image The image struct to store the header information in
+ * @param expectedMagicNumber The magic number that the file should have
+ * @param headerLength Where to store the number of bytes the header takes up
+ * @return 0 if the header is valid else an error code
+ */
+int ebParseHeader(const unsigned char *bytes, long size, Image *image, int expectedMagicNumber, long *headerLength)
+{
+    // Read in the magic number
+    if (size < 2)
+    { // The file is too short to hold a magic number
+        return BAD_MAGIC_NUMBER;
+    }
+    image->magicNumber[0] = bytes[0];
+    image->magicNumber[1] = bytes[1];
+    unsigned short *magicNumberValue = (unsigned short *)image->magicNumber; // Cast the magic number to an unsigned short
+    if (*magicNumberValue != expectedMagicNumber)
+    {                            // Check against the casted magic number and the expected magic number
+        return BAD_MAGIC_NUMBER; // If the magic number is different, return an error code
+    }
+
+    // Read and validate the width and height
+    long offset = 2;
+    if (ebParseInt(bytes, size, &offset, &image->height) != SUCCESS || ebParseInt(bytes, size, &offset, &image->width) != SUCCESS)
+    { // Check that both dimensions are there
+        return BAD_DIM;
+    }
+    if (image->width < MIN_DIMENSION || image->width > MAX_DIMENSION || image->height < MIN_DIMENSION || image->height > MAX_DIMENSION)
+    {                   // Check that the width and height are valid
+        return BAD_DIM; // If width or height are not valid, return an error code
+    }
+    *headerLength = offset;
     return SUCCESS; // If we get here, the header is valid and we return success
 }
 
@@ -177,56 +435,145 @@ int ebCompare(Image *image1, Image *image2)
 }
 
 /**
- * Prints the error message for the given error code
+ * Writes the error message for the given error code into a string
  *
- * @param errorCode The error code to print the message for
+ * @param errorCode The error code to write the message for
  * @param filename The name of the file that caused the error
- * @return The error code that was passed in
+ * @param message Where to write the message, without a newline
+ * @param size The number of chars message has room for, EB_MESSAGE_SIZE fits every message
+ * @return The error code that was passed in, -1 if it is unknown
  */
-int ebErrorHandle(int errorCode, char *filename)
+int ebErrorMessage(int errorCode, char *filename, char *message, int size)
 {
-    // Switch on the error code and print the appropriate error message
+    // Switch on the error code and write the appropriate error message
     switch (errorCode)
     {
     case SUCCESS: // Incase this function is called with a success code, we notify the developer that something is wrong
-        printf("If you see this output, you coded something wrong\n");
+        snprintf(message, size, "If you see this output, you coded something wrong");
         return SUCCESS;
-        break;
     case BAD_ARGS:
-        printf("ERROR: Bad Arguments\n");
+        snprintf(message, size, "ERROR: Bad Arguments");
         return BAD_ARGS;
-        break;
     case BAD_FILE:
-        printf("ERROR: Bad File Name (%s)\n", filename);
+        snprintf(message, size, "ERROR: Bad File Name (%s)", filename);
         return BAD_FILE;
-        break;
     case BAD_MAGIC_NUMBER:
-        printf("ERROR: Bad Magic Number (%s)\n", filename);
+        snprintf(message, size, "ERROR: Bad Magic Number (%s)", filename);
         return BAD_MAGIC_NUMBER;
-        break;
     case BAD_DIM:
-        printf("ERROR: Bad Dimensions (%s)\n", filename);
+        snprintf(message, size, "ERROR: Bad Dimensions (%s)", filename);
         return BAD_DIM;
-        break;
     case BAD_MALLOC:
-        printf("ERROR: Image Malloc Failed\n");
+        snprintf(message, size, "ERROR: Image Malloc Failed");
         return BAD_MALLOC;
-        break;
     case BAD_DATA:
-        printf("ERROR: Bad Data (%s)\n", filename);
+        snprintf(message, size, "ERROR: Bad Data (%s)", filename);
         return BAD_DATA;
-        break;
     case BAD_OUTPUT:
-        printf("ERROR: Bad Output\n");
+        snprintf(message, size, "ERROR: Bad Output");
         return BAD_OUTPUT;
-        break;
     case BAD_BLOCK_MALLOC:
-        printf("ERROR: Block Malloc Failed\n");
+        snprintf(message, size, "ERROR: Block Malloc Failed");
         return BAD_BLOCK_MALLOC;
-        break;
+    case BAD_PARADIGM_GENERATION:
+        snprintf(message, size, "Error: Paradigm block generation failed");
+        return BAD_PARADIGM_GENERATION;
     default:
-        printf("ERROR: Unknown Error\n");
+        snprintf(message, size, "ERROR: Unknown Error");
         return -1;
-        break;
     }
+}
+
+/**
+ * Prints the error message for the given error code
+ *
+ * @param errorCode The error code to print the message for
+ * @param filename The name of the file that caused the error
+ * @return The error code that was passed in
+ */
+int ebErrorHandle(int errorCode, char *filename)
+{
+    char message[EB_MESSAGE_SIZE]; // The error message
+    int check = ebErrorMessage(errorCode, filename, message, EB_MESSAGE_SIZE);
+    fprintf(ebMessageStream(), "%s\n", message);
+    return check;
+}
+
+/**
+ * Checks if a file name stands for stdin or stdout rather than a file
+ *
+ * @param filename The name of the file
+ * @return 1 if the name is EB_STANDARD_STREAM else 0
+ */
+int ebIsStandardStream(const char *filename)
+{
+    return filename != NULL && strcmp(filename, EB_STANDARD_STREAM) == 0;
+}
+
+/**
+ * Opens a file like fopen, except that EB_STANDARD_STREAM opens stdin for reading or stdout for writing
+ *
+ * @param filename The name of the file
+ * @param mode The mode to open the file with, as for fopen
+ * @return The file pointer; NULL if the file cannot be opened
+ */
+FILE *ebOpenFile(char *filename, char *mode)
+{
+    if (ebIsStandardStream(filename))
+    { // The standard streams are already open
+        return mode[0] == 'r' ? stdin : stdout;
+    }
+    return fopen(filename, mode);
+}
+
+/**
+ * Closes a file opened with ebOpenFile, stdin and stdout are only flushed so they stay open
+ *
+ * @param fp The file pointer to close
+ * @return 0 if everything written reached the file else EOF
+ */
+int ebCloseFile(FILE *fp)
+{
+    if (fp == stdin)
+    { // Nothing to write out
+        return 0;
+    }
+    if (fp == stdout)
+    { // Make sure everything reached whatever reads stdout
+        return fflush(fp);
+    }
+    return fclose(fp);
+}
+
+/**
+ * Removes a partly written output file, a standard stream cannot be taken back so it is left alone
+ *
+ * @param filename The name of the file
+ */
+void ebRemoveFile(char *filename)
+{
+    if (!ebIsStandardStream(filename))
+    {
+        remove(filename);
+    }
+}
+
+/**
+ * Picks where the messages of a program go, stdout unless the program writes its image there
+ *
+ * @param outputFilename The name of the file the program writes
+ */
+void ebSetMessageStream(char *outputFilename)
+{
+    ebMessagesToStderr = ebIsStandardStream(outputFilename);
+}
+
+/**
+ * Gets the stream the messages of a program go to, picked with ebSetMessageStream
+ *
+ * @return stderr if the image goes to stdout else stdout
+ */
+FILE *ebMessageStream(void)
+{
+    return ebMessagesToStderr ? stderr : stdout;
 }
\ No newline at end of file
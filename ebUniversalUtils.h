@@ -10,23 +10,71 @@
 #define EBUNIVERSALUTILS_H
 
 #include "ebConstants.h"
+#include <stdint.h>
+
+#define EB_MESSAGE_SIZE 4352 // Room for any error message, including a file name as long as a path can be
+#define EB_STANDARD_STREAM "-" // The file name that stands for stdin when reading and stdout when writing
+
+// Pixels are 0-31, so a byte holds one.
+// Build with -DEB_WIDE_PIXELS to store them as 32 bit values instead.
+#ifdef EB_WIDE_PIXELS
+typedef uint32_t Pixel;
+#else
+typedef uint8_t Pixel;
+#endif
+
+// Paradigm block indices are 0-4095, so they are kept apart from pixels in 16 bits.
+typedef uint16_t EbIndex;
 
 typedef struct ebImage{
     unsigned char magicNumber[2]; // Char array to store the magic number
     int width; // Width of the image
     int height; // Height of the image
-    unsigned int **data; // 2D array to store the image data
-    unsigned int **paradigm; // 2D array to store the paradigm data
+    Pixel **data; // 2D array to store the image data
+    Pixel **paradigm; // 2D array to store the paradigm data
+    EbIndex **indices; // 2D array to store the paradigm block index of every block of a compressed image
     int paradigmBlockAmount; // Amount of paradigm blocks
 } Image;
 
+typedef struct ebBuffer{
+    Pixel **rows;       // The rows of the 2D array, pointing into pixels
+    Pixel *pixels;      // The pixels of every row one after another
+    int rowCapacity;    // How many rows there is room for
+    long pixelCapacity; // How many pixels there is room for
+} EbBuffer;
+
+typedef struct ebIndexBuffer{
+    EbIndex **rows;     // The rows of the 2D array, pointing into indices
+    EbIndex *indices;   // The indices of every row one after another
+    int rowCapacity;    // How many rows there is room for
+    long indexCapacity; // How many indices there is room for
+} EbIndexBuffer;
+
 // function prototypes
-unsigned int ** ebCreate2DArray(int height, int width);
-void ebFree2DArray(unsigned int **array);
+Pixel ** ebCreate2DArray(int height, int width);
+void ebFree2DArray(Pixel **array);
+void ebInitBuffer(EbBuffer * buffer);
+Pixel ** ebReuse2DArray(EbBuffer * buffer, int height, int width);
+void ebFreeBuffer(EbBuffer * buffer);
+EbIndex ** ebCreateIndexArray(int height, int width);
+void ebFreeIndexArray(EbIndex **array);
+void ebInitIndexBuffer(EbIndexBuffer * buffer);
+EbIndex ** ebReuseIndexArray(EbIndexBuffer * buffer, int height, int width);
+void ebFreeIndexBuffer(EbIndexBuffer * buffer);
 int ebReadHeader(FILE * fp, Image * image, int expectedMagicNumber);
+int ebReadDimensions(FILE * fp, Image * image);
+int ebParseInt(const unsigned char * bytes, long size, long * offset, int * value);
+int ebParseHeader(const unsigned char * bytes, long size, Image * image, int expectedMagicNumber, long * headerLength);
 int ebWriteHeader(FILE * fp, Image * image, int expectedMagicNumber);
 void ebCheckArgs(int argc, char * scriptName);
 int ebCompare(Image * image1, Image * image2);
+int ebErrorMessage(int errorCode, char * filename, char * message, int size);
 int ebErrorHandle(int errorCode, char * filename);
+int ebIsStandardStream(const char * filename);
+FILE * ebOpenFile(char * filename, char * mode);
+int ebCloseFile(FILE * fp);
+void ebRemoveFile(char * filename);
+void ebSetMessageStream(char * outputFilename);
+FILE * ebMessageStream(void);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,540 @@
+#define _POSIX_C_SOURCE 200809L // For getline() and open_memstream()
+
+#include "ebcBatch.h"
+
+/**
+ * This function finds the next field of a manifest line, ending it with a null character.
+ *
+ * @param cursor Where to start looking, moved past the field
+ * @return The field; NULL if the line has no more fields
+ */
+static char *batchNextField(char **cursor)
+{
+    char *field = *cursor; // The start of the field
+    while (*field != '\0' && isspace((unsigned char)*field))
+    { // Skip the spaces before the field
+        field++;
+    }
+    if (*field == '\0')
+    {
+        return NULL;
+    }
+    char *end = field; // One past the end of the field
+    while (*end != '\0' && !isspace((unsigned char)*end))
+    {
+        end++;
+    }
+    *cursor = *end != '\0' ? end + 1 : end;
+    *end = '\0';
+    return field;
+}
+
+/**
+ * This function reads one line of the manifest into a job.
+ *
+ * A line is the name of a program followed by its arguments, as it would be run on its own:
+ * <program> <input file> <output file> [<seed>], with a seed for ebcR32, ebcR128 and ebcR only.
+ * The jobs run at the same time, so they cannot share stdin and stdout through EB_STANDARD_STREAM.
+ *
+ * @param line The line, which the job keeps pointers into
+ * @param job The job to fill in, its program is BATCH_BAD_LINE if the line cannot be read
+ */
+static void batchParseLine(char *line, BatchJob *job)
+{
+    static const char *programNames[] = {"ebcBlock", "ebcUnblock", "ebcR32", "ebcU32", "ebcR128", "ebcU128", "ebcR", "ebcU"}; // Indexed by the BATCH constants
+    char *cursor = line;                       // How far through the line the fields have been read
+    char *programName = batchNextField(&cursor); // The first field names the program
+    job->inputFilename = batchNextField(&cursor);
+    job->outputFilename = batchNextField(&cursor);
+    char *seedField = batchNextField(&cursor);
+    job->program = BATCH_BAD_LINE;
+    job->seed = 0;
+    if (programName == NULL || job->outputFilename == NULL || batchNextField(&cursor) != NULL)
+    { // Too few or too many fields
+        return;
+    }
+    if (ebIsStandardStream(job->inputFilename) || ebIsStandardStream(job->outputFilename))
+    { // Only the manifest can come from stdin
+        return;
+    }
+    for (int program = BATCH_BLOCK; program <= BATCH_U; program++)
+    {
+        if (strcmp(programName, programNames[program]) == 0)
+        {
+            job->program = program;
+        }
+    }
+
+    int compressesWithSeed = job->program == BATCH_R32 || job->program == BATCH_R128 || job->program == BATCH_R; // Whether the program takes a seed
+    if (compressesWithSeed != (seedField != NULL))
+    { // Only the programs that pick paradigm blocks take a seed
+        job->program = BATCH_BAD_LINE;
+    }
+    else if (seedField != NULL)
+    {
+        job->seed = atoi(seedField); // Read the seed the same way the programs do
+    }
+}
+
+/**
+ * This function runs one job with the workspace of the worker running it.
+ *
+ * A job whose input was read ahead is run from memory, with its output kept in memory for the I/O thread
+ * to write. Any other job opens its files by name. Either way the job first waits for every job before it
+ * that writes its input, writes its output or reads its output.
+ *
+ * @param queue The jobs and how they are run
+ * @param jobIndex The job to run, its check and failed file name are filled in
+ * @param workspace The memory of the worker
+ */
+static void batchRunJob(BatchQueue *queue, int jobIndex, EbcWorkspace *workspace)
+{
+    BatchJob *job = &queue->jobs[jobIndex];  // The job to run
+    EbrOptions jobOptions = *queue->options; // The options with the number of paradigm blocks of the program
+    char *output = NULL;                     // The output kept in memory, allocated by open_memstream()
+    size_t outputSize = 0;                   // The bytes of the output
+    job->failedFilename = job->inputFilename;
+    for (int waitIndex = 0; waitIndex < job->waitAmount; waitIndex++)
+    { // The input is only there, and the output only free to write, once these jobs are done
+        ebiAwaitOutput(queue->io, job->waits[waitIndex]);
+    }
+    if (ebiAwaitInput(queue->io, jobIndex) == EBI_LOADED)
+    {
+        workspace->output = open_memstream(&output, &outputSize);
+        if (workspace->output != NULL)
+        {
+            workspace->input = queue->io->files[jobIndex].input;
+            workspace->inputSize = queue->io->files[jobIndex].inputSize;
+        }
+        else
+        { // Without memory for the output the job opens its files by name
+            ebiReleaseInput(queue->io, jobIndex);
+        }
+    }
+
+    switch (job->program)
+    {
+    case BATCH_BLOCK:
+        job->check = ebbCompress(job->inputFilename, job->outputFilename, workspace, &job->failedFilename);
+        break;
+    case BATCH_UNBLOCK:
+        job->check = ebbDecompress(job->inputFilename, job->outputFilename, workspace, &job->failedFilename);
+        break;
+    case BATCH_R32:
+        jobOptions.paradigmBlockAmount = 32;
+        job->check = ebrCompress(job->inputFilename, job->outputFilename, job->seed, &jobOptions, MAGIC_NUMBER_EBCR32, workspace, &job->failedFilename);
+        break;
+    case BATCH_R128:
+        jobOptions.paradigmBlockAmount = 128;
+        job->check = ebrCompress(job->inputFilename, job->outputFilename, job->seed, &jobOptions, MAGIC_NUMBER_EBCR128, workspace, &job->failedFilename);
+        break;
+    case BATCH_R:
+        job->check = ebrCompress(job->inputFilename, job->outputFilename, job->seed, &jobOptions, MAGIC_NUMBER_EBCR, workspace, &job->failedFilename);
+        break;
+    case BATCH_U32:
+        job->check = ebrDecompress(job->inputFilename, job->outputFilename, MAGIC_NUMBER_EBCR32, workspace, &job->failedFilename);
+        break;
+    case BATCH_U128:
+        job->check = ebrDecompress(job->inputFilename, job->outputFilename, MAGIC_NUMBER_EBCR128, workspace, &job->failedFilename);
+        break;
+    case BATCH_U: // Decompress whichever R family type the file is
+        job->check = ebrDecompress(job->inputFilename, job->outputFilename, MAGIC_NUMBER_EBCR_FAMILY, workspace, &job->failedFilename);
+        break;
+    default:
+        job->check = BAD_ARGS; // The line could not be read
+        break;
+    }
+
+    if (workspace->output != NULL)
+    {
+        int closeCheck = fclose(workspace->output) == 0 ? SUCCESS : BAD_OUTPUT; // Closing the stream finishes the output
+        workspace->output = NULL;
+        workspace->input = NULL;
+        ebiReleaseInput(queue->io, jobIndex);
+        if (job->check == SUCCESS && closeCheck != SUCCESS)
+        {
+            job->check = closeCheck;
+            job->failedFilename = job->outputFilename;
+        }
+        if (job->check != SUCCESS)
+        { // Nothing is written for a job that failed
+            free(output);
+            output = NULL;
+        }
+    }
+    ebiPutOutput(queue->io, jobIndex, (unsigned char *)output, (long)outputSize);
+}
+
+/**
+ * This function is run by every worker of the batch.
+ *
+ * The workers share one counter of the jobs that are left and each takes the next job whenever it is
+ * free, so a worker stuck on a large file never holds up the others. A job only ever waits for jobs
+ * before it, which have all been taken, so the workers cannot wait on each other in a circle. The
+ * workspace of the worker is kept from job to job.
+ *
+ * @param argument The BatchWorker of the thread
+ * @return NULL
+ */
+static void *batchWorkerRun(void *argument)
+{
+    BatchWorker *worker = (BatchWorker *)argument;
+    BatchQueue *queue = worker->queue;
+    for (;;)
+    {
+        pthread_mutex_lock(&queue->lock);
+        int jobIndex = queue->nextJob++; // The job this worker takes
+        pthread_mutex_unlock(&queue->lock);
+        if (jobIndex >= queue->jobAmount)
+        {
+            break; // Every job has been taken
+        }
+        batchRunJob(queue, jobIndex, &worker->workspace);
+    }
+    return NULL;
+}
+
+/**
+ * This function orders the output files of jobs by name for qsort(), then by job.
+ *
+ * @param first The first output file, as a BatchName
+ * @param second The second output file, as a BatchName
+ * @return Less than, equal to or more than 0 if the first output file goes before, with or after the second
+ */
+static int batchCompareNames(const void *first, const void *second)
+{
+    const BatchName *firstName = (const BatchName *)first;
+    const BatchName *secondName = (const BatchName *)second;
+    int order = strcmp(firstName->filename, secondName->filename);
+    if (order != 0)
+    {
+        return order;
+    }
+    return firstName->jobIndex - secondName->jobIndex;
+}
+
+/**
+ * This function finds where a file of a job would go among files sorted by batchCompareNames().
+ *
+ * @param names The sorted files
+ * @param nameAmount The number of files
+ * @param filename The file
+ * @param jobIndex The job
+ * @return The first of the sorted files that does not go before the file of the job
+ */
+static int batchFindName(const BatchName *names, int nameAmount, char *filename, int jobIndex)
+{
+    BatchName key = {filename, jobIndex}; // The file, as it would be sorted
+    int low = 0;                          // The first file that may not go before the key
+    int high = nameAmount;                // One past the last
+    while (low < high)
+    {
+        int middle = low + (high - low) / 2;
+        if (batchCompareNames(&names[middle], &key) < 0)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+/**
+ * This function finds, for every job, the jobs before it that it has to wait for.
+ *
+ * A job waits for the last job before it that writes its input (read after write), the last job before
+ * it that writes its output (write after write) and every job since then that reads its output (write
+ * after read). Jobs before that last writer are covered, as it waited for them in turn, so every job
+ * is waited for by at most three others. A job with a producer cannot read its input ahead. The files
+ * are sorted once, so the search stays quick for a manifest of many thousands of jobs.
+ *
+ * @param jobs The jobs, whose producer and waits are filled in
+ * @param jobAmount The number of jobs
+ * @param waits Where to store the memory the waits of every job point into
+ * @return 0 on success; BAD_MALLOC if memory allocation fails
+ */
+static int batchFindHazards(BatchJob *jobs, int jobAmount, int **waits)
+{
+    size_t slots = (size_t)(jobAmount > 0 ? jobAmount : 1); // Room for one entry per job
+    BatchName *outputs = (BatchName *)malloc(sizeof(BatchName) * slots); // The output file of every job
+    BatchName *inputs = (BatchName *)malloc(sizeof(BatchName) * slots);  // The input file of every job
+    *waits = (int *)malloc(sizeof(int) * 3 * slots);
+    if (outputs == NULL || inputs == NULL || *waits == NULL)
+    {
+        free(outputs);
+        free(inputs);
+        free(*waits);
+        *waits = NULL;
+        return BAD_MALLOC;
+    }
+    int nameAmount = 0; // The files in outputs and in inputs
+    for (int jobIndex = 0; jobIndex < jobAmount; jobIndex++)
+    {
+        jobs[jobIndex].producer = -1;
+        jobs[jobIndex].waits = *waits;
+        jobs[jobIndex].waitAmount = 0;
+        if (jobs[jobIndex].program != BATCH_BAD_LINE)
+        {
+            outputs[nameAmount].filename = jobs[jobIndex].outputFilename;
+            outputs[nameAmount].jobIndex = jobIndex;
+            inputs[nameAmount].filename = jobs[jobIndex].inputFilename;
+            inputs[nameAmount].jobIndex = jobIndex;
+            nameAmount++;
+        }
+    }
+    qsort(outputs, nameAmount, sizeof(BatchName), batchCompareNames);
+    qsort(inputs, nameAmount, sizeof(BatchName), batchCompareNames);
+
+    int waitAmount = 0; // The waits stored so far
+    for (int jobIndex = 0; jobIndex < jobAmount; jobIndex++)
+    {
+        BatchJob *job = &jobs[jobIndex];
+        job->waits = *waits + waitAmount;
+        if (job->program == BATCH_BAD_LINE)
+        {
+            continue;
+        }
+        int place = batchFindName(outputs, nameAmount, job->inputFilename, jobIndex); // Just after the last job before this one writing its input
+        if (place > 0 && strcmp(outputs[place - 1].filename, job->inputFilename) == 0)
+        {
+            job->producer = outputs[place - 1].jobIndex;
+            job->waits[job->waitAmount++] = job->producer;
+        }
+        int writer = -1; // The last job before this one that writes its output
+        place = batchFindName(outputs, nameAmount, job->outputFilename, jobIndex);
+        if (place > 0 && strcmp(outputs[place - 1].filename, job->outputFilename) == 0)
+        {
+            writer = outputs[place - 1].jobIndex;
+            if (writer != job->producer)
+            {
+                job->waits[job->waitAmount++] = writer;
+            }
+        }
+        int last = batchFindName(inputs, nameAmount, job->outputFilename, jobIndex); // Just after the last job before this one reading its output
+        for (place = batchFindName(inputs, nameAmount, job->outputFilename, writer + 1); place < last; place++)
+        { // Every job reading the output since it was last written
+            job->waits[job->waitAmount++] = inputs[place].jobIndex;
+        }
+        waitAmount += job->waitAmount;
+    }
+    free(outputs);
+    free(inputs);
+    return SUCCESS;
+}
+
+/**
+ * This function reads every job of a manifest.
+ *
+ * Empty lines and lines starting with # are skipped.
+ *
+ * @param filename The name of the manifest, EB_STANDARD_STREAM for stdin
+ * @param lines Where to store the lines of the manifest, which the jobs point into
+ * @param lineAmount Where to store the number of lines
+ * @param jobs Where to store the jobs
+ * @param jobAmount Where to store the number of jobs
+ * @return 0 on success; BAD_FILE if the manifest cannot be opened; BAD_MALLOC if memory allocation fails
+ */
+static int batchReadManifest(char *filename, char ***lines, int *lineAmount, BatchJob **jobs, int *jobAmount)
+{
+    FILE *fp = ebOpenFile(filename, "r");
+    if (fp == NULL)
+    { // Check if the file opened
+        return BAD_FILE;
+    }
+
+    *lines = NULL;
+    *lineAmount = 0;
+    *jobs = NULL;
+    *jobAmount = 0;
+    int capacity = 0;   // How many lines and jobs there is room for
+    char *line = NULL;  // The line being read, allocated by getline()
+    size_t lineSize = 0; // The size of the memory of the line
+    int check = SUCCESS;
+    while (check == SUCCESS && getline(&line, &lineSize, fp) != -1)
+    {
+        if (*lineAmount == capacity)
+        { // Make room for more lines
+            capacity = capacity > 0 ? capacity * 2 : 64;
+            char **moreLines = (char **)realloc(*lines, sizeof(char *) * (size_t)capacity);
+            if (moreLines != NULL)
+            {
+                *lines = moreLines;
+            }
+            BatchJob *moreJobs = moreLines != NULL ? (BatchJob *)realloc(*jobs, sizeof(BatchJob) * (size_t)capacity) : NULL;
+            if (moreJobs == NULL)
+            {
+                check = BAD_MALLOC;
+                break;
+            }
+            *jobs = moreJobs;
+        }
+        (*lines)[(*lineAmount)++] = line; // The line is kept, the jobs point into it
+
+        char *start = line; // The first character of the line that is not a space
+        while (*start != '\0' && isspace((unsigned char)*start))
+        {
+            start++;
+        }
+        if (*start != '\0' && *start != '#')
+        { // Every other line is a job
+            (*jobs)[*jobAmount].lineNumber = *lineAmount;
+            batchParseLine(start, &(*jobs)[*jobAmount]);
+            (*jobAmount)++;
+        }
+        line = NULL;
+        lineSize = 0;
+    }
+    free(line);
+    ebCloseFile(fp);
+    return check;
+}
+
+int main(int argc, char **argv)
+{
+    // Check the arguments
+    if (argc == 1)
+    {
+        printf("Usage: ebcBatch <manifest> <workers> [--io <uring|plain|off>] [--threads <count>] [--search <full|pruned|table|tree>] [--cache <on|off|stats>] [--paradigms <count>] [--index <packed|rans>]\n");
+        return SUCCESS;
+    }
+    char *end = NULL;                                    // Where the worker count stops being a number
+    long workerAmount = argc > 2 ? strtol(argv[2], &end, 10) : 0; // The number of worker threads
+    EbrOptions options;                                  // How the R family jobs search
+    int ioMode = EBI_MODE_URING;                         // How the files of the jobs are read and written
+    char **optionArgv = (char **)malloc(sizeof(char *) * (size_t)argc); // The arguments without --io, for ebrParseOptions()
+    int optionArgc = 0;                                  // The number of arguments in optionArgv
+    int badIo = 0;                                       // Whether --io was given something it does not know
+    for (int argIndex = 0; optionArgv != NULL && argIndex < argc; argIndex++)
+    {
+        if (argIndex >= 3 && strcmp(argv[argIndex], "--io") == 0 && argIndex + 1 < argc)
+        { // The batch takes --io itself, every other option is for the R family jobs
+            argIndex++;
+            ioMode = strcmp(argv[argIndex], "uring") == 0 ? EBI_MODE_URING : strcmp(argv[argIndex], "plain") == 0 ? EBI_MODE_PLAIN : EBI_MODE_OFF;
+            badIo = badIo || (ioMode == EBI_MODE_OFF && strcmp(argv[argIndex], "off") != 0);
+            continue;
+        }
+        optionArgv[optionArgc++] = argv[argIndex];
+    }
+    if (optionArgv == NULL)
+    {
+        return ebErrorHandle(BAD_MALLOC, argv[1]);
+    }
+    if (argc < 3 || end == argv[2] || *end != '\0' || workerAmount < 1 || workerAmount > BATCH_MAX_WORKERS || badIo ||
+        ebrParseOptions(optionArgc, optionArgv, 3, 0, &options) != SUCCESS)
+    {
+        free(optionArgv);
+        printf("ERROR: Bad Arguments\n");
+        return BAD_ARGS;
+    }
+    free(optionArgv);
+
+    // Read the manifest
+    char **lines = NULL;  // The lines of the manifest
+    int lineAmount = 0;   // The number of lines
+    BatchQueue queue;     // The jobs shared by the workers
+    EbiFile *files = NULL; // The files of every job, for reading ahead and writing behind
+    int *waits = NULL;     // The jobs every job waits for
+    int check = batchReadManifest(argv[1], &lines, &lineAmount, &queue.jobs, &queue.jobAmount);
+    BatchWorker *worker = check == SUCCESS ? (BatchWorker *)malloc(sizeof(BatchWorker) * (size_t)workerAmount) : NULL; // The state of every worker
+    if (check == SUCCESS)
+    {
+        files = (EbiFile *)malloc(sizeof(EbiFile) * (size_t)(queue.jobAmount > 0 ? queue.jobAmount : 1));
+        check = worker == NULL || files == NULL ? BAD_MALLOC : batchFindHazards(queue.jobs, queue.jobAmount, &waits);
+    }
+    if (check != SUCCESS)
+    {
+        for (int lineIndex = 0; lineIndex < lineAmount; lineIndex++)
+        {
+            free(lines[lineIndex]);
+        }
+        free(lines);
+        free(queue.jobs);
+        free(worker);
+        free(files);
+        return ebErrorHandle(check, argv[1]);
+    }
+
+    // Start reading the inputs ahead, except those another job writes first
+    for (int jobIndex = 0; jobIndex < queue.jobAmount; jobIndex++)
+    {
+        BatchJob *job = &queue.jobs[jobIndex];
+        files[jobIndex].inputFilename = job->program != BATCH_BAD_LINE && job->producer < 0 ? job->inputFilename : NULL;
+        files[jobIndex].outputFilename = job->outputFilename;
+    }
+    EbiContext io; // Reads the inputs ahead and writes the outputs behind
+    ebiStart(&io, files, queue.jobAmount, ioMode);
+
+    // Run the jobs, the calling thread is worker 0
+    queue.nextJob = 0;
+    queue.options = &options;
+    queue.io = &io;
+    pthread_mutex_init(&queue.lock, NULL);
+    int threadsStarted = 0; // The number of extra workers that are running
+    for (int workerIndex = 0; workerIndex < workerAmount; workerIndex++)
+    {
+        worker[workerIndex].queue = &queue;
+        ebcInitWorkspace(&worker[workerIndex].workspace);
+        worker[workerIndex].workspace.threadAmount = options.threadAmount; // The decompressors pack with as many threads as the search uses
+    }
+    for (int workerIndex = 1; workerIndex < workerAmount; workerIndex++)
+    {
+        if (pthread_create(&worker[workerIndex].thread, NULL, batchWorkerRun, &worker[workerIndex]) != 0)
+        {
+            break; // Carry on with the workers that did start, the jobs are shared out all the same
+        }
+        threadsStarted++;
+    }
+    batchWorkerRun(&worker[0]);
+    for (int workerIndex = 1; workerIndex <= threadsStarted; workerIndex++)
+    {
+        pthread_join(worker[workerIndex].thread, NULL);
+    }
+    pthread_mutex_destroy(&queue.lock);
+    for (int workerIndex = 0; workerIndex < workerAmount; workerIndex++)
+    {
+        ebcFreeWorkspace(&worker[workerIndex].workspace);
+    }
+    ebiFinish(&io); // Wait for the last outputs to be written
+    for (int jobIndex = 0; jobIndex < queue.jobAmount; jobIndex++)
+    {
+        if (queue.jobs[jobIndex].check == SUCCESS && files[jobIndex].outputCheck != SUCCESS)
+        { // The job worked but its output could not be written
+            queue.jobs[jobIndex].check = files[jobIndex].outputCheck;
+            queue.jobs[jobIndex].failedFilename = queue.jobs[jobIndex].outputFilename;
+        }
+    }
+
+    // Report every job in the order of the manifest
+    check = SUCCESS;
+    for (int jobIndex = 0; jobIndex < queue.jobAmount; jobIndex++)
+    {
+        BatchJob *job = &queue.jobs[jobIndex];
+        if (job->check == SUCCESS)
+        {
+            int compressed = job->program == BATCH_BLOCK || job->program == BATCH_R32 || job->program == BATCH_R128 || job->program == BATCH_R;
+            printf("%d %s\n", job->lineNumber, compressed ? "COMPRESSED" : "DECOMPRESSED");
+            continue;
+        }
+        char message[EB_MESSAGE_SIZE]; // The error message of the job
+        int jobCheck = ebErrorMessage(job->check, job->failedFilename, message, EB_MESSAGE_SIZE);
+        printf("%d %s\n", job->lineNumber, message);
+        if (check == SUCCESS)
+        { // The batch exits with the error of the first job that failed
+            check = jobCheck;
+        }
+    }
+
+    free(worker);
+    free(files);
+    free(waits);
+    for (int lineIndex = 0; lineIndex < lineAmount; lineIndex++)
+    {
+        free(lines[lineIndex]);
+    }
+    free(lines);
+    free(queue.jobs);
+    return check;
+}
\ No newline at end of file
@@ -0,0 +1,57 @@
+#ifndef EBC_BATCH_H
+#define EBC_BATCH_H
+
+#include "ebUniversalUtils.h"
+#include "ebcUtils.h"
+#include "ebcbUtils.h"
+#include "ebcrUtils.h"
+#include "ebcioUtils.h"
+#include <pthread.h>
+#include <string.h>
+#include <ctype.h>
+
+#define BATCH_MAX_WORKERS EBR_MAX_THREADS // The most worker threads a batch can run on
+#define BATCH_BAD_LINE -1                 // The job of a manifest line that could not be read
+#define BATCH_BLOCK 0                     // ebcBlock: compress with block averages
+#define BATCH_UNBLOCK 1                   // ebcUnblock: decompress an ebcBlock file
+#define BATCH_R32 2                       // ebcR32: compress with 32 paradigm blocks
+#define BATCH_U32 3                       // ebcU32: decompress an E5 file
+#define BATCH_R128 4                      // ebcR128: compress with 128 paradigm blocks
+#define BATCH_U128 5                      // ebcU128: decompress an E7 file
+#define BATCH_R 6                         // ebcR: compress with --paradigms paradigm blocks
+#define BATCH_U 7                         // ebcU: decompress any R family file
+
+typedef struct batchJob{
+    int program;          // The program the job runs, one of the BATCH constants
+    int lineNumber;       // The line of the manifest the job is on
+    char *inputFilename;  // The file to read
+    char *outputFilename; // The file to write
+    int seed;             // The seed of the paradigm blocks, for the programs that compress with them
+    int check;            // 0 once the job is done, otherwise the error code it stopped with
+    char *failedFilename; // The file to blame when the job fails
+    int producer;         // The last job before this one whose output is its input, -1 if there is none
+    int *waits;           // The jobs before this one that have to be done before it runs
+    int waitAmount;       // The number of jobs in waits
+} BatchJob;
+
+typedef struct batchName{
+    char *filename; // The input or output file of a job
+    int jobIndex;   // The job
+} BatchName;
+
+typedef struct batchQueue{
+    BatchJob *jobs;             // Every job of the manifest, in order
+    int jobAmount;              // The number of jobs
+    int nextJob;                // The first job no worker has taken yet
+    pthread_mutex_t lock;       // Guards nextJob
+    const EbrOptions *options;  // The options every R family job is run with
+    EbiContext *io;             // Reads the inputs of the jobs ahead and writes their outputs behind
+} BatchQueue;
+
+typedef struct batchWorker{
+    pthread_t thread;       // The thread, unused for the calling thread
+    BatchQueue *queue;      // The jobs the worker takes from
+    EbcWorkspace workspace; // The memory the worker reuses from job to job
+} BatchWorker;
+
+#endif
\ No newline at end of file
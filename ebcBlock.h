@@ -4,6 +4,7 @@
 #include "ebUniversalUtils.h"
 #include "blockUtils.h"
 #include "ebcUtils.h"
+#include "ebcbUtils.h"
 #include <math.h>
 
 // function prototypes
@@ -0,0 +1,11 @@
+#include "ebcR.h"
+
+int main(int argc, char **argv)
+{
+    // Check the arguments
+    EbrOptions options; // How the paradigm search runs and how many paradigm blocks there are
+    ebrCheckArgs(argc, argv, "ebcR", 0, &options);
+
+    // Compress the image, the number of paradigm blocks is recorded in the file
+    return ebrCompressFile(argv[1], argv[2], atoi(argv[3]), &options, MAGIC_NUMBER_EBCR);
+}
@@ -0,0 +1,9 @@
+#ifndef EBCR_H
+#define EBCR_H
+
+#include "ebcrUtils.h"
+#include "ebUniversalUtils.h"
+#include "ebcUtils.h"
+#include "blockUtils.h"
+
+#endif
\ No newline at end of file
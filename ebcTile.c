@@ -0,0 +1,50 @@
+#include "ebcTile.h"
+
+int main(int argc, char **argv)
+{
+    // Check the arguments
+    if (argc == 1)
+    {
+        printf("Usage: ebcTile <input file> <output file> [tile size]\n");
+        return SUCCESS;
+    }
+    int tileSize = EBC_TILE_SIZE; // The width and height of the tiles
+    if (argc == 4)
+    {
+        char *end = NULL; // Where the tile size stops being a number
+        long tileSizeAsked = strtol(argv[3], &end, 10);
+        if (end == argv[3] || *end != '\0' || tileSizeAsked < BLOCK_WIDTH || tileSizeAsked > MAX_DIMENSION || tileSizeAsked % BLOCK_WIDTH != 0)
+        { // The tiles have to be a whole number of blocks
+            return ebErrorHandle(BAD_ARGS, NULL);
+        }
+        tileSize = (int)tileSizeAsked;
+    }
+    else if (argc != 3)
+    {
+        return ebErrorHandle(BAD_ARGS, NULL);
+    }
+    ebSetMessageStream(argv[2]); // Keep the messages out of the tiled image when it goes to stdout
+
+    // Cut the image into tiles as it is read
+    Image image;
+    EbcReader reader; // Reads the image row by row
+    int check = ebcOpenReader(&reader, &image, argv[1], MAGIC_NUMBER_EBC);
+    if (check != SUCCESS)
+    {
+        return ebErrorHandle(check, argv[1]);
+    }
+    check = ebcWriteTiled(&reader, &image, argv[2], tileSize);
+    int closeCheck = ebcCloseReader(&reader); // Close the image, checking for too much data
+    if (check == SUCCESS)
+    {
+        check = closeCheck;
+    }
+    if (check != SUCCESS)
+    {
+        ebRemoveFile(argv[2]);                                                 // Do not leave a partial tiled image behind
+        return ebErrorHandle(check, check == BAD_DATA ? argv[1] : argv[2]); // Only reading the image can find bad data
+    }
+
+    fprintf(ebMessageStream(), "TILED\n"); // Print that the image was tiled
+    return SUCCESS;
+}
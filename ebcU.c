@@ -0,0 +1,10 @@
+#include "ebcU.h"
+
+int main(int argc, char **argv)
+{
+    // Check the arguments
+    ebCheckArgs(argc, "ebcU");
+
+    // Decompress the image, whichever R family type its header says it is
+    return ebrDecompressFile(argv[1], argv[2], MAGIC_NUMBER_EBCR_FAMILY);
+}
@@ -0,0 +1,9 @@
+#ifndef EBCU_H
+#define EBCU_H
+
+#include "ebcUtils.h"
+#include "ebUniversalUtils.h"
+#include "ebcrUtils.h"
+#include "blockUtils.h"
+
+#endif
\ No newline at end of file
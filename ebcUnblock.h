@@ -4,5 +4,6 @@
 #include "ebcUtils.h"
 #include "ebUniversalUtils.h"
 #include "blockUtils.h"
+#include "ebcbUtils.h"
 
 #endif
\ No newline at end of file
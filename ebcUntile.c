@@ -0,0 +1,110 @@
+#include "ebcUntile.h"
+
+/**
+ * This function reads one of the numbers that pick the region to untile.
+ *
+ * @param argument The argument holding the number
+ * @param value Where to store the number
+ * @return 0 on success; BAD_ARGS if the argument is not a number
+ */
+static int ebcParseRegionArgument(char *argument, int *value)
+{
+    char *end = NULL; // Where the number stops
+    long number = strtol(argument, &end, 10);
+    if (end == argument || *end != '\0' || number < 0 || number > MAX_DIMENSION)
+    {
+        return BAD_ARGS;
+    }
+    *value = (int)number;
+    return SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    // Check the arguments
+    if (argc == 1)
+    {
+        printf("Usage: ebcUntile <input file> <output file> [<x> <y> <width> <height>]\n");
+        return SUCCESS;
+    }
+    if (argc != 3 && argc != 7)
+    {
+        return ebErrorHandle(BAD_ARGS, NULL);
+    }
+    ebSetMessageStream(argv[2]); // Keep the messages out of the image when it goes to stdout
+
+    EbcTiledReader reader; // Reads the tiles of the region
+    int check = ebcOpenTiledReader(&reader, argv[1]);
+    if (check != SUCCESS)
+    {
+        return ebErrorHandle(check, argv[1]);
+    }
+    Image region; // The header of the region being written
+    int regionX = 0;
+    int regionY = 0;
+    region.width = reader.width; // Without a region the whole image is untiled
+    region.height = reader.height;
+    if (argc == 7 && (ebcParseRegionArgument(argv[3], &regionX) != SUCCESS || ebcParseRegionArgument(argv[4], &regionY) != SUCCESS ||
+                      ebcParseRegionArgument(argv[5], &region.width) != SUCCESS || ebcParseRegionArgument(argv[6], &region.height) != SUCCESS))
+    {
+        ebcCloseTiledReader(&reader);
+        return ebErrorHandle(BAD_ARGS, NULL);
+    }
+    if (region.width < 1 || region.height < 1 || region.width > reader.width - regionX || region.height > reader.height - regionY)
+    { // The region has to be inside the image
+        ebcCloseTiledReader(&reader);
+        return ebErrorHandle(BAD_DIM, argv[1]);
+    }
+
+    // Decode the region a row of tiles at a time and write it out
+    Pixel **strip = ebCreate2DArray(reader.tileHeight, region.width); // The rows of the region from one row of tiles
+    if (strip == NULL)
+    {
+        ebcCloseTiledReader(&reader);
+        return ebErrorHandle(BAD_MALLOC, argv[1]);
+    }
+    EbcWriter writer; // Writes the region row by row
+    check = ebcOpenWriter(&writer, &region, argv[2], MAGIC_NUMBER_EBC);
+    if (check != SUCCESS)
+    {
+        ebFree2DArray(strip);
+        ebcCloseTiledReader(&reader);
+        return ebErrorHandle(check, argv[2]);
+    }
+
+    char *failedFile = argv[1]; // The file to blame if something goes wrong
+    for (int y = regionY; y < regionY + region.height && check == SUCCESS;)
+    {
+        int stripHeight = reader.tileHeight - y % reader.tileHeight; // The rows up to the end of the row of tiles
+        if (stripHeight > regionY + region.height - y)
+        {
+            stripHeight = regionY + region.height - y;
+        }
+        check = ebcReadTiledRegion(&reader, regionX, y, region.width, stripHeight, strip);
+        for (int stripY = 0; stripY < stripHeight && check == SUCCESS; stripY++)
+        {
+            check = ebcWriteRow(&writer, strip[stripY]);
+            if (check != SUCCESS)
+            {
+                failedFile = argv[2];
+            }
+        }
+        y += stripHeight;
+    }
+    int closeCheck = ebcCloseWriter(&writer); // Write out the end of the region
+    if (check == SUCCESS && closeCheck != SUCCESS)
+    {
+        check = closeCheck;
+        failedFile = argv[2];
+    }
+    ebFree2DArray(strip);
+    ebcCloseTiledReader(&reader);
+    if (check != SUCCESS)
+    {
+        ebRemoveFile(argv[2]);                   // Do not leave a partial image behind
+        return ebErrorHandle(check, failedFile); // return if the region was not untiled
+    }
+
+    fprintf(ebMessageStream(), "UNTILED\n"); // Print that the region was untiled
+    return SUCCESS;
+}
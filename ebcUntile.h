@@ -0,0 +1,8 @@
+#ifndef EBC_UNTILE_H
+#define EBC_UNTILE_H
+
+#include "ebcUtils.h"
+#include "ebUniversalUtils.h"
+#include "blockUtils.h"
+
+#endif
\ No newline at end of file
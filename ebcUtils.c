@@ -1,416 +1,1740 @@
+#define _POSIX_C_SOURCE 200809L // For fileno(), mmap() and posix_madvise()
+
 #include "ebcUtils.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * This function works out how many bits the paradigm block indices of an ER file take.
+ *
+ * @param paradigmBlockAmount The number of paradigm blocks
+ * @return The number of bits per index; 0 if the amount is not a power of 2 from EBC_MIN_PARADIGMS to EBC_MAX_PARADIGMS
+ */
+int ebcIndexBitWidth(int paradigmBlockAmount)
+{
+    for (int bitWidth = 1; (1 << bitWidth) <= EBC_MAX_PARADIGMS; bitWidth++)
+    {
+        if ((1 << bitWidth) == paradigmBlockAmount && paradigmBlockAmount >= EBC_MIN_PARADIGMS)
+        {
+            return bitWidth;
+        }
+    }
+    return 0;
+}
+
+/**
+ * This function works out how the pixels of a file type are packed.
+ *
+ * E5 and E7 files pack their paradigm blocks at the width of their indices. ER files pack their
+ * paradigm blocks at 5 bits and their indices at just the width the number of paradigm blocks needs.
+ * EA files are laid out like ER files, except that their indices are entropy coded rather than packed.
+ *
+ * @param magicNumber The magic number of the file
+ * @param paradigmBlockAmount Where to store the number of paradigm blocks before the data (0 for none), for ER and EA files it is given here
+ * @param mode Where to store the number of bits per pixel of the data
+ * @param paradigmMode Where to store the number of bits per pixel of the paradigm blocks
+ * @return 0 on success; BAD_DATA if an ER or EA file has a number of paradigm blocks that is not supported
+ */
+static int ebcFormat(int magicNumber, int *paradigmBlockAmount, int *mode, int *paradigmMode)
+{
+    *mode = 5;
+    *paradigmMode = 5;
+    if (magicNumber == MAGIC_NUMBER_EBCR || magicNumber == MAGIC_NUMBER_EBCRA)
+    { // Check if the file records its own number of paradigms
+        *mode = ebcIndexBitWidth(*paradigmBlockAmount);
+        return *mode > 0 ? SUCCESS : BAD_DATA;
+    }
+    *paradigmBlockAmount = 0;
+    if (magicNumber == MAGIC_NUMBER_EBCR32)
+    {                              // Check if the file is compressed with 32 paradigms
+        *mode = 5;                 // Set the mode to 5 so that the data is read correctly
+        *paradigmBlockAmount = 32; // Set the paradigm block amount to 32 so that the data is read correctly
+    }
+    else if (magicNumber == MAGIC_NUMBER_EBCR128)
+    {                               // Check if the file is compressed with 128 paradigms
+        *mode = 7;                  // Set the mode to 7 so that the data is read correctly
+        *paradigmBlockAmount = 128; // Set the paradigm block amount to 128 so that the data is read correctly
+    }
+    *paradigmMode = *mode;
+    return SUCCESS;
+}
+
+/**
+ * This function works out which R family type a file is from its magic number.
+ *
+ * @param bytes The start of the file
+ * @param size The number of bytes there are
+ * @param fixedMagicNumber MAGIC_NUMBER_EBCR32 or MAGIC_NUMBER_EBCR128 to accept only that type or an EA file,
+ * MAGIC_NUMBER_EBCR_FAMILY to accept any of them
+ * @param magicNumber Where to store the magic number
+ * @return 0 on success; BAD_MAGIC_NUMBER if it is not an E5, E7, ER or EA file, or not one that was asked for
+ */
+static int ebcParseFamilyMagicNumber(const unsigned char *bytes, long size, int fixedMagicNumber, int *magicNumber)
+{
+    if (size < 2)
+    { // The file is too short to hold a magic number
+        return BAD_MAGIC_NUMBER;
+    }
+    *magicNumber = bytes[0] | (bytes[1] << 8);
+    if (*magicNumber != MAGIC_NUMBER_EBCR32 && *magicNumber != MAGIC_NUMBER_EBCR128 && *magicNumber != MAGIC_NUMBER_EBCR && *magicNumber != MAGIC_NUMBER_EBCRA)
+    { // Only the R family is accepted in place of a magic number
+        return BAD_MAGIC_NUMBER;
+    }
+    if (fixedMagicNumber != MAGIC_NUMBER_EBCR_FAMILY && *magicNumber != fixedMagicNumber && *magicNumber != MAGIC_NUMBER_EBCRA)
+    { // An E5 or E7 file was asked for, the number of paradigm blocks of an EA file is checked once it is read
+        return BAD_MAGIC_NUMBER;
+    }
+    return SUCCESS;
+}
+
+static int ebcOpenMappedOrStream(EbcReader *reader, Image *image, int expectedMagicNumber);
+static void ebcPutLittleEndian(unsigned char *bytes, unsigned long long value, int byteAmount);
+static unsigned long long ebcGetLittleEndian(const unsigned char *bytes, int byteAmount);
+static int ebcWriteCoded(EbcWriter *writer);
+
+/**
+ * This function opens an ebc family file for reading row by row.
+ *
+ * The header and any paradigm blocks are read into the image struct, after which the pixels
+ * can be read with ebcReadRow(). Regular files are mapped into memory and decoded straight from
+ * the mapping, anything that cannot be mapped, such as a pipe on stdin, is read through stdio
+ * front to back instead.
+ *
+ * @param reader The reader to open
+ * @param image The image struct that the header and paradigm blocks are read into
+ * @param filename The name of the file to read, EB_STANDARD_STREAM for stdin
+ * @param expectedMagicNumber The magic number that the file should have, or MAGIC_NUMBER_EBCR_FAMILY
+ * @return 0 if the file was opened correctly
+ * @return one of the error codes in ebConstants.h if we encountered their respective error, in which case nothing is left open
+ */
+int ebcOpenReader(EbcReader *reader, Image *image, char *filename, int expectedMagicNumber)
+{
+    // open the file
+    reader->fp = ebOpenFile(filename, "rb");
+    if (reader->fp == NULL)
+    { // Check if the file opened
+        return BAD_FILE;
+    }
+
+    struct stat fileStatus; // Used to find out if the file can be mapped and how big it is
+    void *mapping = MAP_FAILED;
+    if (fstat(fileno(reader->fp), &fileStatus) == 0 && S_ISREG(fileStatus.st_mode) && fileStatus.st_size > 0 && ftello(reader->fp) == 0)
+    { // Only regular, non empty files can be mapped, and stdin only when nothing has been read from it yet
+        mapping = mmap(NULL, fileStatus.st_size, PROT_READ, MAP_PRIVATE, fileno(reader->fp), 0);
+    }
+    reader->mapping = NULL;
+    reader->mappingSize = 0;
+    if (mapping != MAP_FAILED)
+    {
+        posix_madvise(mapping, fileStatus.st_size, POSIX_MADV_SEQUENTIAL); // The file is read front to back once
+        reader->mapping = (const unsigned char *)mapping;
+        reader->mappingSize = (long)fileStatus.st_size;
+    }
+
+    int check = ebcOpenMappedOrStream(reader, image, expectedMagicNumber);
+    if (check != SUCCESS)
+    { // Close everything again if the file could not be opened
+        ebcCloseReader(reader);
+    }
+    return check;
+}
+
+/**
+ * This function opens an ebc family file that is already in memory for reading row by row.
+ *
+ * The bytes are decoded just as a mapped file would be, and stay owned by the caller.
+ *
+ * @param reader The reader to open
+ * @param image The image struct that the header and paradigm blocks are read into
+ * @param bytes The whole of the file
+ * @param size The number of bytes in the file
+ * @param expectedMagicNumber The magic number that the file should have, or MAGIC_NUMBER_EBCR_FAMILY
+ * @return 0 if the file was opened correctly
+ * @return one of the error codes in ebConstants.h if we encountered their respective error, in which case nothing is left open
+ */
+int ebcOpenMemoryReader(EbcReader *reader, Image *image, const unsigned char *bytes, long size, int expectedMagicNumber)
+{
+    reader->fp = NULL;
+    reader->mapping = bytes;
+    reader->mappingSize = size;
+    return ebcOpenMappedOrStream(reader, image, expectedMagicNumber);
+}
+
+/**
+ * This function opens the input file of a workspace for reading row by row.
+ *
+ * The file is decoded from memory when the caller has already read it into the workspace, and opened by name otherwise.
+ *
+ * @param reader The reader to open
+ * @param image The image struct that the header and paradigm blocks are read into
+ * @param filename The name of the file to read
+ * @param expectedMagicNumber The magic number that the file should have, or MAGIC_NUMBER_EBCR_FAMILY
+ * @param workspace The workspace that may hold the file
+ * @return 0 if the file was opened correctly
+ * @return one of the error codes in ebConstants.h if we encountered their respective error, in which case nothing is left open
+ */
+int ebcOpenInput(EbcReader *reader, Image *image, char *filename, int expectedMagicNumber, const EbcWorkspace *workspace)
+{
+    if (workspace->input != NULL)
+    {
+        return ebcOpenMemoryReader(reader, image, workspace->input, workspace->inputSize, expectedMagicNumber);
+    }
+    return ebcOpenReader(reader, image, filename, expectedMagicNumber);
+}
+
+/**
+ * This function gets ready to decode the next block of the entropy coded indices of an EA file.
+ *
+ * A block is the length of its coded indices as an EBC_CODED_LENGTH_SIZE byte little endian number, then
+ * EBC_CODED_BLOCK_INDICES indices, or whatever is left of them for the last block, as coded by ransEncode().
+ * Through stdio the coded block is read into memory, which rANS needs anyway since it cannot decode a byte at a time.
+ *
+ * @param reader The reader, just past the block before, or past the paradigm blocks for the first block
+ * @return 0 if the block was found; BAD_DATA if it is not valid; BAD_MALLOC if memory allocation fails
+ */
+static int ebcOpenCodedBlock(EbcReader *reader)
+{
+    long blockIndices = reader->indicesLeft < EBC_CODED_BLOCK_INDICES ? reader->indicesLeft : EBC_CODED_BLOCK_INDICES; // The indices in the block
+    const unsigned char *coded = NULL; // The coded indices of the block
+    unsigned long long codedSize = 0;  // The number of bytes of coded indices
+    if (reader->mapping != NULL)
+    {
+        long offset = reader->dataEnd; // The block starts where the one before it ended
+        if (reader->mappingSize - offset < EBC_CODED_LENGTH_SIZE)
+        {
+            return BAD_DATA;
+        }
+        codedSize = ebcGetLittleEndian(reader->mapping + offset, EBC_CODED_LENGTH_SIZE);
+        offset += EBC_CODED_LENGTH_SIZE;
+        if (codedSize > (unsigned long long)(reader->mappingSize - offset))
+        { // The file ends before the coded indices do
+            return BAD_DATA;
+        }
+        coded = reader->mapping + offset;
+        reader->dataEnd = offset + (long)codedSize; // Checked when the reader is closed
+    }
+    else
+    {
+        unsigned char lengthBytes[EBC_CODED_LENGTH_SIZE];
+        if (fread(lengthBytes, 1, EBC_CODED_LENGTH_SIZE, reader->fp) != EBC_CODED_LENGTH_SIZE)
+        {
+            return BAD_DATA;
+        }
+        codedSize = ebcGetLittleEndian(lengthBytes, EBC_CODED_LENGTH_SIZE);
+        if (codedSize > (unsigned long long)ransMaxCodedSize(reader->symbolAmount, blockIndices))
+        { // Longer than any indices could code to, so do not try to allocate it
+            return BAD_DATA;
+        }
+        if ((long)codedSize >= reader->codedCapacity)
+        { // Grow to fit
+            free(reader->coded);
+            reader->coded = (unsigned char *)malloc((size_t)codedSize + 1);
+            reader->codedCapacity = reader->coded != NULL ? (long)codedSize + 1 : 0;
+            if (reader->coded == NULL)
+            {
+                return BAD_MALLOC;
+            }
+        }
+        if (fread(reader->coded, 1, (size_t)codedSize, reader->fp) != (size_t)codedSize)
+        { // The file ends before the coded indices do
+            return BAD_DATA;
+        }
+        coded = reader->coded;
+    }
+
+    int check = ransOpenDecoder(&reader->rans, coded, (long)codedSize, reader->symbolAmount);
+    if (check != SUCCESS)
+    {
+        return check;
+    }
+    reader->codedLeft = blockIndices;
+    reader->indicesLeft -= blockIndices;
+    return SUCCESS;
+}
+
+/**
+ * This function finds the entropy coded indices of an EA file and gets ready to decode them.
+ *
+ * The paradigm blocks are followed by a newline, then the indices in blocks as read by ebcOpenCodedBlock().
+ * There is always at least one block, even for an image without indices.
+ *
+ * @param reader The reader being opened, just past the paradigm blocks
+ * @param paradigmBlockAmount The number of paradigm blocks the indices pick from
+ * @param pixelAmount The number of indices
+ * @param offset The position in the mapped file
+ * @return 0 if the coded indices were found; BAD_DATA if they are not valid; BAD_MALLOC if memory allocation fails
+ */
+static int ebcOpenCoded(EbcReader *reader, int paradigmBlockAmount, long pixelAmount, long offset)
+{
+    if (reader->mapping != NULL)
+    {
+        reader->dataStart = offset + 1; // skip the newline character at the end of the paradigm block
+        reader->dataEnd = reader->dataStart;
+    }
+    else
+    {
+        fgetc(reader->fp); // skip the newline character at the end of the paradigm block
+    }
+    reader->codedCapacity = 0;
+    reader->indicesLeft = pixelAmount;
+    reader->symbolAmount = paradigmBlockAmount;
+    int check = ebcOpenCodedBlock(reader);
+    if (check != SUCCESS)
+    {
+        free(reader->coded);
+        reader->coded = NULL;
+        return check;
+    }
+    reader->entropyCoded = 1;
+    return SUCCESS;
+}
+
+/**
+ * This function reads the header and paradigm blocks for ebcOpenReader() and sets up the pixel reader.
+ *
+ * @param reader The reader being opened
+ * @param image The image struct that the header and paradigm blocks are read into
+ * @param expectedMagicNumber The magic number that the file should have, or MAGIC_NUMBER_EBCR_FAMILY
+ * @return 0 if the file was opened correctly
+ * @return one of the error codes in ebConstants.h if we encountered their respective error
+ */
+static int ebcOpenMappedOrStream(EbcReader *reader, Image *image, int expectedMagicNumber)
+{
+    long offset = 0; // The position in the mapped file
+    int check = SUCCESS;
+    reader->entropyCoded = 0;
+    reader->coded = NULL;
+    int fixedMagicNumber = MAGIC_NUMBER_EBCR_FAMILY; // The E5 or E7 type an EA file stands in for, if one was asked for
+    if (expectedMagicNumber == MAGIC_NUMBER_EBCR32 || expectedMagicNumber == MAGIC_NUMBER_EBCR128)
+    { // ebcR32 and ebcR128 write EA files in place of E5 and E7 files when asked to entropy code their indices
+        fixedMagicNumber = expectedMagicNumber;
+        expectedMagicNumber = MAGIC_NUMBER_EBCR_FAMILY;
+    }
+    if (reader->mapping != NULL)
+    {
+        if (expectedMagicNumber == MAGIC_NUMBER_EBCR_FAMILY)
+        { // Expect whichever R family type the file is
+            check = ebcParseFamilyMagicNumber(reader->mapping, reader->mappingSize, fixedMagicNumber, &expectedMagicNumber);
+        }
+        if (check == SUCCESS)
+        {
+            check = ebParseHeader(reader->mapping, reader->mappingSize, image, expectedMagicNumber, &offset);
+        }
+    }
+    else if (expectedMagicNumber == MAGIC_NUMBER_EBCR_FAMILY)
+    { // The magic number cannot be put back on a stream, so it is read once and the dimensions after it
+        long byteAmount = (long)fread(image->magicNumber, 1, 2, reader->fp);
+        check = ebcParseFamilyMagicNumber(image->magicNumber, byteAmount, fixedMagicNumber, &expectedMagicNumber);
+        if (check == SUCCESS)
+        {
+            check = ebReadDimensions(reader->fp, image);
+        }
+    }
+    else
+    {
+        check = ebReadHeader(reader->fp, image, expectedMagicNumber);
+    }
+    if (check != SUCCESS)
+    { // Check if the header was read correctly
+        return check;
+    }
+
+    int paradigmBlockAmount = 0;
+    if (expectedMagicNumber == MAGIC_NUMBER_EBCR || expectedMagicNumber == MAGIC_NUMBER_EBCRA)
+    { // The number of paradigm blocks follows the dimensions
+        if (reader->mapping != NULL ? ebParseInt(reader->mapping, reader->mappingSize, &offset, &paradigmBlockAmount) != SUCCESS
+                                    : fscanf(reader->fp, "%d", &paradigmBlockAmount) != 1)
+        {
+            return BAD_DATA;
+        }
+        if (fixedMagicNumber != MAGIC_NUMBER_EBCR_FAMILY && paradigmBlockAmount != (fixedMagicNumber == MAGIC_NUMBER_EBCR32 ? 32 : 128))
+        { // The EA file does not stand in for the type that was asked for
+            return BAD_MAGIC_NUMBER;
+        }
+    }
+    int mode = 5;
+    int paradigmMode = 5;
+    check = ebcFormat(expectedMagicNumber, &paradigmBlockAmount, &mode, &paradigmMode);
+    if (check != SUCCESS)
+    { // Check that the file can be read
+        return check;
+    }
+    image->paradigmBlockAmount = paradigmBlockAmount;
+    if (paradigmBlockAmount > 0)
+    { // Check if the file is compressed
+        // Read the paradigm block
+        image->paradigm = ebCreate2DArray(BLOCK_HEIGHT, paradigmBlockAmount * BLOCK_WIDTH); // Allocate memory for the paradigm block
+        if (image->paradigm == NULL)
+        { // If the memory allocation failed return an error
+            return BAD_MALLOC;
+        }
+        if (reader->mapping != NULL)
+        {
+            offset++; // Skip the newline character at the end of the header
+            check = ebcUniversalMemoryReader(image->paradigm, reader->mapping, reader->mappingSize, &offset, paradigmMode, BLOCK_HEIGHT, paradigmBlockAmount * BLOCK_WIDTH);
+        }
+        else
+        {
+            fgetc(reader->fp);                                                                                              // Skip the newline character at the end of the header
+            check = ebcUniversalReader(image->paradigm, reader->fp, paradigmMode, BLOCK_HEIGHT, paradigmBlockAmount * BLOCK_WIDTH); // Read the paradigm block
+        }
+        if (check != SUCCESS)
+        { // Check if the data was read correctly
+            ebFree2DArray(image->paradigm);
+            return check;
+        }
+    }
+
+    reader->width = image->width;
+    long pixelAmount = (long)image->height * image->width; // The number of pixels after the paradigm block
+    if (expectedMagicNumber == MAGIC_NUMBER_EBCRA)
+    { // The indices are entropy coded rather than packed
+        check = ebcOpenCoded(reader, paradigmBlockAmount, pixelAmount, offset);
+        if (check != SUCCESS)
+        {
+            ebFree2DArray(image->paradigm);
+        }
+        return check;
+    }
+    if (reader->mapping != NULL)
+    {
+        offset++;                                                                // skip the newline character at the end of the paradigm block
+        reader->dataStart = offset;                                              // Where the pixels start, for decoding them in chunks
+        reader->dataEnd = offset + (pixelAmount * mode + 7) / 8;              // Where the data should end, checked when the reader is closed
+        long byteAmount = offset < reader->mappingSize ? reader->mappingSize - offset : 0; // The file may end before the data starts
+        bpuReaderInitMemory(&reader->bits, reader->mapping + offset, byteAmount, mode, pixelAmount);
+    }
+    else
+    {
+        fgetc(reader->fp); // skip the newline character at the end of the paradigm block
+        bpuReaderInit(&reader->bits, reader->fp, mode, pixelAmount);
+    }
+    return SUCCESS;
+}
+
+/**
+ * This function reads the next row of pixels from a file opened with ebcOpenReader().
+ *
+ * @param reader The reader to read from
+ * @param row The array to store the row in, as wide as the image
+ * @return 0 if the row was read correctly; BAD_DATA if the file ran out of data
+ */
+int ebcReadRow(EbcReader *reader, Pixel *row)
+{
+    return bpuReadPixels(&reader->bits, row, reader->width);
+}
+
+/**
+ * This function reads the next row of paradigm block indices from a compressed file opened with ebcOpenReader().
+ *
+ * @param reader The reader to read from
+ * @param row The array to store the row in, as wide as the compressed image
+ * @return 0 if the row was read correctly; BAD_DATA if the file ran out of data
+ */
+int ebcReadIndexRow(EbcReader *reader, EbIndex *row)
+{
+    if (!reader->entropyCoded)
+    {
+        return bpuReadIndices(&reader->bits, row, reader->width);
+    }
+    int check = SUCCESS;
+    for (int done = 0; done < reader->width && check == SUCCESS;)
+    { // A row can run on from one block into the next
+        if (reader->codedLeft == 0)
+        { // The block has to end where its last index does before the next one is started
+            check = ransCloseDecoder(&reader->rans);
+            if (check == SUCCESS)
+            {
+                check = reader->indicesLeft > 0 ? ebcOpenCodedBlock(reader) : BAD_DATA;
+            }
+            continue;
+        }
+        int count = reader->width - done < reader->codedLeft ? reader->width - done : (int)reader->codedLeft; // The indices of the row in this block
+        check = ransDecode(&reader->rans, row + done, count);
+        reader->codedLeft -= count;
+        done += count;
+    }
+    return check;
+}
+
+/**
+ * This function closes a file opened with ebcOpenReader() or ebcOpenMemoryReader().
+ *
+ * When every row has been read, this also checks that nothing follows the data.
+ *
+ * @param reader The reader to close
+ * @return 0 if the file ended after the data; BAD_DATA if there is more data in the file
+ */
+int ebcCloseReader(EbcReader *reader)
+{
+    int check = SUCCESS;
+    if (reader->entropyCoded)
+    { // The coded indices have to end where the last index does
+        check = ransCloseDecoder(&reader->rans);
+        free(reader->coded);
+    }
+    if (reader->mapping != NULL)
+    { // A mapped file has too much data if it does not end where the data ends
+        if (reader->dataEnd != reader->mappingSize)
+        {
+            check = BAD_DATA;
+        }
+        if (reader->fp == NULL)
+        { // The memory belongs to the caller
+            return check;
+        }
+        munmap((void *)reader->mapping, reader->mappingSize);
+    }
+    else if (fgetc(reader->fp) != EOF)
+    { // Try to read a byte from the file. If we are able to read a byte from the file then there is too much data in the file and we return an error
+        check = BAD_DATA; // Reading rather than seeking to the end works on pipes too
+    }
+    ebCloseFile(reader->fp); // Close the file, stdin is left open
+    return check;
+}
+
+/**
+ * This function prepares an empty workspace.
+ *
+ * A workspace holds the memory a program needs for one file, so that a batch of files can be worked
+ * through one after another without allocating it again for every file.
+ *
+ * @param workspace The workspace to prepare
+ */
+void ebcInitWorkspace(EbcWorkspace *workspace)
+{
+    ebInitBuffer(&workspace->pixels);
+    ebInitBuffer(&workspace->compressed);
+    ebInitIndexBuffer(&workspace->indices);
+    workspace->blocks = NULL;
+    workspace->blockCapacity = 0;
+    workspace->packed = NULL;
+    workspace->packedCapacity = 0;
+    workspace->input = NULL;
+    workspace->inputSize = 0;
+    workspace->output = NULL;
+    workspace->threadAmount = 1;
+}
+
+/**
+ * This function works out how many threads a program working on one file should use.
+ *
+ * @return The number of processors online, from 1 to EBC_MAX_THREADS
+ */
+int ebcProcessorAmount(void)
+{
+    long processorAmount = sysconf(_SC_NPROCESSORS_ONLN); // -1 if the system cannot tell
+    if (processorAmount < 1)
+    {
+        return 1;
+    }
+    return processorAmount < EBC_MAX_THREADS ? (int)processorAmount : EBC_MAX_THREADS;
+}
+
+/**
+ * This function makes room in a workspace for a packed row.
+ *
+ * @param workspace The workspace
+ * @param byteAmount The number of bytes needed
+ * @return The packed row, which stays valid until the workspace is asked for a larger one; NULL if memory allocation fails
+ */
+unsigned char *ebcReusePacked(EbcWorkspace *workspace, long byteAmount)
+{
+    if (byteAmount > workspace->packedCapacity)
+    { // Grow to fit
+        free(workspace->packed);
+        workspace->packed = (unsigned char *)malloc((size_t)byteAmount);
+        workspace->packedCapacity = workspace->packed != NULL ? byteAmount : 0;
+    }
+    return workspace->packed;
+}
+
+/**
+ * This function frees the memory of a workspace, leaving it empty.
+ *
+ * @param workspace The workspace to free
+ */
+void ebcFreeWorkspace(EbcWorkspace *workspace)
+{
+    ebFreeBuffer(&workspace->pixels);
+    ebFreeBuffer(&workspace->compressed);
+    ebFreeIndexBuffer(&workspace->indices);
+    blockFreeArena(workspace->blocks);
+    free(workspace->packed);
+    ebcInitWorkspace(workspace);
+}
+
+/**
+ * This function reads an ebc family file into the image struct.
+ *
+ * When the file is mapped and more than one thread is given, the pixels are cut into chunks that are
+ * decoded at the same time, otherwise they are read row by row.
+ *
+ * @param image The image struct that the file is read into
+ * @param filename The name of the file to read
+ * @param expectedMagicNumber The magic number that the file should have
+ * @param threadAmount The most threads to decode the pixels with
+ * @param buffer Where the pixels are kept, image->data points into it
+ * @return 0 if the file was read correctly
+ * @return one of the error codes in ebConstants.h if we encountered their respective error
+ */
+int ebcRead(Image *image, char *filename, int expectedMagicNumber, int threadAmount, EbBuffer *buffer)
+{
+    EbcReader reader; // Reads the file row by row
+    int check = ebcOpenReader(&reader, image, filename, expectedMagicNumber);
+    if (check != SUCCESS)
+    { // Check if the file was opened correctly
+        return check;
+    }
+    return ebcReadOpened(&reader, image, threadAmount, buffer);
+} // ebcRead()
+
+/**
+ * This function closes a file that has been read into the image struct, see ebcReadOpened().
+ *
+ * @param reader The reader to close
+ * @param image The image struct the file was read into
+ * @param check The result of reading the data
+ * @return check, or the result of closing the file if the data was read correctly
+ */
+static int ebcFinishRead(EbcReader *reader, Image *image, int check)
+{
+    int closeCheck = ebcCloseReader(reader); // Close the file, checking for too much data
+    if (check == SUCCESS)
+    {
+        check = closeCheck;
+    }
+    if (check != SUCCESS && image->paradigmBlockAmount > 0)
+    { // Only a file that was read correctly hands back its paradigm blocks
+        ebFree2DArray(image->paradigm);
+    }
+    return check;
+}
+
+/**
+ * This function reads the pixels of an opened ebc family file into the image struct and closes it.
+ *
+ * When the file is in memory and more than one thread is given, the pixels are cut into chunks that are
+ * decoded at the same time, otherwise they are read row by row.
+ *
+ * @param reader The reader the file was opened with, closed whatever happens
+ * @param image The image struct the header was read into
+ * @param threadAmount The most threads to decode the pixels with
+ * @param buffer Where the pixels are kept, image->data points into it
+ * @return 0 if the file was read correctly
+ * @return one of the error codes in ebConstants.h if we encountered their respective error
+ */
+int ebcReadOpened(EbcReader *reader, Image *image, int threadAmount, EbBuffer *buffer)
+{
+    int check = SUCCESS;
+    image->data = ebReuse2DArray(buffer, image->height, image->width); // Make room for the data
+    if (image->data == NULL)
+    { // If the memory allocation failed return an error
+        check = BAD_MALLOC;
+    }
+    else if (reader->mapping != NULL && threadAmount > 1 && !reader->entropyCoded)
+    { // Decode the chunks of the mapped data at the same time
+        long offset = reader->dataStart; // The position of the pixels in the mapped file
+        check = ebcUniversalParallelReader(image->data, reader->mapping, reader->mappingSize, &offset, reader->bits.bitWidth, image->height, image->width, threadAmount);
+    }
+    else
+    { // Read the data row by row
+        for (int y = 0; y < image->height && check == SUCCESS; y++)
+        {
+            check = ebcReadRow(reader, image->data[y]);
+        }
+    }
+    return ebcFinishRead(reader, image, check);
+}
+
+/**
+ * This function reads the paradigm block indices of an opened compressed file into the image struct and closes it.
+ *
+ * @param reader The reader the file was opened with, closed whatever happens
+ * @param image The image struct the header and paradigm blocks were read into
+ * @param buffer Where the indices are kept, image->indices points into it
+ * @return 0 if the file was read correctly
+ * @return one of the error codes in ebConstants.h if we encountered their respective error
+ */
+int ebcReadIndicesOpened(EbcReader *reader, Image *image, EbIndexBuffer *buffer)
+{
+    int check = SUCCESS;
+    image->indices = ebReuseIndexArray(buffer, image->height, image->width); // Make room for the indices
+    if (image->indices == NULL)
+    { // If the memory allocation failed return an error
+        check = BAD_MALLOC;
+    }
+    for (int y = 0; y < image->height && check == SUCCESS; y++)
+    { // Read the indices row by row
+        check = ebcReadIndexRow(reader, image->indices[y]);
+    }
+    return ebcFinishRead(reader, image, check);
+}
+
+/**
+ * This function opens an ebc family file for writing row by row.
+ *
+ * The header and, for the R family, the paradigm blocks are written straight away, after which
+ * the pixels can be written with ebcWriteRow().
+ *
+ * @param writer The writer to open
+ * @param image The image struct holding the header information and paradigm blocks
+ * @param filename The name of the file to write, EB_STANDARD_STREAM for stdout
+ * @param magicNumber The magic number that the file should have
+ * @return 0 if the file was opened correctly
+ * @return one of the error codes in ebConstants.h if we encountered their respective error, in which case nothing is left open
+ */
+int ebcOpenWriter(EbcWriter *writer, Image *image, char *filename, int magicNumber)
+{
+    // open the file
+    FILE *fp = ebOpenFile(filename, "wb");
+    if (fp == NULL)
+    { // Check if the file opened
+        return BAD_FILE;
+    }
+
+    int check = ebcOpenStreamWriter(writer, image, fp, magicNumber);
+    if (check != SUCCESS)
+    { // Close the file again if nothing can be written to it
+        ebCloseFile(fp);
+        return check;
+    }
+    writer->ownsFile = 1;
+    return SUCCESS;
+}
+
+/**
+ * This function starts writing an ebc family file to a stream that is already open.
+ *
+ * The header and, for the R family, the paradigm blocks are written straight away, after which
+ * the pixels can be written with ebcWriteRow(). The stream stays open when the writer is closed.
+ *
+ * @param writer The writer to open
+ * @param image The image struct holding the header information and paradigm blocks
+ * @param fp The stream to write to
+ * @param magicNumber The magic number that the file should have
+ * @return 0 if the file was started correctly
+ * @return one of the error codes in ebConstants.h if we encountered their respective error
+ */
+int ebcOpenStreamWriter(EbcWriter *writer, Image *image, FILE *fp, int magicNumber)
+{
+    writer->fp = fp;
+    writer->ownsFile = 0;
+    writer->symbols = NULL;
+
+    // write the header
+    int check = ebWriteHeader(writer->fp, image, magicNumber);
+    if (check != SUCCESS)
+    { // Check if the header was written correctly
+        return check;
+    }
+
+    int paradigmBlockAmount = image->paradigmBlockAmount;
+    int mode = 5;
+    int paradigmMode = 5;
+    check = ebcFormat(magicNumber, &paradigmBlockAmount, &mode, &paradigmMode);
+    if (check == SUCCESS && (magicNumber == MAGIC_NUMBER_EBCR || magicNumber == MAGIC_NUMBER_EBCRA) && fprintf(writer->fp, "%d\n", paradigmBlockAmount) < 0)
+    { // Record the number of paradigm blocks after the dimensions
+        check = BAD_OUTPUT;
+    }
+    if (check != SUCCESS)
+    { // Check that the file can be written
+        return check;
+    }
+    if (paradigmBlockAmount > 0) // Check if the file is compressed
+    {
+        check = ebcUniversalWriter(image->paradigm, writer->fp, paradigmMode, BLOCK_HEIGHT, image->paradigmBlockAmount * BLOCK_WIDTH); // Write the paradigm block
+        if (check != SUCCESS)                                                                                                  // Check if the paradigm blocks were written correctly
+        {
+            return check;
+        }
+
+        fprintf(writer->fp, "\n"); // Write a newline character at the end of the paradigm block
+    }
+
+    writer->width = image->width;
+    bpuWriterInit(&writer->bits, writer->fp, mode);
+    if (magicNumber == MAGIC_NUMBER_EBCRA)
+    { // The indices are only coded once a block of them is there
+        long pixelAmount = (long)image->height * image->width; // The number of indices
+        writer->symbolCapacity = pixelAmount < EBC_CODED_BLOCK_INDICES ? pixelAmount : EBC_CODED_BLOCK_INDICES;
+        writer->symbols = (EbIndex *)malloc(sizeof(EbIndex) * (size_t)(writer->symbolCapacity > 0 ? writer->symbolCapacity : 1));
+        writer->symbolCount = 0;
+        writer->symbolAmount = paradigmBlockAmount;
+        writer->codedBlocks = 0;
+        if (writer->symbols == NULL)
+        {
+            return BAD_MALLOC;
+        }
+    }
+    return SUCCESS;
+}
+
+/**
+ * This function writes the next row of pixels to a file opened with ebcOpenWriter().
+ *
+ * @param writer The writer to write to
+ * @param row The row to write, as wide as the image
+ * @return 0 if the row was written correctly; BAD_OUTPUT if the file cannot be written to
+ */
+int ebcWriteRow(EbcWriter *writer, Pixel *row)
+{
+    return bpuWritePixels(&writer->bits, row, writer->width);
+}
+
+/**
+ * This function writes the next row of paradigm block indices to a compressed file opened with ebcOpenWriter().
+ *
+ * The indices of an EA file are kept until EBC_CODED_BLOCK_INDICES of them are there, then coded and written as a block.
+ *
+ * @param writer The writer to write to
+ * @param row The row to write, as wide as the compressed image
+ * @return 0 if the row was written correctly; BAD_OUTPUT if the file cannot be written to; BAD_MALLOC if a block cannot be coded
+ */
+int ebcWriteIndexRow(EbcWriter *writer, EbIndex *row)
+{
+    if (writer->symbols == NULL)
+    {
+        return bpuWriteIndices(&writer->bits, row, writer->width);
+    }
+    int check = SUCCESS;
+    for (int done = 0; done < writer->width && check == SUCCESS;)
+    { // Keep the row of an EA file, coding every block as soon as it is full
+        int count = writer->width - done < writer->symbolCapacity - writer->symbolCount ? writer->width - done : (int)(writer->symbolCapacity - writer->symbolCount);
+        memcpy(writer->symbols + writer->symbolCount, row + done, sizeof(EbIndex) * (size_t)count);
+        writer->symbolCount += count;
+        done += count;
+        if (writer->symbolCount == writer->symbolCapacity)
+        {
+            check = ebcWriteCoded(writer);
+        }
+    }
+    return check;
+}
+
+/**
+ * This function writes the next row of a file opened with ebcOpenWriter() from bytes that are already packed.
+ *
+ * The indices of an EA file are not packed, so its rows have to be written with ebcWriteIndexRow().
+ *
+ * @param writer The writer to write to
+ * @param packed The packed row, starting on a byte boundary, as made by bpuPackRepeated()
+ * @return 0 if the row was written correctly; BAD_OUTPUT if the file cannot be written to
+ */
+int ebcWritePackedRow(EbcWriter *writer, const unsigned char *packed)
+{
+    return bpuWriteBits(&writer->bits, packed, (long)writer->width * writer->bits.bitWidth);
+}
+
+/**
+ * This function entropy codes the block of indices an EA writer holds and writes it, with its length in front.
+ *
+ * @param writer The writer holding the indices, which is left empty for the next block
+ * @return 0 if the indices were written correctly; BAD_MALLOC if memory allocation fails; BAD_OUTPUT if the file cannot be written to
+ */
+static int ebcWriteCoded(EbcWriter *writer)
+{
+    unsigned char *coded = NULL; // The coded indices
+    long codedSize = 0;          // The number of bytes of coded indices
+    int check = ransEncode(writer->symbols, writer->symbolCount, writer->symbolAmount, &coded, &codedSize);
+    if (check != SUCCESS)
+    {
+        return check;
+    }
+    unsigned char lengthBytes[EBC_CODED_LENGTH_SIZE];
+    ebcPutLittleEndian(lengthBytes, (unsigned long long)codedSize, EBC_CODED_LENGTH_SIZE);
+    if (fwrite(lengthBytes, 1, EBC_CODED_LENGTH_SIZE, writer->fp) != EBC_CODED_LENGTH_SIZE ||
+        fwrite(coded, 1, (size_t)codedSize, writer->fp) != (size_t)codedSize)
+    {
+        check = BAD_OUTPUT;
+    }
+    free(coded);
+    writer->symbolCount = 0;
+    writer->codedBlocks++;
+    return check;
+}
+
+/**
+ * This function writes out what is left of the data and closes a file opened with ebcOpenWriter().
+ *
+ * A stream handed to ebcOpenStreamWriter(), and stdout, are flushed and left open.
+ *
+ * @param writer The writer to close
+ * @return 0 if the file was written correctly; BAD_OUTPUT if the file cannot be written to
+ */
+int ebcCloseWriter(EbcWriter *writer)
+{
+    int check = bpuWriterFlush(&writer->bits); // Write the last partial byte and anything still buffered
+    if (writer->symbols != NULL)
+    { // Code the last block of indices of an EA file, there is always at least one
+        if (check == SUCCESS && (writer->symbolCount > 0 || writer->codedBlocks == 0))
+        {
+            check = ebcWriteCoded(writer);
+        }
+        free(writer->symbols);
+        writer->symbols = NULL;
+    }
+    int closed = writer->ownsFile ? ebCloseFile(writer->fp) : fflush(writer->fp); // A stream that belongs to the caller is only flushed
+    if (closed != 0 && check == SUCCESS)
+    { // Make sure everything reached the file
+        check = BAD_OUTPUT;
+    }
+    return check;
+}
+
+/**
+ * This function opens the output file of a workspace for writing row by row.
+ *
+ * The file goes to the stream of the workspace when the caller has given one, and is opened by name otherwise.
+ *
+ * @param writer The writer to open
+ * @param image The image struct holding the header information and paradigm blocks
+ * @param filename The name of the file to write
+ * @param magicNumber The magic number that the file should have
+ * @param workspace The workspace that may hold the stream
+ * @return 0 if the file was opened correctly
+ * @return one of the error codes in ebConstants.h if we encountered their respective error
+ */
+int ebcOpenOutput(EbcWriter *writer, Image *image, char *filename, int magicNumber, const EbcWorkspace *workspace)
+{
+    if (workspace->output != NULL)
+    {
+        return ebcOpenStreamWriter(writer, image, workspace->output, magicNumber);
+    }
+    return ebcOpenWriter(writer, image, filename, magicNumber);
+}
+
+/**
+ * This function removes a partly written output file of a workspace.
+ *
+ * Output that went to the stream of the workspace is left for the caller to throw away.
+ *
+ * @param filename The name of the file
+ * @param workspace The workspace the file was written with
+ */
+void ebcDiscardOutput(char *filename, const EbcWorkspace *workspace)
+{
+    if (workspace->output == NULL)
+    {
+        ebRemoveFile(filename);
+    }
+}
+
+/**
+ * This function works out the size of a tile of an ET file.
+ *
+ * The tiles are cut from the image row of tiles by row of tiles, the ones at the right and bottom edges
+ * being cut short by the image. Every row of a tile is packed at 5 bits and padded to a whole byte, so any
+ * row of any tile can be found without decoding anything before it.
+ *
+ * @param size The width or height of the image
+ * @param tileSize The width or height of a whole tile
+ * @param tileIndex Which tile across or down
+ * @return The width or height of the tile
+ */
+static int ebcTileExtent(int size, int tileSize, int tileIndex)
+{
+    int remaining = size - tileIndex * tileSize; // The pixels of the image from the start of the tile on
+    return remaining < tileSize ? remaining : tileSize;
+}
+
+/**
+ * This function works out how many bytes a row of a tile of an ET file takes.
+ *
+ * @param tileWidth The width of the tile
+ * @return The number of bytes in a row of the tile
+ */
+static long ebcTileRowBytes(int tileWidth)
+{
+    return ((long)tileWidth * 5 + 7) / 8;
+}
+
+/**
+ * This function stores a number in bytes, least significant byte first.
+ *
+ * @param bytes Where to store the number
+ * @param value The number
+ * @param byteAmount How many bytes to store it in
+ */
+static void ebcPutLittleEndian(unsigned char *bytes, unsigned long long value, int byteAmount)
+{
+    for (int byteIndex = 0; byteIndex < byteAmount; byteIndex++)
+    {
+        bytes[byteIndex] = (unsigned char)(value >> (8 * byteIndex));
+    }
+}
+
+/**
+ * This function loads a number stored least significant byte first, the reverse of ebcPutLittleEndian().
+ *
+ * @param bytes Where the number is stored
+ * @param byteAmount How many bytes it is stored in
+ * @return The number
+ */
+static unsigned long long ebcGetLittleEndian(const unsigned char *bytes, int byteAmount)
+{
+    unsigned long long value = 0;
+    for (int byteIndex = byteAmount - 1; byteIndex >= 0; byteIndex--)
+    {
+        value = (value << 8) | bytes[byteIndex];
+    }
+    return value;
+}
+
+/**
+ * This function writes an image read from an ebc file out as an ET file, cut into tiles.
+ *
+ * An ET file starts with a fixed header of EBC_TILED_HEADER_SIZE bytes: the magic number, the bits per pixel (5),
+ * a zero byte, then the height, width, tile height and tile width as 32 bit little endian numbers. After it comes
+ * a table of 64 bit little endian offsets, one for every tile and one for the end of the file, then the tiles.
+ * The image is read a row of tiles at a time, so only tileSize rows are ever held in memory.
+ *
+ * @param reader The reader of the ebc file, opened with ebcOpenReader() and left open
+ * @param image The header of the ebc file
+ * @param filename The name of the ET file to write, EB_STANDARD_STREAM for stdout
+ * @param tileSize The width and height of the tiles, a whole number of blocks
+ * @return 0 on success; BAD_DATA if the ebc file ran out of data; BAD_MALLOC if memory allocation fails;
+ * BAD_FILE or BAD_OUTPUT if the ET file cannot be written
+ */
+int ebcWriteTiled(EbcReader *reader, Image *image, char *filename, int tileSize)
+{
+    int tilesAcross = (image->width + tileSize - 1) / tileSize; // The number of tiles in a row of tiles
+    int tilesDown = (image->height + tileSize - 1) / tileSize;  // The number of rows of tiles
+    long tileAmount = (long)tilesAcross * tilesDown;             // The number of tiles
+    long tableBytes = (tileAmount + 1) * 8;                      // The size of the tile offset table
+    unsigned char *table = (unsigned char *)malloc((size_t)(EBC_TILED_HEADER_SIZE + tableBytes)); // The header and the table
+    Pixel **strip = ebCreate2DArray(tileSize < image->height ? tileSize : image->height, image->width); // A row of tiles
+    if (table == NULL || strip == NULL)
+    {
+        free(table);
+        if (strip != NULL)
+        {
+            ebFree2DArray(strip);
+        }
+        return BAD_MALLOC;
+    }
+
+    // Work out the header and where every tile goes
+    ebcPutLittleEndian(table, MAGIC_NUMBER_EBCTILED, 2);
+    table[2] = 5; // The bits per pixel
+    table[3] = 0;
+    ebcPutLittleEndian(table + 4, (unsigned long long)image->height, 4);
+    ebcPutLittleEndian(table + 8, (unsigned long long)image->width, 4);
+    ebcPutLittleEndian(table + 12, (unsigned long long)tileSize, 4);
+    ebcPutLittleEndian(table + 16, (unsigned long long)tileSize, 4);
+    unsigned long long offset = EBC_TILED_HEADER_SIZE + (unsigned long long)tableBytes; // Where the next tile starts
+    for (long tileIndex = 0; tileIndex < tileAmount; tileIndex++)
+    {
+        ebcPutLittleEndian(table + EBC_TILED_HEADER_SIZE + tileIndex * 8, offset, 8);
+        int tileWidth = ebcTileExtent(image->width, tileSize, (int)(tileIndex % tilesAcross));
+        int tileHeight = ebcTileExtent(image->height, tileSize, (int)(tileIndex / tilesAcross));
+        offset += (unsigned long long)tileHeight * ebcTileRowBytes(tileWidth);
+    }
+    ebcPutLittleEndian(table + EBC_TILED_HEADER_SIZE + tileAmount * 8, offset, 8);
 
-/**
- * This function reads the header of the file and stores the information in the image struct.
- *
- * @param fp The file pointer to the file that is being read
- * @param image The image struct that the header information is stored in
- * @param expectedMagicNumber The magic number that the file should have
- * @return 0 if the header was read correctly
- * @return one of the error codes in ebConstants.h if we encountered their respective error
- */
-int ebcRead(Image *image, char *filename, int expectedMagicNumber)
-{
-    // open the file
-    FILE *fp = fopen(filename, "rb");
+    int check = SUCCESS;
+    FILE *fp = ebOpenFile(filename, "wb"); // The header, table and tiles are written front to back, so stdout works too
     if (fp == NULL)
     { // Check if the file opened
-        return BAD_FILE;
+        check = BAD_FILE;
     }
-
-    int check = ebReadHeader(fp, image, expectedMagicNumber);
-    if (check != SUCCESS)
-    { // Check if the header was read correctly
-        fclose(fp);
-        return check;
+    else if (fwrite(table, 1, (size_t)(EBC_TILED_HEADER_SIZE + tableBytes), fp) != (size_t)(EBC_TILED_HEADER_SIZE + tableBytes))
+    { // Check the header and table were written
+        check = BAD_OUTPUT;
     }
 
-    int mode = 5;
-    int paradigmBlockAmount = 0;
-    if (expectedMagicNumber == MAGIC_NUMBER_EBCR32 || expectedMagicNumber == MAGIC_NUMBER_EBCR128)
-    { // Check if the file is compressed
-        if (expectedMagicNumber == MAGIC_NUMBER_EBCR32)
-        {                             // Check if the file is compressed with 32 paradigms
-            mode = 5;                 // Set the mode to 5 so that the data is read correctly
-            paradigmBlockAmount = 32; // Set the paradigm block amount to 32 so that the data is read correctly
+    BitWriter bits; // Packs the rows of the tiles
+    for (int tileY = 0; tileY < tilesDown && check == SUCCESS; tileY++)
+    { // Read a row of tiles, then write its tiles one after another
+        int tileHeight = ebcTileExtent(image->height, tileSize, tileY);
+        for (int stripY = 0; stripY < tileHeight && check == SUCCESS; stripY++)
+        {
+            check = ebcReadRow(reader, strip[stripY]);
         }
-        else if (expectedMagicNumber == MAGIC_NUMBER_EBCR128)
-        {                              // Check if the file is compressed with 128 paradigms
-            mode = 7;                  // Set the mode to 7 so that the data is read correctly
-            paradigmBlockAmount = 128; // Set the paradigm block amount to 128 so that the data is read correctly
+        for (int tileX = 0; tileX < tilesAcross && check == SUCCESS; tileX++)
+        {
+            int tileWidth = ebcTileExtent(image->width, tileSize, tileX);
+            for (int stripY = 0; stripY < tileHeight && check == SUCCESS; stripY++)
+            { // Every row of the tile starts on a byte boundary
+                bpuWriterInit(&bits, fp, 5);
+                check = bpuWritePixels(&bits, strip[stripY] + tileX * tileSize, tileWidth);
+                if (check == SUCCESS)
+                {
+                    check = bpuWriterFlush(&bits);
+                }
+            }
         }
-        // Read the paradigm block
-        image->paradigm = ebCreate2DArray(BLOCK_HEIGHT, paradigmBlockAmount * BLOCK_WIDTH); // Allocate memory for the paradigm block
-        if (image->paradigm == NULL)
-        { // If the memory allocation failed return an error
-            fclose(fp);
-            return BAD_MALLOC;
+    }
+
+    if (fp != NULL && ebCloseFile(fp) != 0 && check == SUCCESS)
+    { // Check everything reached the file
+        check = BAD_OUTPUT;
+    }
+    free(table);
+    ebFree2DArray(strip);
+    return check;
+}
+
+/**
+ * This function reads the whole of a stream into memory.
+ *
+ * @param fp The stream to read
+ * @param bytes Where to store the bytes, which the caller frees
+ * @param size Where to store the number of bytes
+ * @return 0 on success; BAD_MALLOC if memory allocation fails; BAD_FILE if the stream cannot be read
+ */
+static int ebcLoadStream(FILE *fp, unsigned char **bytes, long *size)
+{
+    long capacity = 65536; // How many bytes there is room for, doubled whenever it fills up
+    *size = 0;
+    *bytes = (unsigned char *)malloc((size_t)capacity);
+    while (*bytes != NULL)
+    {
+        *size += (long)fread(*bytes + *size, 1, (size_t)(capacity - *size), fp);
+        if (*size < capacity)
+        { // The stream has ended
+            break;
         }
-        fgetc(fp);                                                                                              // Skip the newline character at the end of the header
-        check = ebcUniversalReader(image->paradigm, fp, mode, BLOCK_HEIGHT, paradigmBlockAmount * BLOCK_WIDTH); // Read the paradigm block
-        if (check != SUCCESS)
-        { // Check if the data was read correctly
-            fclose(fp);
-            return check;
+        capacity *= 2;
+        unsigned char *moreBytes = (unsigned char *)realloc(*bytes, (size_t)capacity);
+        if (moreBytes == NULL)
+        {
+            free(*bytes);
         }
+        *bytes = moreBytes;
     }
-
-    // Get the data
-    image->data = ebCreate2DArray(image->height, image->width); // Allocate memory for the data
-    if (image->data == NULL)
-    { // If the memory allocation failed return an error
-        fclose(fp);
+    if (*bytes == NULL)
+    {
         return BAD_MALLOC;
     }
-
-    fgetc(fp); // skip the newline character at the end of the paradigm block
-
-    // Read the data
-    check = ebcUniversalReader(image->data, fp, mode, image->height, image->width);
-    if (check != SUCCESS)
-    { // Check if the data was read correctly
-        fclose(fp);
-        return check;
+    if (ferror(fp))
+    { // The stream stopped part way
+        free(*bytes);
+        *bytes = NULL;
+        return BAD_FILE;
     }
+    return SUCCESS;
+}
 
-    if (fgetc(fp) != EOF)
-    { // Try to read a byte from the file. If we are able to read a byte from the file then there is too much data in the file and we return an error
-        fclose(fp);
-        return BAD_DATA;
+/**
+ * This function reads bytes from the start of an ET file, from memory when the file is there.
+ *
+ * @param reader The reader of the file
+ * @param offset Where the bytes start in the file
+ * @param byteAmount The number of bytes to read
+ * @param store Where to store the bytes
+ * @return 1 if every byte was read; 0 if the file ends first
+ */
+static int ebcReadTiledBytes(EbcTiledReader *reader, long offset, long byteAmount, unsigned char *store)
+{
+    if (reader->mapping != NULL)
+    {
+        if (byteAmount > reader->mappingSize - offset)
+        {
+            return 0;
+        }
+        memcpy(store, reader->mapping + offset, (size_t)byteAmount);
+        return 1;
     }
-
-    fclose(fp);     // Close the file
-    return SUCCESS; // Return success
-} // ebcRead()
+    return fseeko(reader->fp, (off_t)offset, SEEK_SET) == 0 && fread(store, 1, (size_t)byteAmount, reader->fp) == (size_t)byteAmount;
+}
 
 /**
- * This function writes the header of the file and stores the information in the image struct.
+ * This function opens an ET file so regions of it can be read with ebcReadTiledRegion().
  *
- * @param fp The file pointer to the file that is being written
- * @param image The image struct that the header information is stored in
- * @param magicNumber The magic number that the file should have
- * @return 0 if the header was written correctly
- * @return one of the error codes in ebConstants.h if we encountered their respective error
+ * The header and the tile offset table are read and checked straight away, the tiles only when they are needed.
+ * The tiles are read out of order, so a regular file is mapped into memory when it can be and read through stdio
+ * otherwise, while stdin that is not a regular file, such as a pipe, is read into memory first.
+ *
+ * @param reader The reader to open
+ * @param filename The name of the ET file, EB_STANDARD_STREAM for stdin
+ * @return 0 if the file was opened correctly
+ * @return one of the error codes in ebConstants.h if we encountered their respective error, in which case nothing is left open
  */
-int ebcWrite(Image *image, char *filename, int magicNumber)
+int ebcOpenTiledReader(EbcTiledReader *reader, char *filename)
 {
-    // open the file
-    FILE *fp = fopen(filename, "wb");
-    if (fp == NULL)
+    reader->fp = ebOpenFile(filename, "rb");
+    if (reader->fp == NULL)
     { // Check if the file opened
         return BAD_FILE;
     }
+    reader->mapping = NULL;
+    reader->mappingSize = 0;
+    reader->mappingLoaded = 0;
+    reader->tileOffsets = NULL;
+    reader->tileRow = NULL;
 
-    // write the header
-    int check = ebWriteHeader(fp, image, magicNumber);
+    struct stat fileStatus; // Used to find out if the file can be mapped and how big it is
+    long fileSize = 0;      // The number of bytes in the file
+    int check = SUCCESS;
+    if (fstat(fileno(reader->fp), &fileStatus) == 0 && S_ISREG(fileStatus.st_mode) && ftello(reader->fp) == 0)
+    { // A regular file can be read out of order where it is
+        fileSize = (long)fileStatus.st_size;
+        void *mapping = fileSize > 0 ? mmap(NULL, fileStatus.st_size, PROT_READ, MAP_PRIVATE, fileno(reader->fp), 0) : MAP_FAILED;
+        if (mapping != MAP_FAILED)
+        { // Only regular, non empty files can be mapped
+            posix_madvise(mapping, fileStatus.st_size, POSIX_MADV_RANDOM); // Only the tiles of the regions asked for are read
+            reader->mapping = (const unsigned char *)mapping;
+            reader->mappingSize = fileSize;
+        }
+    }
+    else if (ebIsStandardStream(filename))
+    { // A stream can only be read front to back, so all of it is read first
+        unsigned char *bytes = NULL;
+        check = ebcLoadStream(reader->fp, &bytes, &fileSize);
+        reader->mapping = bytes;
+        reader->mappingSize = fileSize;
+        reader->mappingLoaded = 1;
+    }
+    else
+    { // The tiles are read out of order, so the file has to be seekable
+        check = BAD_FILE;
+    }
     if (check != SUCCESS)
-    { // Check if the header was written correctly
-        fclose(fp);
+    {
+        ebcCloseTiledReader(reader);
         return check;
     }
 
-    int mode = 5;
-    if (magicNumber == MAGIC_NUMBER_EBCR32 || magicNumber == MAGIC_NUMBER_EBCR128) // Check if the file is compressed
+    // Read and check the header
+    unsigned char header[EBC_TILED_HEADER_SIZE];
+    if (!ebcReadTiledBytes(reader, 0, EBC_TILED_HEADER_SIZE, header) || ebcGetLittleEndian(header, 2) != MAGIC_NUMBER_EBCTILED)
     {
-        if (magicNumber == MAGIC_NUMBER_EBCR32) // Check if the file is compressed with 32 paradigms
-        {
-            mode = 5; // Set the mode to 5 so the data can be read 5 bits at a time
+        check = BAD_MAGIC_NUMBER;
+    }
+    else if (header[2] != 5 || header[3] != 0)
+    { // Only 5 bit pixels are stored in tiles
+        check = BAD_DATA;
+    }
+    unsigned long long height = ebcGetLittleEndian(header + 4, 4);
+    unsigned long long width = ebcGetLittleEndian(header + 8, 4);
+    unsigned long long tileHeight = ebcGetLittleEndian(header + 12, 4);
+    unsigned long long tileWidth = ebcGetLittleEndian(header + 16, 4);
+    if (check == SUCCESS && (width < MIN_DIMENSION || width > MAX_DIMENSION || height < MIN_DIMENSION || height > MAX_DIMENSION))
+    {
+        check = BAD_DIM;
+    }
+    if (check == SUCCESS && (tileWidth < BLOCK_WIDTH || tileWidth > MAX_DIMENSION || tileWidth % BLOCK_WIDTH != 0 ||
+                             tileHeight < BLOCK_HEIGHT || tileHeight > MAX_DIMENSION || tileHeight % BLOCK_HEIGHT != 0))
+    { // The tiles have to line up with the blocks
+        check = BAD_DATA;
+    }
+    if (check != SUCCESS)
+    {
+        ebcCloseTiledReader(reader);
+        return check;
+    }
+    reader->width = (int)width;
+    reader->height = (int)height;
+    reader->tileWidth = (int)tileWidth;
+    reader->tileHeight = (int)tileHeight;
+    reader->tilesAcross = (reader->width + reader->tileWidth - 1) / reader->tileWidth;
+    reader->tilesDown = (reader->height + reader->tileHeight - 1) / reader->tileHeight;
+
+    // Read the tile offset table and check every tile is where it should be
+    long tileAmount = (long)reader->tilesAcross * reader->tilesDown; // The number of tiles
+    if (EBC_TILED_HEADER_SIZE + (unsigned long long)(tileAmount + 1) * 8 > (unsigned long long)fileSize)
+    { // The file is too short to hold the table, so nothing is allocated for it
+        ebcCloseTiledReader(reader);
+        return BAD_DATA;
+    }
+    unsigned char *table = (unsigned char *)malloc((size_t)(tileAmount + 1) * 8);
+    reader->tileOffsets = (unsigned long long *)malloc(sizeof(unsigned long long) * (size_t)(tileAmount + 1));
+    reader->tileRow = (Pixel *)malloc(sizeof(Pixel) * (size_t)reader->tileWidth);
+    if (table == NULL || reader->tileOffsets == NULL || reader->tileRow == NULL)
+    {
+        free(table);
+        ebcCloseTiledReader(reader);
+        return BAD_MALLOC;
+    }
+    if (!ebcReadTiledBytes(reader, EBC_TILED_HEADER_SIZE, (tileAmount + 1) * 8, table))
+    { // The file ends inside the table
+        check = BAD_DATA;
+    }
+    unsigned long long expected = EBC_TILED_HEADER_SIZE + (unsigned long long)(tileAmount + 1) * 8; // Where the next tile should start
+    for (long tileIndex = 0; tileIndex <= tileAmount && check == SUCCESS; tileIndex++)
+    {
+        reader->tileOffsets[tileIndex] = ebcGetLittleEndian(table + tileIndex * 8, 8);
+        if (reader->tileOffsets[tileIndex] != expected)
+        { // The tiles are packed one after another with nothing between them
+            check = BAD_DATA;
         }
-        else if (magicNumber == MAGIC_NUMBER_EBCR128) // Check if the file is compressed with 128 paradigms
+        if (tileIndex < tileAmount)
         {
-            mode = 7; // Set the mode to 7 so the data can be read 7 bits at a time
+            int thisTileWidth = ebcTileExtent(reader->width, reader->tileWidth, (int)(tileIndex % reader->tilesAcross));
+            int thisTileHeight = ebcTileExtent(reader->height, reader->tileHeight, (int)(tileIndex / reader->tilesAcross));
+            expected += (unsigned long long)thisTileHeight * ebcTileRowBytes(thisTileWidth);
         }
-        check = ebcUniversalWriter(image->paradigm, fp, mode, BLOCK_HEIGHT, image->paradigmBlockAmount * BLOCK_WIDTH); // Write the paradigm block
-        if (check != SUCCESS)                                                                                          // Check if the paradigm blocks were written correctly
-        {
-            fclose(fp);
-            return check;
+    }
+    if (check == SUCCESS && expected != (unsigned long long)fileSize)
+    { // The file has to end where the last tile ends
+        check = BAD_DATA;
+    }
+    free(table);
+    if (check != SUCCESS)
+    {
+        ebcCloseTiledReader(reader);
+    }
+    return check;
+}
+
+/**
+ * This function reads a region of an ET file, decoding only the rows of the tiles that the region covers.
+ *
+ * @param reader The reader, opened with ebcOpenTiledReader()
+ * @param regionX The column of the left edge of the region
+ * @param regionY The row of the top edge of the region
+ * @param regionWidth The width of the region
+ * @param regionHeight The height of the region
+ * @param store The rows to store the region in, regionHeight rows of regionWidth pixels
+ * @return 0 on success; BAD_DIM if the region is not inside the image; BAD_DATA if a tile cannot be read
+ */
+int ebcReadTiledRegion(EbcTiledReader *reader, int regionX, int regionY, int regionWidth, int regionHeight, Pixel **store)
+{
+    if (regionX < 0 || regionY < 0 || regionWidth < 1 || regionHeight < 1 ||
+        regionWidth > reader->width - regionX || regionHeight > reader->height - regionY)
+    { // Check the region is inside the image
+        return BAD_DIM;
+    }
+
+    for (int y = regionY; y < regionY + regionHeight; y++)
+    { // Loop through the rows of the region
+        int tileY = y / reader->tileHeight;                   // The row of tiles the row is in
+        int rowInTile = y - tileY * reader->tileHeight;        // The row of the tiles the row is
+        for (int tileX = regionX / reader->tileWidth; tileX * reader->tileWidth < regionX + regionWidth; tileX++)
+        { // Loop through the tiles the row of the region crosses
+            int tileWidth = ebcTileExtent(reader->width, reader->tileWidth, tileX);
+            long rowBytes = ebcTileRowBytes(tileWidth);
+            unsigned long long rowOffset = reader->tileOffsets[(long)tileY * reader->tilesAcross + tileX] + (unsigned long long)rowInTile * rowBytes;
+            if (reader->mapping != NULL)
+            { // Decode straight from the mapped file
+                bpuReaderInitMemory(&reader->bits, reader->mapping + rowOffset, rowBytes, 5, tileWidth);
+            }
+            else if (fseeko(reader->fp, (off_t)rowOffset, SEEK_SET) == 0)
+            { // Read just the row from the file
+                bpuReaderInit(&reader->bits, reader->fp, 5, tileWidth);
+            }
+            else
+            {
+                return BAD_DATA;
+            }
+            if (bpuReadPixels(&reader->bits, reader->tileRow, tileWidth) != SUCCESS)
+            {
+                return BAD_DATA;
+            }
+
+            int tileStart = tileX * reader->tileWidth;                                            // The column the tile starts at
+            int copyStart = regionX > tileStart ? regionX : tileStart;                            // The first column of the tile in the region
+            int copyEnd = regionX + regionWidth < tileStart + tileWidth ? regionX + regionWidth : tileStart + tileWidth; // One past the last
+            memcpy(store[y - regionY] + (copyStart - regionX), reader->tileRow + (copyStart - tileStart), sizeof(Pixel) * (size_t)(copyEnd - copyStart));
         }
+    }
+    return SUCCESS;
+}
 
-        check = fprintf(fp, "\n"); // Write a newline character at the end of the paradigm block
+/**
+ * This function closes an ET file opened with ebcOpenTiledReader().
+ *
+ * @param reader The reader to close
+ */
+void ebcCloseTiledReader(EbcTiledReader *reader)
+{
+    if (reader->mappingLoaded)
+    { // The file was read into memory from a stream
+        free((void *)reader->mapping);
+    }
+    else if (reader->mapping != NULL)
+    {
+        munmap((void *)reader->mapping, reader->mappingSize);
     }
+    free(reader->tileOffsets);
+    free(reader->tileRow);
+    ebCloseFile(reader->fp); // Close the file, stdin is left open
+}
 
-    check = ebcUniversalWriter(image->data, fp, mode, image->height, image->width); // Write the data
+/**
+ * This function reads a region of an ET file into the image struct.
+ *
+ * Only the tiles the region covers are decoded. Use ebcOpenTiledReader() to read many regions of one file.
+ *
+ * @param image The image struct that the region is read into
+ * @param filename The name of the ET file
+ * @param regionX The column of the left edge of the region
+ * @param regionY The row of the top edge of the region
+ * @param regionWidth The width of the region
+ * @param regionHeight The height of the region
+ * @return 0 if the region was read correctly
+ * @return one of the error codes in ebConstants.h if we encountered their respective error
+ */
+int ebcReadRegion(Image *image, char *filename, int regionX, int regionY, int regionWidth, int regionHeight)
+{
+    EbcTiledReader reader; // Reads the tiles of the region
+    int check = ebcOpenTiledReader(&reader, filename);
     if (check != SUCCESS)
-    { // Check if the data was written correctly
-        fclose(fp);
+    { // Check if the file was opened correctly
         return check;
     }
+    if (regionWidth < 1 || regionHeight < 1 || regionWidth > MAX_DIMENSION || regionHeight > MAX_DIMENSION)
+    { // Check the region can be held before allocating it
+        ebcCloseTiledReader(&reader);
+        return BAD_DIM;
+    }
 
-    fclose(fp);     // Close the file
-    return SUCCESS; // Return success
-} // ebcWrite()
+    image->height = regionHeight;
+    image->width = regionWidth;
+    image->paradigm = NULL;
+    image->paradigmBlockAmount = 0;
+    image->data = ebCreate2DArray(regionHeight, regionWidth); // Allocate memory for the region
+    if (image->data == NULL)
+    { // If the memory allocation failed return an error
+        ebcCloseTiledReader(&reader);
+        return BAD_MALLOC;
+    }
+    check = ebcReadTiledRegion(&reader, regionX, regionY, regionWidth, regionHeight, image->data);
+    ebcCloseTiledReader(&reader);
+    if (check != SUCCESS)
+    {
+        ebFree2DArray(image->data);
+    }
+    return check;
+}
 
 /**
- * This function initializes an ebcMask array with the values for the read mask.
- *
- * Variable 'm' is an array of 12 unsigned chars that hold the masks for the 12 masks.
- * The masks are as follows:
- * 248 = 11111000,  7 = 00000111, 192 = 11000000,  62 = 00111110, 1 = 00000001,
- * 240 = 11110000, 15 = 00001111, 128 = 10000000, 124 = 01111100, 3 = 00000011,
- * 224 = 11100000, 31 = 00011111
- *
- * Variable 'sA' is an array of 12 ints that hold the shift values for each mask in the
- * same index.
- * A positive value means that the bits are shifted to the right and a negative value
- * means that the bits are shifted to the left.
- *
- * Variable 'nBG' is an array of 12 ints that hold the number of bits that are gathered.
- * This is used to calculate the number of bits left in the current byte.
- * This value is calculated by counting the number of 1's in the mask using the btuPopCount function.
+ * This function writes a given set of pixel values to a file depending on the mode.
  *
- * @param mask The ebcMask array that is being initialized
+ * @param values The array of pixel values that are being written to the file
+ * @param fp The file pointer to the file that is being written to
+ * @param mode The number of bits every value is written with (1 to 16)
+ * @param height The height of the image
+ * @param width The width of the image
+ * @return Returns 0 if the function was successful; BAD_OUTPUT if the file cannot be written to
  */
-void ebcReadMask5Init(ebcMask *mask)
+int ebcUniversalWriter(Pixel **values, FILE *fp, int mode, int height, int width)
 {
-    unsigned char m[] = {248, 7, 192, 62, 1, 240, 15, 128, 124, 3, 224, 31}; // The masks
-    int sA[] = {3, -2, 6, 1, -4, 4, -1, 7, 2, -3, 5, 0};                     // The shift values
+    BitWriter writer; // Packs the pixels into bytes and buffers them for the file
+    bpuWriterInit(&writer, fp, mode);
 
-    for (int i = 0; i < 12; i++)
-    {                                               // Loop through the arrays and initialize the ebcMask array
-        mask[i].mask = m[i];                        // Set the mask value
-        mask[i].shift = sA[i];                      // Set the shift value
-        mask[i].noBitsGathered = btuPopCount(m[i]); // Set the number of bits gathered
+    for (int y = 0; y < height; y++)
+    { // Hand the packer one row at a time, it carries partial bytes over between rows
+        if (bpuWritePixels(&writer, values[y], width) != SUCCESS)
+        { // Check for write errors
+            return BAD_OUTPUT;
+        }
     }
-} // ebcReadMaskInit()
+
+    return bpuWriterFlush(&writer); // Write the last partial byte and anything still buffered
+}
 
 /**
- * This function initializes an ebcMask array with the values for the read mask for 7 bit reading.
+ * This function reads a given set of pixel values from bytes in memory depending on the mode.
  *
- * @param mask The ebcMask array that is being initialized
+ * @param store The array of pixel values to store the data that is read
+ * @param bytes The start of the memory being read
+ * @param size The number of bytes in the memory
+ * @param offset The position of the packed data, moved past it once it is read
+ * @param bitMode The number of bits every value is read with (1 to 16)
+ * @param height The height of the image
+ * @param width The width of the image
+ * @return Returns 0 if the function was successful; BAD_DATA if the memory ends before the last pixel
  */
-void ebcReadMask7Init(ebcMask *mask)
+int ebcUniversalMemoryReader(Pixel **store, const unsigned char *bytes, long size, long *offset, int bitMode, int height, int width)
 {
-    unsigned char m[] = {254, 1, 252, 3, 248, 7, 240, 15, 224, 31, 192, 63, 128, 127};
-    int sA[] = {1, -6, 2, -5, 3, -4, 4, -3, 5, -2, 6, -1, 7, 0};
+    long available = *offset < size ? size - *offset : 0; // The bytes left after the offset
+    BitReader reader;                                     // Unpacks straight from the memory
+    bpuReaderInitMemory(&reader, bytes + (*offset < size ? *offset : size), available, bitMode, (long)height * width);
 
-    for (int i = 0; i < 14; i++)
-    {
-        mask[i].mask = m[i];
-        mask[i].shift = sA[i];
-        mask[i].noBitsGathered = btuPopCount(m[i]);
+    for (int y = 0; y < height; y++)
+    { // Unpack straight into each row of the array
+        if (bpuReadPixels(&reader, store[y], width) != SUCCESS)
+        { // The memory ran out before the last pixel
+            return BAD_DATA;
+        }
     }
+
+    *offset += ((long)height * width * bitMode + 7) / 8; // Move past the packed data
+    return SUCCESS;
 }
 
 /**
- * This function initializes an ebcMask array with the values for the write mask.
- * The write mask is used to construct a byte from the 5 bits data in the data array.
- *
- * Variable 'm' is an array of 12 unsigned chars that hold the masks.
- * The masks are as follows:
- * 31 = 0b11111, 28 = 0b11100, 3 = 0b00011, 31 = 0b11111, 16 = 0b10000, 15 = 0b01111,
- * 30 = 0b11110, 1 = 0b00001, 31 = 0b11111, 24 = 0b11000, 7 = 0b00111, 31 = 0b11111
- *
- * Variable 'sA' is an array of 12 ints that hold the shift values for each mask in the same index.
- * A positive shift amount means that the bits are shifted to the right and a negative
- * shift amount means that the bits are shifted to the left.
- *
- * Variable 'nBG' is an array of 12 ints that hold the number of bits a mask gathers.
- * This is used to calculate the number of bits left in the current byte.
- * This value is calculated by counting the number of 1's in the mask using the btuPopCount function.
+ * This function reads a given set of pixel values from a file depending on the mode.
  *
- * @param mask The ebcMask array that is being initialized
+ * @param store The array of pixel values to store the data that is read from the file
+ * @param fp The file pointer to the file that is being read from
+ * @param bitMode The number of bits every value is read with (1 to 16)
+ * @param height The height of the image
+ * @param width The width of the image
+ * @return Returns 0 if the function was successful; BAD_DATA if the file has an incorrect number of pixels
  */
-void ebcWriteMask5Init(ebcMask *mask)
+int ebcUniversalReader(Pixel **store, FILE *fp, int bitMode, int height, int width)
 {
-    unsigned char m[] = {31, 28, 3, 31, 16, 15, 30, 1, 31, 24, 7, 31}; // Array of mask values
-    int sA[] = {-3, 2, -6, -1, 4, -4, 1, -7, -2, 3, -5, 0};            // Array of shift values
+    BitReader reader; // Reads exactly the packed bytes of height * width pixels and unpacks them
+    bpuReaderInit(&reader, fp, bitMode, (long)height * width);
 
-    for (int i = 0; i < 12; i++)
-    {                                               // Loop through the array of ebcMask structs and initialize each struct with their respective values
-        mask[i].mask = m[i];                        // Put the mask value in each mask struct
-        mask[i].shift = sA[i];                      // Put the shift amount in each mask struct
-        mask[i].noBitsGathered = btuPopCount(m[i]); // Put the number of bits gathered in each mask struct
+    for (int y = 0; y < height; y++)
+    { // Unpack straight into each row of the array
+        if (bpuReadPixels(&reader, store[y], width) != SUCCESS)
+        { // If we fail to read a byte then there is something wrong with the file and we return an error
+            return BAD_DATA;
+        }
     }
-} // ebcWriteMaskInit()
+
+    return SUCCESS;
+}
+
 
 /**
- * This function initializes an ebcMask array with the values for the write mask for 7 bit writing.
+ * This function unpacks or packs the pixels of one chunk, run on a thread of its own or the calling thread.
+ *
+ * A chunk starts on a group boundary, so its packed bytes start on a byte boundary and do not share a
+ * byte with any other chunk. Its pixels are unpacked a row at a time, the first and last rows partly.
+ * A chunk being packed covers whole rows, which packRow packs one after another into its memory.
  *
- * @param mask The ebcMask array that is being initialized
+ * @param argument The chunk, an EbcChunk
+ * @return NULL, the result is left in the check of the chunk
  */
-void ebcWriteMask7Init(ebcMask *mask)
+static void *ebcChunkWorker(void *argument)
 {
-    unsigned char m[] = {127, 64, 63, 96, 31, 112, 15, 120, 7, 124, 3, 126, 1, 127};
-    int sA[] = {-1, 6, -2, 5, -3, 4, -4, 3, -5, 2, -6, 1, -7, 0};
-
-    for (int i = 0; i < 14; i++)
+    EbcChunk *chunk = (EbcChunk *)argument;
+    long pixel = chunk->firstPixel;                   // The next pixel of the chunk
+    long endPixel = chunk->firstPixel + chunk->pixelAmount; // One past the last pixel of the chunk
+    int check = SUCCESS;
+    if (!chunk->decoding)
     {
-        mask[i].mask = m[i];
-        mask[i].shift = sA[i];
-        mask[i].noBitsGathered = btuPopCount(m[i]);
+        long rowBits = (long)chunk->width * chunk->packer.bitWidth; // The bits of every packed row
+        for (int y = (int)(pixel / chunk->width); y < endPixel / chunk->width && check == SUCCESS; y++)
+        { // Loop through the rows the chunk covers
+            chunk->packRow(chunk->source, y, chunk->packedRow);
+            check = bpuWriteBits(&chunk->packer, chunk->packedRow, rowBits);
+        }
+        chunk->check = check == SUCCESS ? bpuWriterFlush(&chunk->packer) : check; // Pad the last chunk out to a whole byte
+        return NULL;
     }
+    while (pixel < endPixel && check == SUCCESS)
+    { // Loop through the rows the chunk covers
+        int y = (int)(pixel / chunk->width);         // The row the pixel is in
+        int x = (int)(pixel - (long)y * chunk->width); // The column the pixel is in
+        int count = chunk->width - x;                // The pixels of the chunk in this row
+        if (count > endPixel - pixel)
+        {
+            count = (int)(endPixel - pixel);
+        }
+        check = bpuReadPixels(&chunk->bits, chunk->rows[y] + x, count);
+        pixel += count;
+    }
+    chunk->check = check;
+    return NULL;
 }
 
 /**
- * This function writes a given set of pixel values to a file depending on the mode.
+ * This function cuts the pixels of an image into chunks of whole groups, one for every thread that is worth starting.
  *
- * @param values The array of pixel values that are being written to the file
- * @param fp The file pointer to the file that is being written to
- * @param mode The mode that is being used to write the data to the file (5 or 7 bit)
  * @param height The height of the image
  * @param width The width of the image
- * @return Returns 0 if the function was successful; BAD_OUTPUT if the file cannot be written to
+ * @param threadAmount The most threads to use
+ * @param chunkAmount Where to store the number of chunks
+ * @return The chunks, with their rows and readers still to be filled in; NULL if the memory cannot be allocated
  */
-int ebcUniversalWriter(unsigned int **values, FILE *fp, int mode, int height, int width)
-{
-    /**
-     * The following code is used to write the data to the file.
-     * One pixel is read from the data array.
-     * The pixel is then masked with ebcWriteMask and the bits are shifted according to the shift value in the mask.
-     * The masked and shifted bits are then added to the cleanBuffer and the number of bits added to the cleanBuffer is
-     * counted in bitsGathered.
-     * The number of bits that have been read from the pixel is subtracted from bitsLeft.
-     * If the cleanBuffer has 8 bits it is written to the file and the cleanBuffer is cleared.
-     * If the bitsLeft is 0 then a new pixel is read from the data array.
-     * Then we advance to the next mask and repeat the process until the pixelCount is equal to the number of pixels in the image
-     * and the cleanBuffer is empty.
-     */
-    int check = 0;                 // Used to check if the write was successful
-    int bitsRead = mode;           // Number of bits read from the current byte
-    int bitsGathered = 0;          // Number of bits that have been added to the cleanBuffer
-    unsigned char dirtyBuffer = 0; // The working buffer that holds the bits that have not been positioned to fit the 8 bit byte
-    unsigned char cleanBuffer = 0; // The buffer that holds the bits that have been positioned to fit the 8 bit byte
-    unsigned char currentByte = 0; // The current byte that is read from the image data array
-    int pixelCount = 0;            // How times we have read a pixel from the data array
-    int run = GO;                  // Controls the loop
-    ebcMask mask[14];              // The array of masks
-    int maskAmount = 12;           // The number of masks
-    if (mode == 5)
-    {
-        ebcWriteMask5Init(mask); // Initialise the masks in the array as an ebcWriteMask
-        maskAmount = 12;         // Set the number of masks
+static EbcChunk *ebcCreateChunks(int height, int width, int threadAmount, int *chunkAmount)
+{
+    long pixelAmount = (long)height * width;                                     // The number of pixels in the image
+    long groupAmount = (pixelAmount + BPU_GROUP_PIXELS - 1) / BPU_GROUP_PIXELS; // The number of groups, the last maybe partly filled
+    long most = pixelAmount / EBC_MIN_CHUNK_PIXELS;                             // The most chunks that are worth a thread each
+    *chunkAmount = threadAmount < most ? threadAmount : (int)most;
+    if (*chunkAmount < 1)
+    {
+        *chunkAmount = 1;
     }
-    else
+    long chunkGroups = (groupAmount + *chunkAmount - 1) / *chunkAmount; // The groups in every chunk but the last
+    *chunkAmount = (int)((groupAmount + chunkGroups - 1) / chunkGroups);  // Rounding up may leave nothing for the last chunks
+
+    EbcChunk *chunks = (EbcChunk *)malloc(sizeof(EbcChunk) * (size_t)*chunkAmount);
+    if (chunks == NULL)
+    {
+        return NULL;
+    }
+    for (int chunkIndex = 0; chunkIndex < *chunkAmount; chunkIndex++)
     {
-        ebcWriteMask7Init(mask); // Initialise the masks in the array as an ebcWriteMask
-        maskAmount = 14;         // Set the number of masks
+        chunks[chunkIndex].width = width;
+        chunks[chunkIndex].firstPixel = chunkIndex * chunkGroups * BPU_GROUP_PIXELS;
+        chunks[chunkIndex].pixelAmount = pixelAmount - chunks[chunkIndex].firstPixel;
+        if (chunks[chunkIndex].pixelAmount > chunkGroups * BPU_GROUP_PIXELS)
+        {
+            chunks[chunkIndex].pixelAmount = chunkGroups * BPU_GROUP_PIXELS;
+        }
+        chunks[chunkIndex].check = SUCCESS;
     }
+    return chunks;
+}
 
-    while (run)
+/**
+ * This function runs ebcChunkWorker() on every chunk, the first on the calling thread and the others on threads of their own.
+ *
+ * @param chunks The chunks, ready to be worked on
+ * @param chunkAmount The number of chunks
+ * @return 0 if every chunk was done; the error code of the first chunk that failed otherwise
+ */
+static int ebcRunChunks(EbcChunk *chunks, int chunkAmount)
+{
+    int threadsStarted = 0; // The number of extra threads that are running
+    for (int chunkIndex = 1; chunkIndex < chunkAmount; chunkIndex++)
     {
-        for (int i = 0; i < maskAmount; i++)
+        if (pthread_create(&chunks[chunkIndex].thread, NULL, ebcChunkWorker, &chunks[chunkIndex]) != 0)
         {
-            if (bitsRead == mode)
-            {                                                                 // Check if we need to read a new byte (if we have read all the bits from the current pixel)
-                currentByte = values[pixelCount / width][pixelCount % width]; // If we need to, read a pixel from the data array and store it in the currentByte
-                bitsRead = 0;                                                 // Reset the bitsRead counter
-                pixelCount++;                                                 // Increment the pixelCount
-            }
-            dirtyBuffer = currentByte & mask[i].mask;               // Mask the pixel with the mask
-            btuMultiDirectionBitShift(&dirtyBuffer, mask[i].shift); // Shift the bits according to the shift value in the mask
-            cleanBuffer = cleanBuffer | dirtyBuffer;                // Append the masked and shifted bits to the cleanBuffer
-            bitsRead = bitsRead + mask[i].noBitsGathered;           // Add the number of bits read from the pixel to the bitsRead counter
-            bitsGathered = bitsGathered + mask[i].noBitsGathered;   // Add the number of bits read from the pixel to the bitsGathered counter
-            if (bitsGathered == 8)
-            {                                           // Check if we have read 8 bits to the cleanBuffer
-                check = fwrite(&cleanBuffer, 1, 1, fp); // Write the cleanBuffer to the file if we have read 8 bits
-                if (check == 0)
-                { // Check for write errors
-                    return BAD_OUTPUT;
-                }
-                bitsGathered = 0; // Reset the bitsGathered counter
-                cleanBuffer = 0;  // Reset the cleanBuffer
-            }
-            dirtyBuffer = 0; // Reset the dirtyBuffer
-            if (pixelCount == height * width)
-            { // Check if we have read the expected number of pixels
-                if (bitsGathered != 0)
-                {                                           // Check if the cleanBuffer is empty
-                    check = fwrite(&cleanBuffer, 1, 1, fp); // Write the cleanBuffer to the file if it is not empty
-                    if (check == 0)
-                    { // Check for write errors
-                        return BAD_OUTPUT;
-                    }
-                }
-                run = STOP; // If we have read the expected number of pixel and there is no more data in the cleanBuffer then we exit the loop
-                break;      // Exit the loop
-            }
+            break; // The chunks without a thread are done on the calling thread
         }
+        threadsStarted++;
+    }
+    ebcChunkWorker(&chunks[0]);
+    for (int chunkIndex = threadsStarted + 1; chunkIndex < chunkAmount; chunkIndex++)
+    {
+        ebcChunkWorker(&chunks[chunkIndex]);
+    }
+    for (int chunkIndex = 1; chunkIndex <= threadsStarted; chunkIndex++)
+    {
+        pthread_join(chunks[chunkIndex].thread, NULL);
     }
 
+    for (int chunkIndex = 0; chunkIndex < chunkAmount; chunkIndex++)
+    {
+        if (chunks[chunkIndex].check != SUCCESS)
+        {
+            return chunks[chunkIndex].check;
+        }
+    }
     return SUCCESS;
 }
 
 /**
- * This function reads a given set of pixel values from a file depending on the mode.
+ * This function reads a given set of pixel values from bytes in memory like ebcUniversalMemoryReader(), decoding chunks of them at the same time.
  *
- * @param store The array of pixel values to store the data that is read from the file
- * @param fp The file pointer to the file that is being read from
- * @param bitMode The mode that is being used to read the data from the file (5 or 7 bit)
+ * Every 8 pixels end on a byte boundary whatever the mode, so a chunk starting at any multiple of 8 pixels
+ * starts at a byte that can be worked out without decoding anything before it.
+ *
+ * @param store The array of pixel values to store the data that is read
+ * @param bytes The start of the memory being read
+ * @param size The number of bytes in the memory
+ * @param offset The position of the packed data, moved past it once it is read
+ * @param bitMode The number of bits every value is read with (1 to 16)
  * @param height The height of the image
  * @param width The width of the image
- * @return Returns 0 if the function was successful; BAD_DATA if the file has an incorrect number of pixels
+ * @param threadAmount The most threads to decode with
+ * @return Returns 0 if the function was successful; BAD_DATA if the memory ends before the last pixel; BAD_MALLOC if the chunks cannot be allocated
  */
-int ebcUniversalReader(unsigned int **store, FILE *fp, int bitMode, int height, int width)
-{
-    /**
-     * The following code is used to read the data from the file.
-     * One byte is read from the file.
-     * The byte is then masked with ebcReadMask and the bits are shifted according to the shift value in the mask.
-     * The masked and shifted byte is then added to the cleanBuffer and the number of bits added to the cleanBuffer is
-     * counted in bitsGathered.
-     * The number of bits that have been read from the byte is subtracted from bitsLeft.
-     * If the cleanBuffer has 5 bits it is written to the data array and the cleanBuffer is cleared and we add 1 to the pixelCount.
-     * If the bitsLeft is 0 then a new byte is read from the file.
-     * Then we advance to the next mask and repeat the process until the pixelCount is equal to the number of pixels in the image.
-     */
-    int check = 0;                 // Used to check if the read was successful
-    int bitsLeft = 0;              // The number of bits left in the current byte
-    int bitsGathered = 0;          // The number of bits that have been added to the cleanBuffer
-    unsigned char cleanBuffer = 0; // The buffer that holds the bits from the file that are in their correct position
-    unsigned char dirtyBuffer = 0; // The buffer that holds the bits from the file that are not in their correct position
-    unsigned char currentByte = 0; // The current byte that is read from the file
-    int pixelCount = 0;            // The number of pixels that have been read from the file
-    int run = GO;                  // Used to control the loop
-    int maskAmount = 12;           // The number of masks
-    ebcMask mask[14];              // The array of masks
-    if (bitMode == 5)
-    {
-        maskAmount = 12;        // Set the number of masks
-        ebcReadMask5Init(mask); // Initialise the masks in the array as an ebcReadMask
-    }
-    else
+int ebcUniversalParallelReader(Pixel **store, const unsigned char *bytes, long size, long *offset, int bitMode, int height, int width, int threadAmount)
+{
+    int chunkAmount = 0; // The number of chunks the pixels are cut into
+    EbcChunk *chunks = ebcCreateChunks(height, width, threadAmount, &chunkAmount);
+    if (chunks == NULL)
     {
-        maskAmount = 14;        // Set the number of masks
-        ebcReadMask7Init(mask); // Initialise the masks in the array as an ebcReadMask
+        return BAD_MALLOC;
+    }
+    for (int chunkIndex = 0; chunkIndex < chunkAmount; chunkIndex++)
+    { // Point every chunk at its first byte, the readers are set up here so only the calling thread picks the kernels
+        long start = *offset + chunks[chunkIndex].firstPixel / BPU_GROUP_PIXELS * bitMode; // The first byte of the chunk
+        long available = start < size ? size - start : 0;                                     // The file may end before the chunk starts
+        chunks[chunkIndex].rows = store;
+        chunks[chunkIndex].decoding = 1;
+        bpuReaderInitMemory(&chunks[chunkIndex].bits, bytes + (start < size ? start : size), available, bitMode, chunks[chunkIndex].pixelAmount);
     }
 
-    while (run)
-    {
-        for (int i = 0; i < maskAmount; i++)
-        { // Loop through the masks
-            // Check if we need to read a new byte (if we have read all the bits from the current byte)
-            if (bitsLeft == 0)
-            {
-                check = fread(&currentByte, 1, 1, fp);
-                bitsLeft = 8; // Reset the bitsLeft counter
-                if (check == 0)
-                { // If we fail to read a byte then there is something wrong with the file and we return an error
-                    fclose(fp);
-                    return BAD_DATA;
-                }
-            }
-            dirtyBuffer = currentByte & mask[i].mask;               // Mask the byte with the mask
-            btuMultiDirectionBitShift(&dirtyBuffer, mask[i].shift); // Shift the bits according to the shift value in the mask
-            cleanBuffer = cleanBuffer | dirtyBuffer;                // Add the masked and shifted bits to the cleanBuffer
-            bitsLeft = bitsLeft - mask[i].noBitsGathered;           // Subtract the number of bits read from the byte from the bitsLeft counter
-            bitsGathered = bitsGathered + mask[i].noBitsGathered;   // Add the number of bits read from the byte to the bitsGathered counter
-            if (bitsGathered == bitMode)
-            {                                                                              // Check if we have read the amount bits depending on the mode to the cleanBuffer (5 or 7)
-                store[pixelCount / width][pixelCount % width] = (unsigned int)cleanBuffer; // Write the cleanBuffer to the data array if we have read 5 bits
-                bitsGathered = 0;                                                          // Reset the bitsGathered counter
-                cleanBuffer = 0;                                                           // Reset the cleanBuffer
-                pixelCount++;                                                              // Increment the pixelCount
-            }
-            dirtyBuffer = 0; // Reset the dirtyBuffer
-            if (pixelCount == height * width)
-            {               // Check if we have read the expected number of pixels
-                run = STOP; // If we have read the expected number of pixels and there is no more data in the file then we exit the loop
-                break;
-            }
+    int check = ebcRunChunks(chunks, chunkAmount);
+    free(chunks);
+    if (check != SUCCESS)
+    { // The memory ran out before the last pixel
+        return BAD_DATA;
+    }
+    *offset += ((long)height * width * bitMode + 7) / 8; // Move past the packed data
+    return SUCCESS;
+}
+
+/**
+ * This function works out how many rows ebcWritePackedRows() should be handed at a time, so that every
+ * thread has at least EBC_MIN_CHUNK_PIXELS pixels to pack without holding more than that much at once.
+ *
+ * The height is a multiple of 8, so every band of rows ends on a byte boundary whatever the width and
+ * the bits per pixel, and the packed bands are written with whole bytes.
+ *
+ * @param rowPixels The number of pixels a row stands for in the image being written
+ * @param threadAmount The most threads to pack with
+ * @return The number of rows in a band, a multiple of 8
+ */
+int ebcPackingBandHeight(long rowPixels, int threadAmount)
+{
+    long bandPixels = (long)(threadAmount > 1 ? threadAmount : 1) * EBC_MIN_CHUNK_PIXELS; // The pixels worth packing in one band
+    long height = rowPixels > 0 ? (bandPixels + rowPixels - 1) / rowPixels : 1;        // Never more than bandPixels
+    return (int)((height + 7) / 8 * 8);
+}
+
+/**
+ * This function writes the next rows of a file opened with ebcOpenWriter(), packing chunks of them at the same time.
+ *
+ * The rows are cut into chunks of a multiple of 8 rows, one for every thread of workspace->threadAmount
+ * that gets at least EBC_MIN_CHUNK_PIXELS pixels. Every chunk is packed into memory of its own, starting
+ * on a byte boundary, then the chunks are written in order, so the file is the same byte for byte as
+ * writing every row with ebcWritePackedRow(). With one chunk the rows are packed and written one at a
+ * time on the calling thread. Like ebcWritePackedRow(), this cannot write the indices of an EA file.
+ *
+ * @param writer The writer to write to
+ * @param rowAmount The number of rows to write
+ * @param packRow Packs a row, counting from the first row of this call, starting on a byte boundary; it is called from several threads at once
+ * @param source What packRow packs the rows from
+ * @param workspace Where the packed rows are kept, and how many threads to pack with
+ * @return 0 if the rows were written correctly; BAD_OUTPUT if the file cannot be written to; BAD_MALLOC if memory allocation fails
+ */
+int ebcWritePackedRows(EbcWriter *writer, int rowAmount, EbcRowPacker packRow, const void *source, EbcWorkspace *workspace)
+{
+    long rowBits = (long)writer->width * writer->bits.bitWidth;   // The bits of every packed row
+    long rowBytes = (rowBits + 7) / 8 + EBC_PACKED_ROW_SLACK;      // The room packRow needs for a row
+    long most = (long)rowAmount * writer->width / EBC_MIN_CHUNK_PIXELS; // The most chunks that are worth a thread each
+    int chunkAmount = workspace->threadAmount < most ? workspace->threadAmount : (int)most;
+    int check = SUCCESS;
+    if (chunkAmount <= 1)
+    { // Not worth a thread, pack the rows one at a time
+        unsigned char *packedRow = ebcReusePacked(workspace, rowBytes);
+        if (packedRow == NULL)
+        {
+            return BAD_MALLOC;
+        }
+        for (int y = 0; y < rowAmount && check == SUCCESS; y++)
+        {
+            packRow(source, y, packedRow);
+            check = ebcWritePackedRow(writer, packedRow);
         }
+        return check;
     }
 
-    return SUCCESS;
+    int chunkRows = ((rowAmount + chunkAmount - 1) / chunkAmount + 7) / 8 * 8; // The rows in every chunk but the last, so every chunk is whole bytes
+    chunkAmount = (rowAmount + chunkRows - 1) / chunkRows;                      // Rounding up may leave nothing for the last chunks
+    long chunkBytes = chunkRows * rowBits / 8;                                 // The packed bytes of a whole chunk
+    EbcChunk *chunks = (EbcChunk *)malloc(sizeof(EbcChunk) * (size_t)chunkAmount);
+    unsigned char *packed = ebcReusePacked(workspace, (chunkBytes + rowBytes) * chunkAmount); // Every chunk followed by room for its packed row
+    if (chunks == NULL || packed == NULL)
+    {
+        free(chunks);
+        return BAD_MALLOC;
+    }
+    for (int chunkIndex = 0; chunkIndex < chunkAmount; chunkIndex++)
+    {
+        EbcChunk *chunk = &chunks[chunkIndex];
+        int firstRow = chunkIndex * chunkRows; // The first row of the chunk
+        unsigned char *chunkPacked = packed + chunkIndex * (chunkBytes + rowBytes);
+        chunk->width = writer->width;
+        chunk->firstPixel = (long)firstRow * writer->width;
+        chunk->pixelAmount = (long)(rowAmount - firstRow < chunkRows ? rowAmount - firstRow : chunkRows) * writer->width;
+        chunk->decoding = 0;
+        chunk->packRow = packRow;
+        chunk->source = source;
+        chunk->packedRow = chunkPacked + chunkBytes;
+        bpuWriterInitMemory(&chunk->packer, chunkPacked, chunkBytes, writer->bits.bitWidth);
+        chunk->check = SUCCESS;
+    }
+
+    check = ebcRunChunks(chunks, chunkAmount);
+    for (int chunkIndex = 0; chunkIndex < chunkAmount && check == SUCCESS; chunkIndex++)
+    { // Write the chunks in order
+        check = bpuWriteBits(&writer->bits, chunks[chunkIndex].packer.bytes, chunks[chunkIndex].pixelAmount * writer->bits.bitWidth);
+    }
+    free(chunks);
+    return check;
 }
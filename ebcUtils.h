@@ -3,8 +3,11 @@
 
 #include "ebUniversalUtils.h"
 #include "bitTwiddlingUtils.h"
+#include "bitPackUtils.h"
+#include "ransUtils.h"
 #include <math.h>
 #include "blockUtils.h"
+#include <pthread.h>
 #define MAGIC_NUMBER_EBC 0x6365
 #define GO 1
 #define STOP 0
@@ -13,18 +16,128 @@
 #define MAGIC_NUMBER_EBCBLOCK 0x4345
 #define MAGIC_NUMBER_EBCR32 0x3545
 #define MAGIC_NUMBER_EBCR128 0x3745
+#define MAGIC_NUMBER_EBCR 0x5245 // ER, an R family file that records its number of paradigm blocks
+#define MAGIC_NUMBER_EBCRA 0x4145 // EA, an ER file whose paradigm block indices are entropy coded with rANS
+#define MAGIC_NUMBER_EBCR_FAMILY 0 // Expected in place of a magic number to accept whichever of E5, E7, ER or EA the file is
+#define EBC_MIN_PARADIGMS 2       // The fewest paradigm blocks an ER or EA file can have
+#define EBC_MAX_PARADIGMS 4096    // The most paradigm blocks an ER or EA file can have
+#define EBC_CODED_LENGTH_SIZE 8   // The bytes of the length of a block of coded indices of an EA file
+#define EBC_CODED_BLOCK_INDICES 1048576 // The indices of an EA file are coded in blocks of this many, so they are never all held in memory at once
+#define MAGIC_NUMBER_EBCTILED 0x5445 // ET, an ebc image cut into tiles that can be decoded on their own
+#define EBC_TILED_HEADER_SIZE 20     // The bytes of the fixed header of an ET file, before the tile offset table
+#define EBC_TILE_SIZE 192            // The width and height of the tiles when none is asked for, a whole number of blocks
+#define EBC_MIN_CHUNK_PIXELS 262144 // The fewest pixels worth packing or unpacking on a thread of their own, a whole number of groups
+#define EBC_MAX_THREADS 1024        // The most threads the work on one file is spread over
+#define EBC_PACKED_ROW_SLACK 4      // The bytes a row packer may write past the end of its row, as bpuPackGathered() does
 
-typedef struct ebcmask{
-    unsigned char mask;
-    int shift;
-    unsigned int noBitsGathered;
-} ebcMask;
-
-int ebcRead(Image *image, char * filename, int magicNumberMode);
-int ebcWrite(Image * image, char * filename, int magicNumberMode);
-void ebcReadMask5Init(ebcMask *mask);
-void ebcWriteMask5Init(ebcMask *mask);
-int ebcUniversalWriter(unsigned int ** values, FILE * fp, int mode, int height, int width);
-int ebcUniversalReader(unsigned int ** store, FILE * fp, int mode, int height, int width);
+typedef struct ebcReader{
+    FILE *fp;                     // The file being read, NULL when the file was handed over in memory
+    const unsigned char *mapping; // The file mapped into memory, or handed over in memory; NULL when it is read through stdio
+    long mappingSize;             // The size of the mapped file
+    long dataStart;               // Where the data of the mapped file starts
+    long dataEnd;                 // Where the data of the mapped file should end
+    int width;                    // How many pixels are in a row
+    BitReader bits;               // Unpacks the pixels
+    int entropyCoded;             // Whether the pixels are decoded by rans rather than unpacked by bits
+    RansDecoder rans;             // Decodes the block of indices of an EA file being read
+    unsigned char *coded;         // The coded block of indices of an EA file read through stdio, NULL otherwise
+    long codedCapacity;           // How many bytes there is room for in coded
+    long codedLeft;               // The indices of the block being decoded that are still to come
+    long indicesLeft;             // The indices of an EA file in the blocks after the one being decoded
+    int symbolAmount;             // The number of paradigm blocks the indices of an EA file pick from
+} EbcReader;
+
+typedef struct ebcWriter{
+    FILE *fp;         // The file being written
+    int ownsFile;     // Whether the file was opened by the writer and is closed with it
+    int width;        // How many pixels are in a row
+    BitWriter bits;   // Packs the pixels
+    EbIndex *symbols; // The indices of an EA file, kept until a block of them is full since rANS codes them back to front; NULL otherwise
+    long symbolCount; // How many indices are in symbols
+    long symbolCapacity; // How many indices make a block, EBC_CODED_BLOCK_INDICES unless the image has fewer
+    int symbolAmount; // The number of paradigm blocks the indices pick from
+    int codedBlocks;  // How many blocks of indices have been written
+} EbcWriter;
+
+typedef struct ebcWorkspace{
+    EbBuffer pixels;       // The pixels of the image being read, or a strip of them
+    EbBuffer compressed;   // The block averages of the image being made or read, or a band of them
+    EbIndexBuffer indices; // The paradigm block indices of the compressed image being made or read
+    Block *blocks;         // The blocks of the image being compressed
+    int blockCapacity;     // How many blocks there is room for
+    unsigned char *packed; // A packed row of the image being written
+    long packedCapacity;   // How many bytes there is room for in packed
+    const unsigned char *input; // The input file already read into memory by the caller, NULL to open it by name
+    long inputSize;             // The bytes of the input file in memory
+    FILE *output;               // The stream to write the output file to, NULL to open it by name
+    int threadAmount;           // The most threads the work on one file may use
+} EbcWorkspace;
+
+typedef void (*EbcRowPacker)(const void *source, int y, unsigned char *packed); // Packs row y of an image being written from source, see ebcWritePackedRows()
+
+typedef struct ebcChunk{
+    Pixel **rows;               // The rows of the image the chunk is part of
+    int width;                  // How many pixels are in a row
+    long firstPixel;            // The first pixel of the chunk counting along the rows, always the first of a group
+    long pixelAmount;           // The number of pixels in the chunk
+    int decoding;               // Whether the chunk is unpacked into the rows rather than packed by packRow
+    BitReader bits;             // Unpacks the chunk straight from memory
+    EbcRowPacker packRow;       // Packs the rows of a chunk being packed, which always covers whole rows
+    const void *source;         // What packRow packs the rows from
+    unsigned char *packedRow;   // Room for one row packed by packRow
+    BitWriter packer;           // Packs the chunk straight into memory
+    int check;                  // 0 once the chunk is done, otherwise the error code it stopped with
+    pthread_t thread;           // The thread working on the chunk, unused for the calling thread
+} EbcChunk;
+
+typedef struct ebcTiledReader{
+    FILE *fp;                        // The file being read
+    const unsigned char *mapping;    // The file mapped into memory, or read into memory from a stream; NULL when it is read through stdio
+    long mappingSize;                // The size of the mapped file
+    int mappingLoaded;               // Whether the file was read into memory from a stream, so it is freed rather than unmapped
+    int width;                       // How many pixels are in a row of the image
+    int height;                      // How many rows the image has
+    int tileWidth;                   // How many pixels are in a row of a tile, except at the right edge
+    int tileHeight;                  // How many rows a tile has, except at the bottom edge
+    int tilesAcross;                 // The number of tiles in a row of tiles
+    int tilesDown;                   // The number of rows of tiles
+    unsigned long long *tileOffsets; // Where every tile starts in the file, row of tiles by row of tiles, then where the file ends
+    Pixel *tileRow;                  // Scratch space for one row of a tile
+    BitReader bits;                  // Unpacks the rows of the tiles
+} EbcTiledReader;
+
+int ebcOpenReader(EbcReader * reader, Image * image, char * filename, int expectedMagicNumber);
+int ebcOpenMemoryReader(EbcReader * reader, Image * image, const unsigned char * bytes, long size, int expectedMagicNumber);
+int ebcOpenInput(EbcReader * reader, Image * image, char * filename, int expectedMagicNumber, const EbcWorkspace * workspace);
+int ebcReadRow(EbcReader * reader, Pixel * row);
+int ebcReadIndexRow(EbcReader * reader, EbIndex * row);
+int ebcCloseReader(EbcReader * reader);
+int ebcOpenWriter(EbcWriter * writer, Image * image, char * filename, int magicNumber);
+int ebcOpenStreamWriter(EbcWriter * writer, Image * image, FILE * fp, int magicNumber);
+int ebcOpenOutput(EbcWriter * writer, Image * image, char * filename, int magicNumber, const EbcWorkspace * workspace);
+void ebcDiscardOutput(char * filename, const EbcWorkspace * workspace);
+int ebcWriteRow(EbcWriter * writer, Pixel * row);
+int ebcWriteIndexRow(EbcWriter * writer, EbIndex * row);
+int ebcWritePackedRow(EbcWriter * writer, const unsigned char * packed);
+int ebcWritePackedRows(EbcWriter * writer, int rowAmount, EbcRowPacker packRow, const void * source, EbcWorkspace * workspace);
+int ebcPackingBandHeight(long rowPixels, int threadAmount);
+int ebcCloseWriter(EbcWriter * writer);
+int ebcIndexBitWidth(int paradigmBlockAmount);
+void ebcInitWorkspace(EbcWorkspace * workspace);
+int ebcProcessorAmount(void);
+unsigned char * ebcReusePacked(EbcWorkspace * workspace, long byteAmount);
+void ebcFreeWorkspace(EbcWorkspace * workspace);
+int ebcRead(Image *image, char * filename, int magicNumberMode, int threadAmount, EbBuffer * buffer);
+int ebcReadOpened(EbcReader * reader, Image * image, int threadAmount, EbBuffer * buffer);
+int ebcReadIndicesOpened(EbcReader * reader, Image * image, EbIndexBuffer * buffer);
+int ebcWriteTiled(EbcReader * reader, Image * image, char * filename, int tileSize);
+int ebcOpenTiledReader(EbcTiledReader * reader, char * filename);
+int ebcReadTiledRegion(EbcTiledReader * reader, int regionX, int regionY, int regionWidth, int regionHeight, Pixel ** store);
+void ebcCloseTiledReader(EbcTiledReader * reader);
+int ebcReadRegion(Image * image, char * filename, int regionX, int regionY, int regionWidth, int regionHeight);
+int ebcUniversalWriter(Pixel ** values, FILE * fp, int mode, int height, int width);
+int ebcUniversalReader(Pixel ** store, FILE * fp, int mode, int height, int width);
+int ebcUniversalMemoryReader(Pixel ** store, const unsigned char * bytes, long size, long * offset, int mode, int height, int width);
+int ebcUniversalParallelReader(Pixel ** store, const unsigned char * bytes, long size, long * offset, int mode, int height, int width, int threadAmount);
 
 #endif
@@ -0,0 +1,452 @@
+#include "ebcbUtils.h"
+
+/**
+ * This function waits until a band of the pipeline reaches a state, or until a stage fails.
+ *
+ * @param pipeline The pipeline the band is in
+ * @param bandIndex The band of the image to wait for
+ * @param state The state to wait for, one of the EBB_BAND constants
+ * @return 0 once the band is in the state; the error of the stage that failed otherwise
+ */
+static int ebbAwaitBand(EbbPipeline *pipeline, int bandIndex, int state)
+{
+    EbbBand *band = &pipeline->slot[bandIndex % pipeline->slotAmount]; // The slot of the ring the band goes through
+    pthread_mutex_lock(&pipeline->lock);
+    while (band->state != state && pipeline->check == SUCCESS)
+    {
+        pthread_cond_wait(&pipeline->changed, &pipeline->lock);
+    }
+    int check = pipeline->check; // Whether every stage is still going
+    pthread_mutex_unlock(&pipeline->lock);
+    return check;
+}
+
+/**
+ * This function hands a band on to the next stage of the pipeline, or stops every stage if this one failed.
+ *
+ * @param pipeline The pipeline the band is in
+ * @param bandIndex The band of the image that is done with
+ * @param state The state the band is now in, one of the EBB_BAND constants
+ * @param check The result of the stage
+ * @param failedOutput Whether a failure of the stage is a failure to write the compressed image
+ */
+static void ebbPassBand(EbbPipeline *pipeline, int bandIndex, int state, int check, int failedOutput)
+{
+    pthread_mutex_lock(&pipeline->lock);
+    if (check == SUCCESS)
+    {
+        pipeline->slot[bandIndex % pipeline->slotAmount].state = state;
+    }
+    else if (pipeline->check == SUCCESS)
+    { // Only the first error is kept
+        pipeline->check = check;
+        pipeline->failedOutput = failedOutput;
+    }
+    pthread_cond_broadcast(&pipeline->changed);
+    pthread_mutex_unlock(&pipeline->lock);
+}
+
+/**
+ * This function reads the rows of a band of the image once its slot of the ring is free.
+ *
+ * @param pipeline The pipeline to read for
+ * @param bandIndex The band of the image to read
+ * @return 0 on success; one of the error codes in ebConstants.h if this or another stage failed
+ */
+static int ebbReadBand(EbbPipeline *pipeline, int bandIndex)
+{
+    int check = ebbAwaitBand(pipeline, bandIndex, EBB_BAND_EMPTY);
+    if (check != SUCCESS)
+    {
+        return check;
+    }
+
+    EbbBand *band = &pipeline->slot[bandIndex % pipeline->slotAmount]; // The slot to read into
+    int firstRow = bandIndex * EBB_BAND_STRIPS * BLOCK_HEIGHT;          // The first row of the band in the image
+    int rowAmount = pipeline->height - firstRow;                        // The bottom band may be shorter than the others
+    if (rowAmount > EBB_BAND_STRIPS * BLOCK_HEIGHT)
+    {
+        rowAmount = EBB_BAND_STRIPS * BLOCK_HEIGHT;
+    }
+    for (int rowIndex = 0; rowIndex < rowAmount && check == SUCCESS; rowIndex++)
+    {
+        check = ebcReadRow(pipeline->reader, band->rows[rowIndex]);
+    }
+    ebbPassBand(pipeline, bandIndex, EBB_BAND_READ, check, 0);
+    return check;
+}
+
+/**
+ * This function averages the blocks of a band of the image once it has been read.
+ *
+ * @param pipeline The pipeline to average for
+ * @param bandIndex The band of the image to average
+ * @return 0 on success; one of the error codes in ebConstants.h if another stage failed
+ */
+static int ebbAverageBand(EbbPipeline *pipeline, int bandIndex)
+{
+    int check = ebbAwaitBand(pipeline, bandIndex, EBB_BAND_READ);
+    if (check != SUCCESS)
+    {
+        return check;
+    }
+
+    EbbBand *band = &pipeline->slot[bandIndex % pipeline->slotAmount]; // The slot to average
+    int firstRow = bandIndex * EBB_BAND_STRIPS * BLOCK_HEIGHT;          // The first row of the band in the image
+    for (int stripIndex = 0; stripIndex < EBB_BAND_STRIPS && firstRow + stripIndex * BLOCK_HEIGHT < pipeline->height; stripIndex++)
+    { // Loop through the band strip by strip
+        int heightRemaining = pipeline->height - firstRow - stripIndex * BLOCK_HEIGHT;     // The height remaining in the image
+        int stripHeight = heightRemaining < BLOCK_HEIGHT ? heightRemaining : BLOCK_HEIGHT; // The bottom strip may be shorter than a block
+        blockAverageStrip(band->rows + stripIndex * BLOCK_HEIGHT, stripHeight, pipeline->width, band->compressedRows[stripIndex]);
+    }
+    ebbPassBand(pipeline, bandIndex, EBB_BAND_AVERAGED, SUCCESS, 0);
+    return SUCCESS;
+}
+
+/**
+ * This function writes the compressed rows of a band of the image once they are made, which frees its slot of the ring.
+ *
+ * @param pipeline The pipeline to write for
+ * @param bandIndex The band of the image to write
+ * @return 0 on success; one of the error codes in ebConstants.h if this or another stage failed
+ */
+static int ebbWriteBand(EbbPipeline *pipeline, int bandIndex)
+{
+    int check = ebbAwaitBand(pipeline, bandIndex, EBB_BAND_AVERAGED);
+    if (check != SUCCESS)
+    {
+        return check;
+    }
+
+    EbbBand *band = &pipeline->slot[bandIndex % pipeline->slotAmount]; // The slot to write from
+    int firstRow = bandIndex * EBB_BAND_STRIPS * BLOCK_HEIGHT;          // The first row of the band in the image
+    for (int stripIndex = 0; stripIndex < EBB_BAND_STRIPS && firstRow + stripIndex * BLOCK_HEIGHT < pipeline->height && check == SUCCESS; stripIndex++)
+    {
+        check = ebcWriteRow(pipeline->writer, band->compressedRows[stripIndex]);
+    }
+    ebbPassBand(pipeline, bandIndex, EBB_BAND_EMPTY, check, 1);
+    return check;
+}
+
+/**
+ * This function is the reading stage of the pipeline, run on a thread of its own.
+ *
+ * @param argument The pipeline, as an EbbPipeline
+ * @return NULL, the result is kept in the pipeline
+ */
+static void *ebbReadStage(void *argument)
+{
+    EbbPipeline *pipeline = (EbbPipeline *)argument;
+    for (int bandIndex = 0; bandIndex < pipeline->bandAmount; bandIndex++)
+    {
+        if (ebbReadBand(pipeline, bandIndex) != SUCCESS)
+        {
+            break;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * This function is the writing stage of the pipeline, run on a thread of its own.
+ *
+ * @param argument The pipeline, as an EbbPipeline
+ * @return NULL, the result is kept in the pipeline
+ */
+static void *ebbWriteStage(void *argument)
+{
+    EbbPipeline *pipeline = (EbbPipeline *)argument;
+    for (int bandIndex = 0; bandIndex < pipeline->bandAmount; bandIndex++)
+    {
+        if (ebbWriteBand(pipeline, bandIndex) != SUCCESS)
+        {
+            break;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * This function compresses an ebc file into an ebcBlock file, replacing every block with its average.
+ *
+ * The image is cut into bands of EBB_BAND_STRIPS strips of BLOCK_HEIGHT rows, and every strip becomes one
+ * row of the compressed image. The bands go round a ring of EBB_RING_BANDS slots: one thread reads the next
+ * bands, the calling thread averages them and another thread writes the compressed rows, so reading, averaging
+ * and writing all go on at once. Only the ring is ever held in memory, however tall the image is. An image of
+ * a single band, or one whose threads cannot be started, goes through the same stages on the calling thread.
+ * Nothing is printed, so many files can be compressed at the same time.
+ *
+ * @param inputFilename The name of the ebc file to compress
+ * @param outputFilename The name of the ebcBlock file to write, removed again if anything goes wrong
+ * @param workspace Where the ring of bands is kept, and where the files may already be in memory
+ * @param failedFilename Where to store the name of the file to blame when something goes wrong
+ * @return 0 on success; one of the error codes in ebConstants.h on failure
+ */
+int ebbCompress(char *inputFilename, char *outputFilename, EbcWorkspace *workspace, char **failedFilename)
+{
+    *failedFilename = inputFilename; // The file to blame if something goes wrong
+    Image image;
+    EbcReader reader; // Reads the image row by row
+    int check = ebcOpenInput(&reader, &image, inputFilename, MAGIC_NUMBER_EBC, workspace);
+    if (check != SUCCESS)
+    {
+        return check;
+    }
+
+    Image imageCompressed;                                                  // Create the compressed image struct
+    imageCompressed.height = ceil((((double)image.height) / BLOCK_HEIGHT)); // The number of blocks in the height
+    imageCompressed.width = ceil((((double)image.width) / BLOCK_WIDTH));    // The number of blocks in the width
+
+    EbbPipeline pipeline; // The stages and the ring of bands between them
+    pipeline.reader = &reader;
+    pipeline.height = image.height;
+    pipeline.width = image.width;
+    pipeline.bandAmount = (imageCompressed.height + EBB_BAND_STRIPS - 1) / EBB_BAND_STRIPS;
+    pipeline.slotAmount = pipeline.bandAmount < EBB_RING_BANDS ? pipeline.bandAmount : EBB_RING_BANDS;
+    pipeline.check = SUCCESS;
+    pipeline.failedOutput = 0;
+    if (pipeline.slotAmount < 1)
+    { // An empty image still needs a slot to keep the arithmetic simple
+        pipeline.slotAmount = 1;
+    }
+    Pixel **ringRows = ebReuse2DArray(&workspace->pixels, pipeline.slotAmount * EBB_BAND_STRIPS * BLOCK_HEIGHT, image.width);          // The rows of the image in the ring
+    Pixel **ringCompressedRows = ebReuse2DArray(&workspace->compressed, pipeline.slotAmount * EBB_BAND_STRIPS, imageCompressed.width); // The rows of the compressed image in the ring
+    if (ringRows == NULL || ringCompressedRows == NULL)
+    {
+        ebcCloseReader(&reader);  // Close the image
+        return BAD_BLOCK_MALLOC; // return if memory was not allocated
+    }
+    for (int slotIndex = 0; slotIndex < pipeline.slotAmount; slotIndex++)
+    {
+        pipeline.slot[slotIndex].rows = ringRows + slotIndex * EBB_BAND_STRIPS * BLOCK_HEIGHT;
+        pipeline.slot[slotIndex].compressedRows = ringCompressedRows + slotIndex * EBB_BAND_STRIPS;
+        pipeline.slot[slotIndex].state = EBB_BAND_EMPTY;
+    }
+
+    EbcWriter writer; // Writes the compressed image row by row
+    check = ebcOpenOutput(&writer, &imageCompressed, outputFilename, MAGIC_NUMBER_EBCBLOCK, workspace);
+    if (check != SUCCESS)
+    {
+        ebcCloseReader(&reader);          // Close the image
+        *failedFilename = outputFilename; // The compressed image could not be opened
+        return check;
+    }
+    pipeline.writer = &writer;
+
+    pthread_mutex_init(&pipeline.lock, NULL);
+    pthread_cond_init(&pipeline.changed, NULL);
+    pthread_t readThread;    // Reads the bands ahead of the averaging
+    pthread_t writeThread;   // Writes the bands behind the averaging
+    int readerStarted = 0;   // Whether the reading stage has a thread of its own
+    int writerStarted = 0;   // Whether the writing stage has a thread of its own
+    if (pipeline.bandAmount > 1)
+    { // A single band has nothing to overlap with
+        readerStarted = pthread_create(&readThread, NULL, ebbReadStage, &pipeline) == 0;
+        writerStarted = pthread_create(&writeThread, NULL, ebbWriteStage, &pipeline) == 0;
+    }
+    for (int bandIndex = 0; bandIndex < pipeline.bandAmount; bandIndex++)
+    { // Average the bands, doing the reading and writing as well for any stage without a thread
+        if (!readerStarted && ebbReadBand(&pipeline, bandIndex) != SUCCESS)
+        {
+            break;
+        }
+        if (ebbAverageBand(&pipeline, bandIndex) != SUCCESS)
+        {
+            break;
+        }
+        if (!writerStarted && ebbWriteBand(&pipeline, bandIndex) != SUCCESS)
+        {
+            break;
+        }
+    }
+    if (readerStarted)
+    {
+        pthread_join(readThread, NULL);
+    }
+    if (writerStarted)
+    {
+        pthread_join(writeThread, NULL);
+    }
+    pthread_cond_destroy(&pipeline.changed);
+    pthread_mutex_destroy(&pipeline.lock);
+    check = pipeline.check;
+    if (check != SUCCESS && pipeline.failedOutput)
+    {
+        *failedFilename = outputFilename;
+    }
+
+    int closeCheck = ebcCloseReader(&reader); // Close the image, checking for too much data
+    if (check == SUCCESS)
+    {
+        check = closeCheck;
+    }
+    closeCheck = ebcCloseWriter(&writer); // Write out the end of the compressed image
+    if (check == SUCCESS && closeCheck != SUCCESS)
+    {
+        check = closeCheck;
+        *failedFilename = outputFilename;
+    }
+
+    if (check != SUCCESS)
+    {
+        ebcDiscardOutput(outputFilename, workspace); // Do not leave a partial compressed image behind
+    }
+    return check;
+}
+
+/**
+ * This function packs a row of a decompressed image from the band of the compressed image it lies in, for ebcWritePackedRows().
+ *
+ * @param source The band, an EbbBlockRows
+ * @param y The row of the decompressed image, counting from the top of the band
+ * @param packed Where to store the packed row
+ */
+static void ebbPackBlockRow(const void *source, int y, unsigned char *packed)
+{
+    const EbbBlockRows *band = (const EbbBlockRows *)source;
+    bpuPackRepeated(band->rows[y / BLOCK_HEIGHT], band->width, BLOCK_WIDTH, band->bitWidth, packed); // Pack every pixel repeated across its block
+}
+
+/**
+ * This function decompresses an ebcBlock file into an ebc file.
+ *
+ * The image is decompressed a band of rows at a time. Every pixel of the compressed image stands for a
+ * BLOCK_WIDTH x BLOCK_HEIGHT block with the same value, so every row of a block is the compressed row
+ * packed with every pixel repeated BLOCK_WIDTH times. The rows of a band are packed in chunks on
+ * workspace->threadAmount threads by ebcWritePackedRows(), and only a band of compressed rows and its
+ * packed chunks are ever held in memory. Nothing is printed.
+ *
+ * @param inputFilename The name of the ebcBlock file to decompress
+ * @param outputFilename The name of the ebc file to write, removed again if anything goes wrong
+ * @param workspace Where the band and the packed rows are kept, how many threads to pack with, and where the files may already be in memory
+ * @param failedFilename Where to store the name of the file to blame when something goes wrong
+ * @return 0 on success; one of the error codes in ebConstants.h on failure
+ */
+int ebbDecompress(char *inputFilename, char *outputFilename, EbcWorkspace *workspace, char **failedFilename)
+{
+    *failedFilename = inputFilename; // The file to blame if something goes wrong
+    Image image;
+    EbcReader reader; // Reads the compressed image row by row
+    int check = ebcOpenInput(&reader, &image, inputFilename, MAGIC_NUMBER_EBCBLOCK, workspace);
+    if (check != SUCCESS)
+    {
+        return check; // return if read failed
+    }
+
+    Image imageDecompressed;                                                        // Create the decompressed image struct
+    imageDecompressed.height = image.height * BLOCK_HEIGHT;                         // Assign the height
+    imageDecompressed.width = image.width * BLOCK_WIDTH;                            // Assign the width
+    int bandHeight = ebcPackingBandHeight((long)imageDecompressed.width * BLOCK_HEIGHT, workspace->threadAmount); // The compressed rows in a band
+    if (bandHeight > image.height && image.height > 0)
+    {
+        bandHeight = image.height;
+    }
+    EbbBlockRows band;                                                           // The band of the compressed image being decompressed
+    band.rows = ebReuse2DArray(&workspace->compressed, bandHeight, image.width);
+    band.width = image.width;
+    if (band.rows == NULL)
+    {
+        ebcCloseReader(&reader); // Close the compressed image
+        return BAD_MALLOC;       // return if memory was not allocated
+    }
+
+    EbcWriter writer; // Writes the decompressed image row by row
+    check = ebcOpenOutput(&writer, &imageDecompressed, outputFilename, MAGIC_NUMBER_EBC, workspace);
+    if (check != SUCCESS)
+    {
+        ebcCloseReader(&reader);          // Close the compressed image
+        *failedFilename = outputFilename; // The decompressed image could not be opened
+        return check;
+    }
+
+    band.bitWidth = writer.bits.bitWidth;
+    for (int bandY = 0; bandY < image.height && check == SUCCESS; bandY += bandHeight)
+    { // Loop through the compressed image a band at a time
+        int bandRows = image.height - bandY < bandHeight ? image.height - bandY : bandHeight; // The last band may be short
+        for (int y = 0; y < bandRows && check == SUCCESS; y++)
+        {
+            check = ebcReadRow(&reader, band.rows[y]); // Read the compressed rows of the band
+        }
+        if (check != SUCCESS)
+        {
+            break;
+        }
+
+        check = ebcWritePackedRows(&writer, bandRows * BLOCK_HEIGHT, ebbPackBlockRow, &band, workspace); // Every compressed row makes BLOCK_HEIGHT rows
+        if (check != SUCCESS)
+        {
+            *failedFilename = outputFilename;
+        }
+    }
+
+    int closeCheck = ebcCloseReader(&reader); // Close the compressed image, checking for too much data
+    if (check == SUCCESS)
+    {
+        check = closeCheck;
+    }
+    closeCheck = ebcCloseWriter(&writer); // Write out the end of the decompressed image
+    if (check == SUCCESS && closeCheck != SUCCESS)
+    {
+        check = closeCheck;
+        *failedFilename = outputFilename;
+    }
+
+    if (check != SUCCESS)
+    {
+        ebcDiscardOutput(outputFilename, workspace); // Do not leave a partial decompressed image behind
+    }
+    return check;
+}
+
+/**
+ * This function compresses an ebc file into an ebcBlock file, the whole of the ebcBlock program.
+ *
+ * Prints COMPRESSED on success or the error message on failure.
+ *
+ * @param inputFilename The name of the ebc file to compress
+ * @param outputFilename The name of the ebcBlock file to write
+ * @return 0 on success; one of the error codes in ebConstants.h on failure
+ */
+int ebbCompressFile(char *inputFilename, char *outputFilename)
+{
+    ebSetMessageStream(outputFilename); // Keep the messages out of the compressed image when it goes to stdout
+    EbcWorkspace workspace;             // The memory for this one file
+    ebcInitWorkspace(&workspace);
+    char *failedFilename = inputFilename; // The file to blame if something goes wrong
+    int check = ebbCompress(inputFilename, outputFilename, &workspace, &failedFilename);
+    ebcFreeWorkspace(&workspace);
+    if (check != SUCCESS)
+    {
+        return ebErrorHandle(check, failedFilename); // return if the image was not compressed
+    }
+
+    fprintf(ebMessageStream(), "COMPRESSED\n"); // Print that the image was compressed
+    return SUCCESS;
+}
+
+/**
+ * This function decompresses an ebcBlock file into an ebc file, the whole of the ebcUnblock program.
+ *
+ * Prints DECOMPRESSED on success or the error message on failure.
+ *
+ * @param inputFilename The name of the ebcBlock file to decompress
+ * @param outputFilename The name of the ebc file to write
+ * @return 0 on success; one of the error codes in ebConstants.h on failure
+ */
+int ebbDecompressFile(char *inputFilename, char *outputFilename)
+{
+    ebSetMessageStream(outputFilename); // Keep the messages out of the decompressed image when it goes to stdout
+    EbcWorkspace workspace;             // The memory for this one file
+    ebcInitWorkspace(&workspace);
+    workspace.threadAmount = ebcProcessorAmount(); // Pack the decompressed image on every processor
+    char *failedFilename = inputFilename; // The file to blame if something goes wrong
+    int check = ebbDecompress(inputFilename, outputFilename, &workspace, &failedFilename);
+    ebcFreeWorkspace(&workspace);
+    if (check != SUCCESS)
+    {
+        return ebErrorHandle(check, failedFilename); // return if the image was not decompressed
+    }
+
+    fprintf(ebMessageStream(), "DECOMPRESSED\n"); // Print that the image was decompressed
+    return SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#ifndef EBCB_UTILS_H
+#define EBCB_UTILS_H
+
+#include "ebUniversalUtils.h"
+#include "ebcUtils.h"
+#include "blockUtils.h"
+#include <math.h>
+#include <pthread.h>
+
+#define EBB_BAND_STRIPS 16   // The strips of blocks in a band, the unit the stages of compression hand on to each other
+#define EBB_RING_BANDS 4     // The bands in the ring, how far reading can get ahead of writing
+#define EBB_BAND_EMPTY 0     // The band is free to be read into
+#define EBB_BAND_READ 1      // The rows of the band have been read and can be averaged
+#define EBB_BAND_AVERAGED 2  // The compressed rows of the band are made and can be written
+
+typedef struct ebbBand{
+    Pixel **rows;           // The rows of the image in the band, EBB_BAND_STRIPS strips of them
+    Pixel **compressedRows; // The rows of the compressed image made from the band, one for every strip
+    int state;              // How far the band has got, one of the EBB_BAND constants
+} EbbBand;
+
+typedef struct ebbPipeline{
+    EbcReader *reader;            // Reads the image, only used by the reading stage
+    EbcWriter *writer;            // Writes the compressed image, only used by the writing stage
+    int height;                   // The height of the image
+    int width;                    // The width of the image
+    int bandAmount;               // The number of bands the image is cut into
+    int slotAmount;               // The number of bands in the ring, no more than EBB_RING_BANDS
+    EbbBand slot[EBB_RING_BANDS]; // The ring, band n of the image goes through slot n % slotAmount
+    int check;                    // The first error of any stage, which stops every stage
+    int failedOutput;             // Whether that error came from writing the compressed image
+    pthread_mutex_t lock;         // Guards the states of the bands, check and failedOutput
+    pthread_cond_t changed;       // Signalled whenever a band changes state or a stage fails
+} EbbPipeline;
+
+typedef struct ebbBlockRows{
+    Pixel **rows; // A band of rows of the compressed image
+    int width;    // The width of the compressed image
+    int bitWidth; // The bits of every pixel of the decompressed image
+} EbbBlockRows;
+
+// function prototypes
+int ebbCompress(char * inputFilename, char * outputFilename, EbcWorkspace * workspace, char ** failedFilename);
+int ebbDecompress(char * inputFilename, char * outputFilename, EbcWorkspace * workspace, char ** failedFilename);
+int ebbCompressFile(char * inputFilename, char * outputFilename);
+int ebbDecompressFile(char * inputFilename, char * outputFilename);
+
+#endif
\ No newline at end of file
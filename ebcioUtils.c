@@ -0,0 +1,781 @@
+#define _DEFAULT_SOURCE // For syscall(), as well as pread() and pwrite()
+
+#include "ebcioUtils.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#define EBI_HAVE_URING 1 // io_uring can be built, whether the kernel allows it is found out when starting
+#endif
+#endif
+
+#define EBI_STEP_OPEN 0     // The completion of opening a file
+#define EBI_STEP_TRANSFER 1 // The completion of reading or writing a file
+#define EBI_STEP_CLOSE 2    // The completion of closing a file
+
+#ifdef EBI_HAVE_URING
+/**
+ * This function unmaps the rings of an io_uring instance and closes it.
+ *
+ * @param ring The instance, which may be partly set up
+ */
+static void ebiRingStop(EbiRing *ring)
+{
+    if (ring->sqes != NULL)
+    {
+        munmap(ring->sqes, ring->sqesSize);
+    }
+    if (ring->cqMapping != NULL)
+    {
+        munmap(ring->cqMapping, ring->cqMappingSize);
+    }
+    if (ring->sqMapping != NULL)
+    {
+        munmap(ring->sqMapping, ring->sqMappingSize);
+    }
+    close(ring->fd);
+}
+
+/**
+ * This function maps an io_uring instance into memory.
+ *
+ * @param ring The ring to set up
+ * @return 0 on success; BAD_FILE if the kernel does not allow io_uring
+ */
+static int ebiRingSetup(EbiRing *ring)
+{
+    struct io_uring_params params; // What the kernel set up
+    memset(&params, 0, sizeof(params));
+    ring->fd = (int)syscall(__NR_io_uring_setup, EBI_QUEUE_DEPTH, &params);
+    if (ring->fd < 0)
+    {
+        return BAD_FILE;
+    }
+
+    ring->sqMappingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cqMappingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqMapping = mmap(NULL, ring->sqMappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd, IORING_OFF_SQ_RING);
+    ring->cqMapping = mmap(NULL, ring->cqMappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd, IORING_OFF_CQ_RING);
+    ring->sqes = mmap(NULL, ring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd, IORING_OFF_SQES);
+    if (ring->sqMapping == MAP_FAILED || ring->cqMapping == MAP_FAILED || ring->sqes == MAP_FAILED)
+    {
+        ring->sqMapping = ring->sqMapping == MAP_FAILED ? NULL : ring->sqMapping;
+        ring->cqMapping = ring->cqMapping == MAP_FAILED ? NULL : ring->cqMapping;
+        ring->sqes = ring->sqes == MAP_FAILED ? NULL : ring->sqes;
+        ebiRingStop(ring);
+        return BAD_FILE;
+    }
+
+    unsigned char *sq = (unsigned char *)ring->sqMapping; // The submission queue ring
+    ring->sqHead = (unsigned *)(sq + params.sq_off.head);
+    ring->sqTail = (unsigned *)(sq + params.sq_off.tail);
+    ring->sqMask = (unsigned *)(sq + params.sq_off.ring_mask);
+    ring->sqArray = (unsigned *)(sq + params.sq_off.array);
+    ring->sqEntries = params.sq_entries;
+    ring->sqLocalTail = *ring->sqTail;
+    ring->toSubmit = 0;
+    unsigned char *cq = (unsigned char *)ring->cqMapping; // The completion queue ring
+    ring->cqHead = (unsigned *)(cq + params.cq_off.head);
+    ring->cqTail = (unsigned *)(cq + params.cq_off.tail);
+    ring->cqMask = (unsigned *)(cq + params.cq_off.ring_mask);
+    ring->cqes = cq + params.cq_off.cqes;
+    ring->fixedBuffers = 0;
+    return SUCCESS;
+}
+
+/**
+ * This function takes the next free submission queue entry.
+ *
+ * There is always one, as no more than three entries are ever in flight for every read and write slot.
+ *
+ * @param ring The ring
+ * @param userData What the completion of the entry is tagged with
+ * @return The entry, cleared
+ */
+static struct io_uring_sqe *ebiRingEntry(EbiRing *ring, uint64_t userData)
+{
+    unsigned index = ring->sqLocalTail & *ring->sqMask; // The position of the entry
+    struct io_uring_sqe *sqe = (struct io_uring_sqe *)ring->sqes + index;
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->user_data = userData;
+    ring->sqArray[index] = index;
+    ring->sqLocalTail++;
+    ring->toSubmit++;
+    return sqe;
+}
+
+/**
+ * This function hands the entries filled in to the kernel and waits for completions.
+ *
+ * When the kernel is short of room (EAGAIN or EBUSY) while there are completions to reap, it returns without
+ * waiting, so the caller can reap them. The entries it did not take are handed over again by the next call.
+ *
+ * @param ring The ring
+ * @param waitAmount The number of completions to wait for
+ * @return 0 on success; BAD_FILE if the kernel refused the entries
+ */
+static int ebiRingEnter(EbiRing *ring, unsigned waitAmount)
+{
+    __atomic_store_n(ring->sqTail, ring->sqLocalTail, __ATOMIC_RELEASE);
+    for (;;)
+    {
+        long submitted = syscall(__NR_io_uring_enter, ring->fd, ring->toSubmit, waitAmount, waitAmount > 0 ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+        if (submitted >= 0)
+        {
+            ring->toSubmit -= (unsigned)submitted;
+            return SUCCESS;
+        }
+        if (errno == EINTR)
+        {
+            continue;
+        }
+        if ((errno == EAGAIN || errno == EBUSY) && *ring->cqHead != __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE))
+        { // Reaping the completions makes room
+            return SUCCESS;
+        }
+        return BAD_FILE;
+    }
+}
+
+/**
+ * This function opens a file into a slot of the registered file table, reads or writes it and closes it again.
+ *
+ * The three operations are hard linked, so they run one after another whatever their results.
+ *
+ * @param io The I/O context
+ * @param fileIndex The file, its operation and slot already chosen
+ */
+static void ebiRingTransfer(EbiContext *io, int fileIndex)
+{
+    EbiRing *ring = &io->ring;
+    EbiFile *file = &io->files[fileIndex];
+    int reading = file->operation == EBI_READ;                        // Whether the input is read rather than the output written
+    int fixedFile = reading ? file->slot : EBI_READ_SLOTS + file->slot; // The entry of the registered file table
+    uint64_t tag = (uint64_t)fileIndex << 2;                           // The completions are tagged with the file and the step
+
+    struct io_uring_sqe *sqe = ebiRingEntry(ring, tag | EBI_STEP_OPEN);
+    sqe->opcode = IORING_OP_OPENAT;
+    sqe->flags = IOSQE_IO_HARDLINK;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = (uint64_t)(uintptr_t)(reading ? file->inputFilename : file->outputFilename);
+    sqe->open_flags = reading ? O_RDONLY | O_NONBLOCK : O_WRONLY | O_CREAT | O_TRUNC;
+    sqe->len = reading ? 0 : 0666;
+    sqe->file_index = fixedFile + 1;
+
+    sqe = ebiRingEntry(ring, tag | EBI_STEP_TRANSFER);
+    sqe->flags = IOSQE_FIXED_FILE | IOSQE_IO_HARDLINK;
+    sqe->fd = fixedFile;
+    sqe->off = 0;
+    if (reading)
+    {
+        sqe->opcode = ring->fixedBuffers ? IORING_OP_READ_FIXED : IORING_OP_READ;
+        sqe->addr = (uint64_t)(uintptr_t)(io->buffers + (size_t)file->slot * EBI_SLOT_SIZE);
+        sqe->len = EBI_SLOT_SIZE;
+        sqe->buf_index = ring->fixedBuffers ? (uint16_t)file->slot : 0;
+    }
+    else
+    {
+        sqe->opcode = IORING_OP_WRITE;
+        sqe->addr = (uint64_t)(uintptr_t)file->output;
+        sqe->len = (uint32_t)file->outputSize;
+    }
+
+    sqe = ebiRingEntry(ring, tag | EBI_STEP_CLOSE);
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->file_index = fixedFile + 1;
+    file->pendingOperations = 3;
+}
+
+/**
+ * This function reaps the completions of the ring.
+ *
+ * @param io The I/O context
+ * @param finished Where to store the files whose operations have all completed
+ * @return The number of files stored in finished
+ */
+static int ebiRingReap(EbiContext *io, int *finished)
+{
+    EbiRing *ring = &io->ring;
+    int finishedAmount = 0; // The files stored in finished
+    unsigned head = *ring->cqHead;
+    unsigned tail = __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE);
+    for (; head != tail; head++)
+    {
+        struct io_uring_cqe *cqe = (struct io_uring_cqe *)ring->cqes + (head & *ring->cqMask);
+        EbiFile *file = &io->files[cqe->user_data >> 2];
+        int step = (int)(cqe->user_data & 3); // Which of the operations of the file completed
+        if (step == EBI_STEP_OPEN)
+        {
+            file->openResult = cqe->res;
+        }
+        else if (step == EBI_STEP_TRANSFER)
+        {
+            file->transferResult = cqe->res;
+        }
+        if (--file->pendingOperations == 0)
+        {
+            finished[finishedAmount++] = (int)(cqe->user_data >> 2);
+        }
+    }
+    __atomic_store_n(ring->cqHead, head, __ATOMIC_RELEASE);
+    return finishedAmount;
+}
+
+/**
+ * This function gives up on io_uring once the kernel refuses its entries, so the I/O thread carries on with EBI_MODE_PLAIN.
+ *
+ * The entries the kernel never took are dropped: a read among them is left to be opened by name and a write
+ * among them fails with BAD_FILE. The operations the kernel did take use the read buffers and the outputs, so
+ * they are waited for and reaped as usual before the ring is stopped.
+ *
+ * @param io The I/O context
+ * @param finished Where to store the files whose operations have all completed or been dropped
+ * @return The number of files stored in finished
+ */
+static int ebiRingAbandon(EbiContext *io, int *finished)
+{
+    EbiRing *ring = &io->ring;
+    int finishedAmount = 0; // The files stored in finished
+    for (unsigned position = ring->sqLocalTail - ring->toSubmit; position != ring->sqLocalTail; position++)
+    { // Drop every entry the kernel did not take
+        struct io_uring_sqe *sqe = (struct io_uring_sqe *)ring->sqes + (position & *ring->sqMask);
+        EbiFile *file = &io->files[sqe->user_data >> 2];
+        int step = (int)(sqe->user_data & 3); // Which of the operations of the file was dropped
+        if (step == EBI_STEP_OPEN)
+        {
+            file->openResult = -ECANCELED;
+        }
+        else if (step == EBI_STEP_TRANSFER)
+        {
+            file->transferResult = -ECANCELED;
+        }
+        if (--file->pendingOperations == 0)
+        {
+            finished[finishedAmount++] = (int)(sqe->user_data >> 2);
+        }
+    }
+    ring->sqLocalTail -= ring->toSubmit;
+    ring->toSubmit = 0;
+
+    for (;;)
+    {
+        finishedAmount += ebiRingReap(io, finished + finishedAmount);
+        int pendingFiles = 0; // The files with operations the kernel has not completed
+        for (int fileIndex = 0; fileIndex < io->fileAmount; fileIndex++)
+        {
+            pendingFiles += io->files[fileIndex].pendingOperations > 0;
+        }
+        if (pendingFiles == 0)
+        {
+            break;
+        }
+        if (syscall(__NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0 && errno != EINTR)
+        { // The kernel cannot even be waited on, so the files still in flight are given up on as well
+            for (int fileIndex = 0; fileIndex < io->fileAmount; fileIndex++)
+            {
+                if (io->files[fileIndex].pendingOperations > 0)
+                {
+                    io->files[fileIndex].openResult = -ECANCELED;
+                    io->files[fileIndex].pendingOperations = 0;
+                    finished[finishedAmount++] = fileIndex;
+                }
+            }
+            break;
+        }
+    }
+    ebiRingStop(ring);
+    io->mode = EBI_MODE_PLAIN;
+    return finishedAmount;
+}
+
+/**
+ * This function checks whether the kernel can run everything the I/O thread asks of io_uring.
+ *
+ * The operations are looked up in the probe of the kernel, then a directory is opened into and closed from
+ * the registered file table for real, as opening straight into the table came later than the operations.
+ *
+ * @param ring The ring, with its file table registered
+ * @return 0 if io_uring can be used; BAD_FILE otherwise
+ */
+static int ebiRingProbe(EbiRing *ring)
+{
+    int opcodes[] = {IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_READ_FIXED, IORING_OP_WRITE, IORING_OP_CLOSE}; // The operations used
+    size_t probeSize = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);                  // Room for every operation
+    struct io_uring_probe *probe = (struct io_uring_probe *)calloc(1, probeSize);
+    if (probe == NULL || syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_PROBE, probe, 256) < 0)
+    {
+        free(probe);
+        return BAD_FILE;
+    }
+    int check = SUCCESS;
+    for (size_t opIndex = 0; opIndex < sizeof(opcodes) / sizeof(opcodes[0]); opIndex++)
+    {
+        if (opcodes[opIndex] > probe->last_op || !(probe->ops[opcodes[opIndex]].flags & IO_URING_OP_SUPPORTED))
+        {
+            check = BAD_FILE;
+        }
+    }
+    free(probe);
+    if (check != SUCCESS)
+    {
+        return check;
+    }
+
+    struct io_uring_sqe *sqe = ebiRingEntry(ring, EBI_STEP_OPEN);
+    sqe->opcode = IORING_OP_OPENAT;
+    sqe->flags = IOSQE_IO_HARDLINK;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = (uint64_t)(uintptr_t)".";
+    sqe->open_flags = O_RDONLY;
+    sqe->file_index = 1;
+    sqe = ebiRingEntry(ring, EBI_STEP_CLOSE);
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->file_index = 1;
+    if (ebiRingEnter(ring, 2) != SUCCESS)
+    {
+        return BAD_FILE;
+    }
+    unsigned head = *ring->cqHead;
+    unsigned tail = __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE);
+    for (; head != tail; head++)
+    {
+        struct io_uring_cqe *cqe = (struct io_uring_cqe *)ring->cqes + (head & *ring->cqMask);
+        if (cqe->res < 0)
+        {
+            check = BAD_FILE;
+        }
+    }
+    __atomic_store_n(ring->cqHead, head, __ATOMIC_RELEASE);
+    return check;
+}
+
+/**
+ * This function starts io_uring for an I/O context.
+ *
+ * The registered file table has a slot for every read and write slot. The read buffers are registered
+ * too where the kernel allows, otherwise they are passed with every read.
+ *
+ * @param io The I/O context, its read buffers allocated
+ * @return 0 on success; BAD_FILE if io_uring cannot be used, in which case nothing is left open
+ */
+static int ebiRingStart(EbiContext *io)
+{
+    EbiRing *ring = &io->ring;
+    if (ebiRingSetup(ring) != SUCCESS)
+    {
+        return BAD_FILE;
+    }
+    int fileTable[EBI_READ_SLOTS + EBI_WRITE_SLOTS]; // Every slot starts empty
+    for (int slot = 0; slot < EBI_READ_SLOTS + EBI_WRITE_SLOTS; slot++)
+    {
+        fileTable[slot] = -1;
+    }
+    if (syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_FILES, fileTable, EBI_READ_SLOTS + EBI_WRITE_SLOTS) < 0 || ebiRingProbe(ring) != SUCCESS)
+    {
+        ebiRingStop(ring);
+        return BAD_FILE;
+    }
+
+    struct iovec bufferTable[EBI_READ_SLOTS]; // The read buffers
+    for (int slot = 0; slot < EBI_READ_SLOTS; slot++)
+    {
+        bufferTable[slot].iov_base = io->buffers + (size_t)slot * EBI_SLOT_SIZE;
+        bufferTable[slot].iov_len = EBI_SLOT_SIZE;
+    }
+    ring->fixedBuffers = syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_BUFFERS, bufferTable, EBI_READ_SLOTS) == 0;
+    return SUCCESS;
+}
+#endif
+
+/**
+ * This function reads an input into its read buffer with plain system calls.
+ *
+ * @param io The I/O context
+ * @param file The file, its read buffer already chosen
+ */
+static void ebiPlainRead(EbiContext *io, EbiFile *file)
+{
+    file->transferResult = -1;
+    file->openResult = open(file->inputFilename, O_RDONLY | O_NONBLOCK);
+    if (file->openResult >= 0)
+    {
+        file->transferResult = (long)pread(file->openResult, io->buffers + (size_t)file->slot * EBI_SLOT_SIZE, EBI_SLOT_SIZE, 0);
+        close(file->openResult);
+    }
+}
+
+/**
+ * This function writes an output with plain system calls.
+ *
+ * @param file The file, its output handed over
+ */
+static void ebiPlainWrite(EbiFile *file)
+{
+    file->transferResult = -1;
+    file->openResult = open(file->outputFilename, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (file->openResult >= 0)
+    {
+        long written = 0; // The bytes written so far
+        while (written < file->outputSize)
+        {
+            ssize_t result = pwrite(file->openResult, file->output + written, (size_t)(file->outputSize - written), written);
+            if (result <= 0)
+            {
+                break;
+            }
+            written += result;
+        }
+        file->transferResult = written;
+        close(file->openResult);
+    }
+}
+
+/**
+ * This function starts the reads and writes chosen by the I/O thread and waits for some to finish.
+ *
+ * @param io The I/O context
+ * @param started The files whose read or write starts now
+ * @param startAmount The number of files in started
+ * @param finished Where to store the files whose read or write has finished
+ * @return The number of files stored in finished
+ */
+static int ebiTransfer(EbiContext *io, const int *started, int startAmount, int *finished)
+{
+#ifdef EBI_HAVE_URING
+    if (io->mode == EBI_MODE_URING)
+    { // Every read and write goes to the kernel in one system call, which also waits for the first to finish
+        for (int startIndex = 0; startIndex < startAmount; startIndex++)
+        {
+            ebiRingTransfer(io, started[startIndex]);
+        }
+        if (ebiRingEnter(&io->ring, 1) != SUCCESS)
+        {
+            return ebiRingAbandon(io, finished);
+        }
+        return ebiRingReap(io, finished);
+    }
+#endif
+    for (int startIndex = 0; startIndex < startAmount; startIndex++)
+    {
+        EbiFile *file = &io->files[started[startIndex]];
+        if (file->operation == EBI_READ)
+        {
+            ebiPlainRead(io, file);
+        }
+        else
+        {
+            ebiPlainWrite(file);
+        }
+        finished[startIndex] = started[startIndex];
+    }
+    return startAmount;
+}
+
+/**
+ * This function records the end of the read or write of a file. The lock must be held.
+ *
+ * An input that could not be read whole into its buffer is left to be opened by name, so it fails or
+ * succeeds exactly as it would have without reading ahead. An output that could not be written whole is removed.
+ *
+ * @param io The I/O context
+ * @param file The file whose read or write finished
+ */
+static void ebiFinishFile(EbiContext *io, EbiFile *file)
+{
+    if (file->operation == EBI_READ)
+    {
+        if (file->openResult >= 0 && file->transferResult > 0 && file->transferResult < EBI_SLOT_SIZE)
+        {
+            file->input = io->buffers + (size_t)file->slot * EBI_SLOT_SIZE;
+            file->inputSize = file->transferResult;
+            file->inputState = EBI_LOADED;
+        }
+        else
+        {
+            io->freeReadSlot[io->freeReadSlotAmount++] = file->slot;
+            file->inputState = EBI_BY_NAME;
+        }
+        return;
+    }
+
+    if (file->openResult < 0)
+    { // The output could not be opened
+        file->outputCheck = BAD_FILE;
+    }
+    else if (file->transferResult != file->outputSize)
+    { // Do not leave a partial output behind
+        file->outputCheck = BAD_OUTPUT;
+        unlink(file->outputFilename);
+    }
+    free(file->output);
+    file->output = NULL;
+    io->freeWriteSlot[io->freeWriteSlotAmount++] = file->slot;
+    file->outputDone = 1;
+    io->outputsDone++;
+}
+
+/**
+ * This function is the I/O thread.
+ *
+ * It reads the inputs ahead in order, as long as there are free read buffers, and writes the outputs in
+ * the order they are handed over, as long as there are free write slots. All the reads and writes it can
+ * start are started at once, then it waits for any of them to finish. It stops once every input has been
+ * read and every output is done.
+ *
+ * @param argument The I/O context, as an EbiContext
+ * @return NULL
+ */
+static void *ebiRun(void *argument)
+{
+    EbiContext *io = (EbiContext *)argument;
+    int started[EBI_READ_SLOTS + EBI_WRITE_SLOTS];  // The files whose read or write starts in this round
+    int finished[EBI_READ_SLOTS + EBI_WRITE_SLOTS]; // The files whose read or write finished in this round
+    pthread_mutex_lock(&io->lock);
+    for (;;)
+    {
+        int startAmount = 0; // The files in started
+        while (io->nextRead < io->fileAmount && (io->files[io->nextRead].inputFilename == NULL || io->freeReadSlotAmount > 0))
+        { // Read ahead in order
+            EbiFile *file = &io->files[io->nextRead];
+            if (file->inputFilename == NULL)
+            {
+                file->inputState = EBI_BY_NAME;
+                pthread_cond_broadcast(&io->changed);
+            }
+            else
+            {
+                file->operation = EBI_READ;
+                file->slot = io->freeReadSlot[--io->freeReadSlotAmount];
+                started[startAmount++] = io->nextRead;
+            }
+            io->nextRead++;
+        }
+        while (io->writeHead < io->writeTail && io->freeWriteSlotAmount > 0)
+        { // Write what has been handed over
+            EbiFile *file = &io->files[io->writeQueue[io->writeHead]];
+            file->operation = EBI_WRITE;
+            file->slot = io->freeWriteSlot[--io->freeWriteSlotAmount];
+            started[startAmount++] = io->writeQueue[io->writeHead++];
+        }
+        if (startAmount == 0 && io->inFlight == 0)
+        {
+            if (io->nextRead == io->fileAmount && io->outputsDone == io->fileAmount)
+            {
+                break; // Everything is done
+            }
+            pthread_cond_wait(&io->changed, &io->lock);
+            continue;
+        }
+
+        io->inFlight += startAmount;
+        pthread_mutex_unlock(&io->lock);
+        int finishedAmount = ebiTransfer(io, started, startAmount, finished); // The files in finished
+        pthread_mutex_lock(&io->lock);
+        for (int finishedIndex = 0; finishedIndex < finishedAmount; finishedIndex++)
+        {
+            ebiFinishFile(io, &io->files[finished[finishedIndex]]);
+        }
+        io->inFlight -= finishedAmount;
+        pthread_cond_broadcast(&io->changed);
+    }
+    pthread_mutex_unlock(&io->lock);
+    return NULL;
+}
+
+/**
+ * This function starts reading the inputs of a list of files ahead and writing their outputs behind.
+ *
+ * The inputs are read on an I/O thread into read buffers of EBI_SLOT_SIZE bytes, through io_uring where the
+ * kernel allows and with pread() otherwise. An input is left to be opened by name when it has no
+ * inputFilename, is too large for a buffer or cannot be read, and every input is with EBI_MODE_OFF or
+ * when there is no memory or thread for reading ahead.
+ *
+ * @param io The I/O context to start
+ * @param files The files, with their names filled in
+ * @param fileAmount The number of files
+ * @param mode How to read and write, one of the EBI_MODE constants
+ */
+void ebiStart(EbiContext *io, EbiFile *files, int fileAmount, int mode)
+{
+    io->files = files;
+    io->fileAmount = fileAmount;
+    io->mode = EBI_MODE_PLAIN;
+    io->writeHead = 0;
+    io->writeTail = 0;
+    io->nextRead = 0;
+    io->outputsDone = 0;
+    io->inFlight = 0;
+    io->threadRunning = 0;
+    io->freeReadSlotAmount = 0;
+    io->freeWriteSlotAmount = 0;
+    for (int slot = EBI_READ_SLOTS - 1; slot >= 0; slot--)
+    { // The lowest slots are taken first
+        io->freeReadSlot[io->freeReadSlotAmount++] = slot;
+    }
+    for (int slot = EBI_WRITE_SLOTS - 1; slot >= 0; slot--)
+    {
+        io->freeWriteSlot[io->freeWriteSlotAmount++] = slot;
+    }
+    pthread_mutex_init(&io->lock, NULL);
+    pthread_cond_init(&io->changed, NULL);
+    for (int fileIndex = 0; fileIndex < fileAmount; fileIndex++)
+    {
+        files[fileIndex].inputState = mode == EBI_MODE_OFF ? EBI_BY_NAME : EBI_WAITING;
+        files[fileIndex].input = NULL;
+        files[fileIndex].inputSize = 0;
+        files[fileIndex].output = NULL;
+        files[fileIndex].outputSize = 0;
+        files[fileIndex].outputDone = 0;
+        files[fileIndex].outputCheck = SUCCESS;
+        files[fileIndex].pendingOperations = 0;
+    }
+    io->buffers = NULL;
+    io->writeQueue = NULL;
+    if (mode == EBI_MODE_OFF)
+    {
+        return;
+    }
+
+    io->buffers = (unsigned char *)malloc((size_t)EBI_READ_SLOTS * EBI_SLOT_SIZE);
+    io->writeQueue = (int *)malloc(sizeof(int) * (size_t)(fileAmount > 0 ? fileAmount : 1));
+#ifdef EBI_HAVE_URING
+    if (mode == EBI_MODE_URING && io->buffers != NULL && ebiRingStart(io) == SUCCESS)
+    {
+        io->mode = EBI_MODE_URING;
+    }
+#endif
+    if (io->buffers != NULL && io->writeQueue != NULL && pthread_create(&io->thread, NULL, ebiRun, io) == 0)
+    {
+        io->threadRunning = 1;
+        return;
+    }
+#ifdef EBI_HAVE_URING
+    if (io->mode == EBI_MODE_URING)
+    {
+        ebiRingStop(&io->ring);
+    }
+#endif
+    io->mode = EBI_MODE_OFF;
+    for (int fileIndex = 0; fileIndex < fileAmount; fileIndex++)
+    { // Without reading ahead every file is opened by name
+        files[fileIndex].inputState = EBI_BY_NAME;
+    }
+}
+
+/**
+ * This function waits until the input of a file is in memory or has to be opened by name.
+ *
+ * @param io The I/O context
+ * @param fileIndex The file
+ * @return EBI_LOADED if the input is in the input of the file; EBI_BY_NAME if it has to be opened by name
+ */
+int ebiAwaitInput(EbiContext *io, int fileIndex)
+{
+    pthread_mutex_lock(&io->lock);
+    while (io->files[fileIndex].inputState == EBI_WAITING)
+    {
+        pthread_cond_wait(&io->changed, &io->lock);
+    }
+    int state = io->files[fileIndex].inputState; // Where the input is
+    pthread_mutex_unlock(&io->lock);
+    return state;
+}
+
+/**
+ * This function hands the read buffer of a loaded input back, so the next input can be read into it.
+ *
+ * @param io The I/O context
+ * @param fileIndex The file, whose input must no longer be used
+ */
+void ebiReleaseInput(EbiContext *io, int fileIndex)
+{
+    pthread_mutex_lock(&io->lock);
+    EbiFile *file = &io->files[fileIndex];
+    if (file->inputState == EBI_LOADED && file->input != NULL)
+    {
+        io->freeReadSlot[io->freeReadSlotAmount++] = file->slot;
+        file->input = NULL;
+        pthread_cond_broadcast(&io->changed);
+    }
+    pthread_mutex_unlock(&io->lock);
+}
+
+/**
+ * This function hands over the output of a file, which must be done once for every file.
+ *
+ * Only a file whose input was loaded can have output to write, every other file has written its own.
+ *
+ * @param io The I/O context
+ * @param fileIndex The file
+ * @param output The bytes to write to the output file, freed once they are written; NULL if there is nothing to write
+ * @param outputSize The number of bytes
+ */
+void ebiPutOutput(EbiContext *io, int fileIndex, unsigned char *output, long outputSize)
+{
+    pthread_mutex_lock(&io->lock);
+    EbiFile *file = &io->files[fileIndex];
+    if (output != NULL)
+    {
+        file->output = output;
+        file->outputSize = outputSize;
+        io->writeQueue[io->writeTail++] = fileIndex;
+    }
+    else
+    {
+        file->outputDone = 1;
+        io->outputsDone++;
+    }
+    pthread_cond_broadcast(&io->changed);
+    pthread_mutex_unlock(&io->lock);
+}
+
+/**
+ * This function waits until the output of a file is done.
+ *
+ * @param io The I/O context
+ * @param fileIndex The file
+ * @return 0 if the output was written or there was none to write; BAD_FILE or BAD_OUTPUT if writing it failed
+ */
+int ebiAwaitOutput(EbiContext *io, int fileIndex)
+{
+    pthread_mutex_lock(&io->lock);
+    while (!io->files[fileIndex].outputDone)
+    {
+        pthread_cond_wait(&io->changed, &io->lock);
+    }
+    int check = io->files[fileIndex].outputCheck; // The result of writing the output
+    pthread_mutex_unlock(&io->lock);
+    return check;
+}
+
+/**
+ * This function waits for every output to be written and stops the I/O thread.
+ *
+ * @param io The I/O context, every output of which has been handed over
+ */
+void ebiFinish(EbiContext *io)
+{
+    if (io->threadRunning)
+    {
+        pthread_join(io->thread, NULL);
+    }
+#ifdef EBI_HAVE_URING
+    if (io->mode == EBI_MODE_URING)
+    {
+        ebiRingStop(&io->ring);
+    }
+#endif
+    free(io->buffers);
+    free(io->writeQueue);
+    pthread_cond_destroy(&io->changed);
+    pthread_mutex_destroy(&io->lock);
+}
@@ -0,0 +1,89 @@
+#ifndef EBCIO_UTILS_H
+#define EBCIO_UTILS_H
+
+#include "ebUniversalUtils.h"
+#include <pthread.h>
+
+#define EBI_SLOT_SIZE 131072 // The bytes of a read buffer, larger inputs are left to be opened by name
+#define EBI_READ_SLOTS 32    // The most inputs read ahead into memory at a time
+#define EBI_WRITE_SLOTS 32   // The most outputs being written at a time
+#define EBI_QUEUE_DEPTH 256  // The entries of the io_uring submission queue, room for the three operations of every slot
+#define EBI_MODE_URING 0     // Read and write through io_uring, or as EBI_MODE_PLAIN where it is missing
+#define EBI_MODE_PLAIN 1     // Read and write with pread() and pwrite() on the I/O thread
+#define EBI_MODE_OFF 2       // Leave every file to be opened by name
+#define EBI_WAITING 0        // The input has not been read yet
+#define EBI_LOADED 1         // The input is in memory
+#define EBI_BY_NAME 2        // The input has to be opened by name, as it was not read ahead, is too large or could not be read
+#define EBI_READ 0           // The operation in flight for a file reads its input
+#define EBI_WRITE 1          // The operation in flight for a file writes its output
+
+typedef struct ebiFile{
+    char *inputFilename;        // The file to read ahead, NULL to leave it to be opened by name
+    char *outputFilename;       // The file the output goes to
+    int inputState;             // How far the input has got, one of EBI_WAITING, EBI_LOADED and EBI_BY_NAME
+    const unsigned char *input; // The input once it is loaded, in a read buffer
+    long inputSize;             // The bytes of the input
+    unsigned char *output;      // The output waiting to be written, freed once it is
+    long outputSize;            // The bytes of the output
+    int outputDone;             // Whether the output has been handed over and, if there was any, written
+    int outputCheck;            // The result of writing the output
+    int operation;              // What is in flight for the file, EBI_READ or EBI_WRITE, only used by the I/O thread
+    int slot;                   // The read buffer or write slot in use
+    int openResult;             // The file descriptor or error of opening the file, only used by the I/O thread
+    long transferResult;        // The bytes read or written or the error, only used by the I/O thread
+    int pendingOperations;      // The io_uring operations of the file still in flight, only used by the I/O thread
+} EbiFile;
+
+typedef struct ebiRing{
+    int fd;                     // The io_uring instance
+    void *sqMapping;            // The submission queue ring
+    size_t sqMappingSize;       // Its size
+    void *cqMapping;            // The completion queue ring
+    size_t cqMappingSize;       // Its size
+    void *sqes;                 // The submission queue entries
+    size_t sqesSize;            // Their size
+    unsigned *sqHead;           // The first entry the kernel has not taken yet
+    unsigned *sqTail;           // One past the last entry handed to the kernel
+    unsigned *sqMask;           // The mask of positions in the submission queue
+    unsigned *sqArray;          // The entry at every position of the submission queue
+    unsigned sqEntries;         // The number of submission queue entries
+    unsigned sqLocalTail;       // One past the last entry filled in
+    unsigned toSubmit;          // The entries filled in that the kernel has not taken yet
+    unsigned *cqHead;           // The first completion not reaped yet
+    unsigned *cqTail;           // One past the last completion
+    unsigned *cqMask;           // The mask of positions in the completion queue
+    void *cqes;                 // The completions
+    int fixedBuffers;           // Whether the read buffers are registered with the kernel
+} EbiRing;
+
+typedef struct ebiContext{
+    EbiFile *files;                       // Every file, in the order they are worked on
+    int fileAmount;                       // The number of files
+    int mode;                             // How the files are read and written once started, one of the EBI_MODE constants
+    EbiRing ring;                         // The io_uring instance, for EBI_MODE_URING
+    unsigned char *buffers;               // The read buffers, EBI_READ_SLOTS of EBI_SLOT_SIZE bytes
+    int freeReadSlot[EBI_READ_SLOTS];     // The read buffers not in use
+    int freeReadSlotAmount;               // How many read buffers are not in use
+    int freeWriteSlot[EBI_WRITE_SLOTS];   // The write slots not in use
+    int freeWriteSlotAmount;              // How many write slots are not in use
+    int *writeQueue;                      // The files whose output is waiting for a write slot, in the order they were handed over
+    int writeHead;                        // The first file of the queue
+    int writeTail;                        // One past the last file of the queue
+    int nextRead;                         // The first file that has not been read ahead
+    int outputsDone;                      // The number of files whose output is done
+    int inFlight;                         // The number of files with a read or write in flight
+    pthread_mutex_t lock;                 // Guards everything the I/O thread shares with the workers
+    pthread_cond_t changed;               // Signalled whenever an input is ready, a read buffer is freed or an output is handed over or done
+    pthread_t thread;                     // The I/O thread
+    int threadRunning;                    // Whether the I/O thread was started
+} EbiContext;
+
+// function prototypes
+void ebiStart(EbiContext * io, EbiFile * files, int fileAmount, int mode);
+int ebiAwaitInput(EbiContext * io, int fileIndex);
+void ebiReleaseInput(EbiContext * io, int fileIndex);
+void ebiPutOutput(EbiContext * io, int fileIndex, unsigned char * output, long outputSize);
+int ebiAwaitOutput(EbiContext * io, int fileIndex);
+void ebiFinish(EbiContext * io);
+
+#endif
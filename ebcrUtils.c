@@ -3,19 +3,25 @@
 /**
  * This function checks the arguments for ebcR programs
  *
+ * The three positional arguments may be followed by the options read by ebrParseOptions().
+ *
  * @param argc The number of arguments
+ * @param argv The arguments
  * @param scriptName The name of the script
+ * @param fixedParadigmAmount The number of paradigm blocks the program always uses; 0 if it takes --paradigms
+ * @param options The options struct to fill in
  * @return 0 on success and exits on failure
  */
-int ebrCheckArgs(int argc, char *scriptName)
+int ebrCheckArgs(int argc, char **argv, char *scriptName, int fixedParadigmAmount, EbrOptions *options)
 {
     // Check the arguments
     if (argc == 1)
     {
-        printf("Usage: %s <input file> <output file> <seed>\n", scriptName);
+        printf("Usage: %s <input file> <output file> <seed>%s [--threads <count>] [--search <full|pruned|table|tree>] [--cache <on|off|stats>] [--index <packed|rans>]\n",
+               scriptName, fixedParadigmAmount > 0 ? "" : " [--paradigms <count>]");
         exit(0);
     }
-    else if (argc != 4)
+    else if (argc < 4 || ebrParseOptions(argc, argv, 4, fixedParadigmAmount, options) != SUCCESS)
     {
         printf("ERROR: Bad Arguments\n");
         exit(BAD_ARGS);
@@ -23,6 +29,103 @@ int ebrCheckArgs(int argc, char *scriptName)
     return 0;
 }
 
+/**
+ * This function reads the options of an ebcR program
+ *
+ * Every option comes with a value:
+ * --threads <count> spreads the paradigm search over several threads,
+ * --search <full|pruned|table|tree> picks how the closest paradigm block is found, the result is the same every way,
+ * --cache <on|off|stats> turns the cache of image blocks that have been searched for before on or off,
+ * stats also prints how often it was hit,
+ * --paradigms <count> sets the number of paradigm blocks, a power of 2 from 2 to 4096, for programs without a fixed number,
+ * --index <packed|rans> packs the indices at a fixed width or entropy codes them with rANS into an EA file.
+ *
+ * @param argc The number of arguments
+ * @param argv The arguments
+ * @param firstOption The index of the first option in argv
+ * @param fixedParadigmAmount The number of paradigm blocks the program always uses; 0 if it takes --paradigms
+ * @param options The options struct to fill in, options that are not given keep their defaults
+ * @return 0 on success; BAD_ARGS if an option or its value is not known
+ */
+int ebrParseOptions(int argc, char **argv, int firstOption, int fixedParadigmAmount, EbrOptions *options)
+{
+    if ((argc - firstOption) % 2 != 0)
+    { // Every option comes with a value
+        return BAD_ARGS;
+    }
+
+    options->threadAmount = 1;          // Without --threads the search runs on the calling thread only
+    options->search = EBR_SEARCH_FULL; // Without --search every paradigm block is compared
+    options->cache = EBR_CACHE_ON;     // Without --cache repeated image blocks are only searched for once
+    options->paradigmBlockAmount = fixedParadigmAmount > 0 ? fixedParadigmAmount : EBR_DEFAULT_PARADIGMS;
+    options->entropyCoded = 0;         // Without --index the indices are packed
+    for (int argIndex = firstOption; argIndex < argc; argIndex += 2)
+    { // Loop through the options
+        char *value = argv[argIndex + 1]; // The value of the option
+        if (strcmp(argv[argIndex], "--threads") == 0)
+        {
+            char *end = NULL;                           // Where the thread count stops being a number
+            long threadAmount = strtol(value, &end, 10); // The number of threads asked for
+            if (end == value || *end != '\0' || threadAmount < 1 || threadAmount > EBR_MAX_THREADS)
+            {
+                return BAD_ARGS;
+            }
+            options->threadAmount = (int)threadAmount;
+        }
+        else if (strcmp(argv[argIndex], "--paradigms") == 0 && fixedParadigmAmount == 0)
+        {
+            char *end = NULL;                                  // Where the paradigm count stops being a number
+            long paradigmBlockAmount = strtol(value, &end, 10); // The number of paradigm blocks asked for
+            if (end == value || *end != '\0' || paradigmBlockAmount > EBC_MAX_PARADIGMS || ebcIndexBitWidth((int)paradigmBlockAmount) == 0)
+            {
+                return BAD_ARGS;
+            }
+            options->paradigmBlockAmount = (int)paradigmBlockAmount;
+        }
+        else if (strcmp(argv[argIndex], "--search") == 0 && strcmp(value, "full") == 0)
+        {
+            options->search = EBR_SEARCH_FULL;
+        }
+        else if (strcmp(argv[argIndex], "--search") == 0 && strcmp(value, "pruned") == 0)
+        {
+            options->search = EBR_SEARCH_PRUNED;
+        }
+        else if (strcmp(argv[argIndex], "--search") == 0 && strcmp(value, "table") == 0)
+        {
+            options->search = EBR_SEARCH_TABLE;
+        }
+        else if (strcmp(argv[argIndex], "--search") == 0 && strcmp(value, "tree") == 0)
+        {
+            options->search = EBR_SEARCH_TREE;
+        }
+        else if (strcmp(argv[argIndex], "--cache") == 0 && strcmp(value, "on") == 0)
+        {
+            options->cache = EBR_CACHE_ON;
+        }
+        else if (strcmp(argv[argIndex], "--cache") == 0 && strcmp(value, "off") == 0)
+        {
+            options->cache = EBR_CACHE_OFF;
+        }
+        else if (strcmp(argv[argIndex], "--cache") == 0 && strcmp(value, "stats") == 0)
+        {
+            options->cache = EBR_CACHE_STATS;
+        }
+        else if (strcmp(argv[argIndex], "--index") == 0 && strcmp(value, "packed") == 0)
+        {
+            options->entropyCoded = 0;
+        }
+        else if (strcmp(argv[argIndex], "--index") == 0 && strcmp(value, "rans") == 0)
+        {
+            options->entropyCoded = 1;
+        }
+        else
+        { // Unknown option or value
+            return BAD_ARGS;
+        }
+    }
+    return SUCCESS;
+}
+
 // /**
 //  * DEPRECATED - This function generates a random series of numbers
 //  *
@@ -72,17 +175,119 @@ int ebrCheckArgs(int argc, char *scriptName)
 //     return 0;
 // }
 
-    /**
-     * This function generates a series of non repeating paradigm blocks
-     *
-     * @param imageBlock The array of blocks of image data
-     * @param imageBlockAmount The number of image blocks
-     * @param paradigmBlockAmount The number of paradigm blocks needed to be generated
-     * @param seed The seed for the random number generator
-     * @return The array of paradigm blocks on success, NULL on failure
-     */
-    Block *
-    generateParadigmBlocks(Block *imageBlock, int imageBlockAmount, int paradigmBlockAmount, int seed)
+/**
+ * This function copies a block into a lane, its pixels row after row with the rest of the lane zero.
+ *
+ * @param block The block to copy, a standard BLOCK_WIDTH x BLOCK_HEIGHT block
+ * @param lane The lane to copy the block into
+ */
+static void ebrLoadLane(const Block *block, unsigned char *lane)
+{
+    memset(lane, 0, EBR_LANE_SIZE);
+    for (int blockY = 0; blockY < BLOCK_HEIGHT; blockY++)
+    {
+        for (int blockX = 0; blockX < BLOCK_WIDTH; blockX++)
+        {
+            lane[blockY * BLOCK_WIDTH + blockX] = (unsigned char)block->data[blockY][blockX];
+        }
+    }
+}
+
+/**
+ * This function packs the pixels of a lane into one key, 5 bits each, so equal blocks have equal keys.
+ *
+ * @param lane The lane to pack
+ * @return The key of the lane, it uses the low 45 bits
+ */
+static unsigned long long ebrLaneKey(const unsigned char *lane)
+{
+    unsigned long long key = 0; // The pixels of the lane packed side by side
+    for (int laneIndex = 0; laneIndex < BLOCK_SIZE; laneIndex++)
+    {
+        key = (key << 5) | (lane[laneIndex] & MAX_GREY_VALUE);
+    }
+    return key;
+}
+
+/**
+ * This function works out where a key is looked for first in an open addressing hash table.
+ *
+ * @param key The key
+ * @param mask The size of the table minus 1, the size being a power of 2
+ * @return The home of the key in the table
+ */
+static unsigned long ebrKeyHome(unsigned long long key, unsigned long mask)
+{
+    return (unsigned long)((key * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+}
+
+/**
+ * This function gives the next 32 bit number of a random number generator.
+ *
+ * @param random The generator
+ * @return The next number
+ */
+static uint32_t ebrRandomNext(EbrRandom *random)
+{
+    uint64_t oldState = random->state; // The state the number is made from
+    random->state = oldState * 6364136223846793005ull + random->increment;
+    uint32_t shuffled = (uint32_t)(((oldState >> 18) ^ oldState) >> 27);
+    uint32_t rotation = (uint32_t)(oldState >> 59);
+    return (shuffled >> rotation) | (shuffled << ((32 - rotation) & 31));
+}
+
+/**
+ * This function seeds a random number generator.
+ *
+ * The generator is PCG32, so the same seed gives the same numbers with every C library.
+ *
+ * @param random The generator to seed
+ * @param seed The seed
+ */
+static void ebrRandomSeed(EbrRandom *random, int seed)
+{
+    random->state = 0;
+    random->increment = (EBR_RANDOM_STREAM << 1) | 1;
+    ebrRandomNext(random);
+    random->state += (uint32_t)seed;
+    ebrRandomNext(random);
+}
+
+/**
+ * This function gives a random number from 0 up to but not including bound, every number equally likely.
+ *
+ * @param random The generator
+ * @param bound One more than the largest number wanted, at least 1
+ * @return The number
+ */
+static uint32_t ebrRandomBelow(EbrRandom *random, uint32_t bound)
+{
+    uint32_t threshold = (uint32_t)(0x100000000ull % bound); // Numbers below this would make the low results more likely
+    for (;;)
+    {
+        uint32_t number = ebrRandomNext(random);
+        if (number >= threshold)
+        {
+            return number % bound;
+        }
+    }
+}
+
+/**
+ * This function generates a series of non repeating paradigm blocks
+ *
+ * Image blocks are drawn at random without replacement, a partial shuffle of their indices, and kept if no
+ * paradigm block with the same pixels has been kept yet, which a hash set of block keys tells straight away.
+ * If the image runs out of different blocks first, the paradigm blocks found are repeated to fill the rest.
+ * Repeats are never picked when matching, as the first of equally close paradigm blocks wins.
+ *
+ * @param imageBlock The array of blocks of image data
+ * @param imageBlockAmount The number of image blocks
+ * @param paradigmBlockAmount The number of paradigm blocks needed to be generated
+ * @param seed The seed for the random number generator
+ * @return The array of paradigm blocks on success, to be freed with blockFreeArena(); NULL on failure
+ */
+Block *generateParadigmBlocks(Block *imageBlock, int imageBlockAmount, int paradigmBlockAmount, int seed)
 {
     // Safety checks
     if (imageBlock == NULL)
@@ -94,185 +299,1213 @@ int ebrCheckArgs(int argc, char *scriptName)
         return NULL;
     }
 
-    Block *paradigmBlock = (Block *)malloc(sizeof(Block) * paradigmBlockAmount); // allocate memory for the paradigm block array
-    if (paradigmBlock == NULL)
-    {                // check if the memory allocation failed
-        return NULL; // return NULL if the memory allocation failed
-    }
-
     if (paradigmBlockAmount < 1)
     {                // check if the paradigm block amount is less than 1
         return NULL; // return NULL if the paradigm block amount is less than 1
     }
 
-    srand(seed);                                                          // set the seed for the random number generator
-    int *randomSeries = (int *)malloc(sizeof(int) * paradigmBlockAmount); // allocate memory for the random series
-    if (randomSeries == NULL)
-    {                // check if the memory allocation failed
+    unsigned long setSize = 2; // The size of the hash set, a power of 2 at least twice the paradigm block amount
+    while (setSize < 2 * (unsigned long)paradigmBlockAmount)
+    {
+        setSize *= 2;
+    }
+    Block *paradigmBlock = blockCreateArena(paradigmBlockAmount);                                   // allocate memory for the paradigm blocks
+    int *undrawn = (int *)malloc(sizeof(int) * (size_t)imageBlockAmount);                           // the indices of the image blocks not drawn yet
+    unsigned long long *keySet = (unsigned long long *)malloc(sizeof(unsigned long long) * setSize); // the keys of the paradigm blocks kept so far
+    if (paradigmBlock == NULL || undrawn == NULL || keySet == NULL)
+    { // check if the memory allocation failed
+        if (paradigmBlock != NULL)
+        {
+            blockFreeArena(paradigmBlock);
+        }
+        free(undrawn);
+        free(keySet);
         return NULL; // return NULL if the memory allocation failed
     }
-    int randBuffer = 0;    // buffer for the random number
-    int randGenerated = 0; // number of random numbers generated and added to the random series
-    int blockDiff = 0;     // difference between two blocks (used to check if the paradigm block is the same as a paradigm block chosen before)
-    for (int i = 0; i < paradigmBlockAmount; i++)
-    {                                                 // loop through the paradigm block array
-        randBuffer = rand() % (imageBlockAmount + 1); // generate a random number with max value of the number of image blocks
-        for (int j = 0; j < randGenerated; j++)
-        { // loop through the random series
-            if (randomSeries[j] == randBuffer)
-            {                    // check if the random number is the same as a random number chosen before
-                i--;             // decrement i to generate another random number
-                randBuffer = -1; // set the random number to -1 to indicate that the random number is invalid
-                break;           // break out of the loop
+    for (int blockIndex = 0; blockIndex < imageBlockAmount; blockIndex++)
+    {
+        undrawn[blockIndex] = blockIndex;
+    }
+    for (unsigned long slot = 0; slot < setSize; slot++)
+    {
+        keySet[slot] = EBR_KEY_SET_EMPTY;
+    }
+
+    EbrRandom random; // the random number generator
+    ebrRandomSeed(&random, seed);
+    int undrawnAmount = imageBlockAmount; // the number of image blocks not drawn yet
+    int kept = 0;                         // the number of paradigm blocks kept so far
+    while (kept < paradigmBlockAmount && undrawnAmount > 0)
+    { // draw image blocks until there are enough paradigm blocks or no image blocks are left
+        int drawIndex = (int)ebrRandomBelow(&random, (uint32_t)undrawnAmount); // pick one of the image blocks not drawn yet
+        int blockIndex = undrawn[drawIndex];
+        undrawn[drawIndex] = undrawn[--undrawnAmount]; // the last undrawn image block takes its place
+
+        unsigned char lane[EBR_LANE_SIZE]; // the drawn image block as a lane
+        ebrLoadLane(&imageBlock[blockIndex], lane);
+        unsigned long long key = ebrLaneKey(lane); // the key of the drawn image block
+        unsigned long slot = ebrKeyHome(key, setSize - 1);
+        while (keySet[slot] != EBR_KEY_SET_EMPTY && keySet[slot] != key)
+        { // the set is never more than half full, so an empty slot is always found
+            slot = (slot + 1) & (setSize - 1);
+        }
+        if (keySet[slot] == key)
+        {
+            continue; // a paradigm block with the same pixels has already been kept
+        }
+        keySet[slot] = key;
+        for (int blockY = 0; blockY < BLOCK_HEIGHT; blockY++)
+        { // loop through the rows of the paradigm block
+            for (int blockX = 0; blockX < BLOCK_WIDTH; blockX++)
+            {                                                                                            // loop through the columns of the paradigm block
+                paradigmBlock[kept].data[blockY][blockX] = imageBlock[blockIndex].data[blockY][blockX]; // copy the data from the image block to the paradigm block
             }
-            // check if the paradigm block is the same as a paradigm block chosen before
-            blockDiff = blockDifference(imageBlock[randBuffer], paradigmBlock[j]); // get the difference between the two blocks
-            if (blockDiff == 0)
-            {                    // If the difference is 0, the blocks are the same
-                i--;             // decrement i to generate another random number
-                randBuffer = -1; // set the random number to -1 to indicate that the random number is invalid
-                break;           // break out of the loop
+        }
+        kept++;
+    }
+
+    for (int pbIndex = kept; pbIndex < paradigmBlockAmount; pbIndex++)
+    { // the image has fewer different blocks than paradigm blocks, repeat the ones found
+        memcpy(paradigmBlock[pbIndex].data, paradigmBlock[pbIndex % kept].data, sizeof(Pixel) * BLOCK_SIZE);
+    }
+    free(undrawn);
+    free(keySet);
+    return paradigmBlock;
+}
+
+/**
+ * This function works out the sum of absolute differences between a block and every paradigm block.
+ *
+ * @param lane The block, as a lane
+ * @param paradigmLanes The paradigm blocks, one lane each
+ * @param paradigmBlockAmount The number of paradigm blocks
+ * @param distances The array to store the distance to every paradigm block in
+ */
+static void ebrDistances(const unsigned char *lane, const unsigned char (*paradigmLanes)[EBR_LANE_SIZE], int paradigmBlockAmount, int *distances)
+{
+    for (int pbIndex = 0; pbIndex < paradigmBlockAmount; pbIndex++)
+    {
+        int sum = 0; // The sum of the differences of this paradigm block
+        for (int laneIndex = 0; laneIndex < BLOCK_SIZE; laneIndex++)
+        {
+            sum += abs((int)lane[laneIndex] - (int)paradigmLanes[pbIndex][laneIndex]);
+        }
+        distances[pbIndex] = sum;
+    }
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define EBR_X86 // Build the SSE2 and AVX2 kernels, they are only used when the CPU reports support
+#include <immintrin.h>
+
+/**
+ * This function is ebrDistances() using SSE2.
+ *
+ * psadbw sums the absolute differences of each 8 byte half of a lane, so adding the two halves
+ * gives the distance to one paradigm block. The zero padding adds nothing.
+ */
+__attribute__((target("sse2"))) static void ebrDistancesSse2(const unsigned char *lane, const unsigned char (*paradigmLanes)[EBR_LANE_SIZE], int paradigmBlockAmount, int *distances)
+{
+    __m128i block = _mm_loadu_si128((const __m128i *)lane);
+    for (int pbIndex = 0; pbIndex < paradigmBlockAmount; pbIndex++)
+    {
+        __m128i sad = _mm_sad_epu8(block, _mm_loadu_si128((const __m128i *)paradigmLanes[pbIndex]));
+        distances[pbIndex] = _mm_cvtsi128_si32(_mm_add_epi32(sad, _mm_srli_si128(sad, 8)));
+    }
+}
+
+/**
+ * This function is ebrDistances() using AVX2.
+ *
+ * Four paradigm blocks are compared per step, two in each 256 bit psadbw. Interleaving the two
+ * results lines the halves of every paradigm block up, so one add gives all four distances.
+ */
+__attribute__((target("avx2"))) static void ebrDistancesAvx2(const unsigned char *lane, const unsigned char (*paradigmLanes)[EBR_LANE_SIZE], int paradigmBlockAmount, int *distances)
+{
+    __m256i block = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)lane));
+    int pbIndex = 0; // The next paradigm block to compare
+    for (; pbIndex + 4 <= paradigmBlockAmount; pbIndex += 4)
+    {
+        __m256i first = _mm256_sad_epu8(block, _mm256_loadu_si256((const __m256i *)paradigmLanes[pbIndex]));      // Paradigm blocks 0 and 1
+        __m256i second = _mm256_sad_epu8(block, _mm256_loadu_si256((const __m256i *)paradigmLanes[pbIndex + 2])); // Paradigm blocks 2 and 3
+        __m256i sums = _mm256_add_epi64(_mm256_unpacklo_epi64(first, second), _mm256_unpackhi_epi64(first, second)); // Distances 0, 2, 1, 3
+        __m128i low = _mm256_castsi256_si128(sums);
+        __m128i high = _mm256_extracti128_si256(sums, 1);
+        distances[pbIndex] = _mm_cvtsi128_si32(low);
+        distances[pbIndex + 1] = _mm_cvtsi128_si32(high);
+        distances[pbIndex + 2] = _mm_cvtsi128_si32(_mm_srli_si128(low, 8));
+        distances[pbIndex + 3] = _mm_cvtsi128_si32(_mm_srli_si128(high, 8));
+    }
+    ebrDistancesSse2(lane, paradigmLanes + pbIndex, paradigmBlockAmount - pbIndex, distances + pbIndex); // The paradigm blocks left over
+}
+#endif
+
+// The distance kernel in use, ebrSelectKernels() swaps in the widest one the CPU supports
+static void (*ebrDistancesKernel)(const unsigned char *lane, const unsigned char (*paradigmLanes)[EBR_LANE_SIZE], int paradigmBlockAmount, int *distances) = ebrDistances;
+
+/**
+ * This function picks the distance kernel for the CPU the program is running on.
+ *
+ * AVX2 is preferred, then SSE2, then the scalar kernel.
+ */
+static void ebrPickKernels(void)
+{
+#ifdef EBR_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        ebrDistancesKernel = ebrDistancesAvx2;
+    }
+    else if (__builtin_cpu_supports("sse2"))
+    {
+        ebrDistancesKernel = ebrDistancesSse2;
+    }
+#endif
+}
+
+/**
+ * This function picks the distance kernel once, however many threads ask at the same time.
+ */
+static void ebrSelectKernels(void)
+{
+    static pthread_once_t selected = PTHREAD_ONCE_INIT; // Whether the kernel has already been picked
+    pthread_once(&selected, ebrPickKernels);
+}
+
+/**
+ * This function finds the index of the closest paradigm block to one image block by comparing it with all of them.
+ *
+ * @param job The search, holding the paradigm blocks
+ * @param lane The image block, as a lane
+ * @param distances Scratch space for the distance to every paradigm block
+ * @return The index of the closest paradigm block, the lowest one if several are equally close
+ */
+static int ebrNearestFull(const EbrMatchJob *job, const unsigned char *lane, int *distances)
+{
+    ebrDistancesKernel(lane, job->paradigmLanes, job->paradigmBlockAmount, distances); // compare the image block with every paradigm block
+
+    int bestMatchPBIndex = 0; // The index of the closest paradigm block so far
+    for (int pbIndex = 1; pbIndex < job->paradigmBlockAmount; pbIndex++)
+    {
+        if (distances[pbIndex] < distances[bestMatchPBIndex])
+        { // Only a strictly closer paradigm block replaces the best one, so ties go to the lowest index
+            bestMatchPBIndex = pbIndex;
+        }
+    }
+    return bestMatchPBIndex;
+}
+
+/**
+ * This function adds up the pixels of a lane.
+ *
+ * @param lane The lane to add up
+ * @return The sum of the pixels
+ */
+static int ebrLaneSum(const unsigned char *lane)
+{
+    int sum = 0; // The sum of the lane
+    for (int laneIndex = 0; laneIndex < BLOCK_SIZE; laneIndex++)
+    {
+        sum += lane[laneIndex];
+    }
+    return sum;
+}
+
+/**
+ * This function finds the index of the closest paradigm block to one image block, skipping the paradigm blocks that cannot be closest.
+ *
+ * The difference between the sums of two blocks is never more than the sum of their absolute differences.
+ * The paradigm blocks are visited in order of how close their sum is to the sum of the image block, so once
+ * that difference is more than the best distance found, no paradigm block that is left can be closer.
+ * Each distance is added up a row at a time and given up on as soon as it cannot beat the best one.
+ * The result is the same as ebrNearestFull(), ties included.
+ *
+ * @param job The search, holding the paradigm blocks sorted by their sums
+ * @param lane The image block, as a lane
+ * @return The index of the closest paradigm block, the lowest one if several are equally close
+ */
+static int ebrNearestPruned(const EbrMatchJob *job, const unsigned char *lane)
+{
+    int blockSum = ebrLaneSum(lane); // The sum of the image block
+    int below = 0;                   // Find the first paradigm block with a sum of at least blockSum
+    int above = job->paradigmBlockAmount;
+    while (below < above)
+    {
+        int middle = (below + above) / 2;
+        if (job->sorted[middle].sum < blockSum)
+        {
+            below = middle + 1;
+        }
+        else
+        {
+            above = middle;
+        }
+    }
+    below--; // The next paradigm block to visit with a smaller sum
+
+    int bestDistance = INT_MAX; // The distance to the closest paradigm block so far
+    int bestMatchPBIndex = 0;   // The index of the closest paradigm block so far
+    while (below >= 0 || above < job->paradigmBlockAmount)
+    { // Visit the paradigm blocks from the closest sum outwards
+        int sortedIndex;  // The paradigm block to visit, in sorted order
+        int bound;        // The smallest distance this paradigm block can have
+        if (above >= job->paradigmBlockAmount || (below >= 0 && blockSum - job->sorted[below].sum <= job->sorted[above].sum - blockSum))
+        {
+            sortedIndex = below--;
+            bound = blockSum - job->sorted[sortedIndex].sum;
+        }
+        else
+        {
+            sortedIndex = above++;
+            bound = job->sorted[sortedIndex].sum - blockSum;
+        }
+        if (bound > bestDistance)
+        {
+            break; // Every paradigm block left is at least as far off in sum, so none can be closer
+        }
+
+        int pbIndex = job->sorted[sortedIndex].index;            // The index of the paradigm block in the file
+        const unsigned char *paradigm = job->sorted[sortedIndex].lane; // The paradigm block, as a lane
+        int distance = 0;                                       // The distance to the paradigm block so far
+        for (int blockY = 0; blockY < BLOCK_HEIGHT; blockY++)
+        { // Add up the distance a row at a time
+            for (int blockX = 0; blockX < BLOCK_WIDTH; blockX++)
+            {
+                distance += abs((int)lane[blockY * BLOCK_WIDTH + blockX] - (int)paradigm[blockY * BLOCK_WIDTH + blockX]);
+            }
+            if (distance > bestDistance || (distance == bestDistance && pbIndex > bestMatchPBIndex))
+            {
+                break; // This paradigm block can no longer replace the best one
+            }
+        }
+        if (distance < bestDistance || (distance == bestDistance && pbIndex < bestMatchPBIndex))
+        { // Closer, or as close with a lower index
+            bestDistance = distance;
+            bestMatchPBIndex = pbIndex;
+        }
+    }
+    return bestMatchPBIndex;
+}
+
+/**
+ * This function works out the key of a row of a lane, its three 5 bit pixels side by side.
+ *
+ * @param lane The lane
+ * @param blockY The row of the lane
+ * @return The key of the row, less than EBR_ROW_KEYS
+ */
+static int ebrRowKey(const unsigned char *lane, int blockY)
+{
+    const unsigned char *row = lane + blockY * BLOCK_WIDTH; // The pixels of the row
+    return ((row[0] & MAX_GREY_VALUE) << 10) | ((row[1] & MAX_GREY_VALUE) << 5) | (row[2] & MAX_GREY_VALUE);
+}
+
+/**
+ * This function builds the row tables for EBR_SEARCH_TABLE.
+ *
+ * For every row of a block and every possible key of that row the table holds the distance from the row
+ * to the same row of every paradigm block, one byte each, the paradigm blocks side by side.
+ * A row is at most 3 x 31 away from another, so a byte is enough.
+ *
+ * @param paradigmLanes The paradigm blocks, one lane each
+ * @param paradigmBlockAmount The number of paradigm blocks
+ * @return The tables, BLOCK_HEIGHT x EBR_ROW_KEYS x paradigmBlockAmount bytes; NULL if memory allocation fails
+ */
+static unsigned char *ebrBuildRowTables(const unsigned char (*paradigmLanes)[EBR_LANE_SIZE], int paradigmBlockAmount)
+{
+    unsigned char *rowTables = (unsigned char *)malloc((size_t)BLOCK_HEIGHT * EBR_ROW_KEYS * paradigmBlockAmount);
+    if (rowTables == NULL)
+    {
+        return NULL; // Return if memory allocation failed
+    }
+
+    unsigned char *entry = rowTables; // The next entry to fill in
+    for (int blockY = 0; blockY < BLOCK_HEIGHT; blockY++)
+    {
+        for (int key = 0; key < EBR_ROW_KEYS; key++)
+        {
+            int left = key >> 10;                   // The pixels of the row with this key
+            int middle = (key >> 5) & MAX_GREY_VALUE;
+            int right = key & MAX_GREY_VALUE;
+            for (int pbIndex = 0; pbIndex < paradigmBlockAmount; pbIndex++)
+            {
+                const unsigned char *row = paradigmLanes[pbIndex] + blockY * BLOCK_WIDTH; // The same row of the paradigm block
+                *entry++ = (unsigned char)(abs(left - row[0]) + abs(middle - row[1]) + abs(right - row[2]));
+            }
+        }
+    }
+    return rowTables;
+}
+
+/**
+ * This function finds the index of the closest paradigm block to one image block using the row tables.
+ *
+ * The distance to every paradigm block is the sum of three table entries, one for each row. The entries for
+ * all the paradigm blocks lie side by side, so the three rows are added up for all of them in one pass.
+ *
+ * @param job The search, holding the row tables
+ * @param lane The image block, as a lane
+ * @param distances Scratch space for the distance to every paradigm block
+ * @return The index of the closest paradigm block, the lowest one if several are equally close
+ */
+static int ebrNearestTable(const EbrMatchJob *job, const unsigned char *lane, int *distances)
+{
+    size_t rowSize = (size_t)EBR_ROW_KEYS * job->paradigmBlockAmount;                                            // The bytes in the table of one row
+    const unsigned char *top = job->rowTables + (size_t)ebrRowKey(lane, 0) * job->paradigmBlockAmount;             // The entries for the top row
+    const unsigned char *middle = job->rowTables + rowSize + (size_t)ebrRowKey(lane, 1) * job->paradigmBlockAmount; // The entries for the middle row
+    const unsigned char *bottom = job->rowTables + 2 * rowSize + (size_t)ebrRowKey(lane, 2) * job->paradigmBlockAmount;
+    for (int pbIndex = 0; pbIndex < job->paradigmBlockAmount; pbIndex++)
+    {
+        distances[pbIndex] = top[pbIndex] + middle[pbIndex] + bottom[pbIndex];
+    }
+
+    int bestMatchPBIndex = 0; // The index of the closest paradigm block so far
+    for (int pbIndex = 1; pbIndex < job->paradigmBlockAmount; pbIndex++)
+    {
+        if (distances[pbIndex] < distances[bestMatchPBIndex])
+        { // Only a strictly closer paradigm block replaces the best one, so ties go to the lowest index
+            bestMatchPBIndex = pbIndex;
+        }
+    }
+    return bestMatchPBIndex;
+}
+
+/**
+ * This function orders tree nodes by their distance to the vantage point above them for qsort(), then by index.
+ *
+ * @param first The first node, as an EbrTreeNode
+ * @param second The second node, as an EbrTreeNode
+ * @return Less than, equal to or more than 0 if the first node goes before, with or after the second
+ */
+static int ebrCompareTreeDistances(const void *first, const void *second)
+{
+    const EbrTreeNode *firstNode = (const EbrTreeNode *)first;
+    const EbrTreeNode *secondNode = (const EbrTreeNode *)second;
+    if (firstNode->distance != secondNode->distance)
+    {
+        return firstNode->distance < secondNode->distance ? -1 : 1;
+    }
+    return firstNode->index - secondNode->index;
+}
+
+/**
+ * This function turns a run of tree nodes into a vantage point tree, in place.
+ *
+ * The first node of the run becomes the vantage point. The rest are sorted by their distance to it, the closer
+ * half become the inner children and the farther half the outer children, and both halves are built the same way.
+ * Runs of EBR_TREE_LEAF nodes or fewer are left as they are, they are searched by comparing every node.
+ *
+ * @param tree The nodes
+ * @param start The first node of the run
+ * @param end One past the last node of the run
+ */
+static void ebrBuildTree(EbrTreeNode *tree, int start, int end)
+{
+    if (end - start <= EBR_TREE_LEAF)
+    {
+        return;
+    }
+    EbrTreeNode *vantage = &tree[start]; // The vantage point of the run
+    for (int nodeIndex = start + 1; nodeIndex < end; nodeIndex++)
+    {
+        ebrDistancesKernel(vantage->lane, (const unsigned char (*)[EBR_LANE_SIZE])tree[nodeIndex].lane, 1, &tree[nodeIndex].distance);
+    }
+    qsort(tree + start + 1, end - start - 1, sizeof(EbrTreeNode), ebrCompareTreeDistances);
+
+    vantage->split = start + 1 + (end - start - 1) / 2;
+    vantage->end = end;
+    vantage->innerMax = vantage->split > start + 1 ? tree[vantage->split - 1].distance : 0;
+    vantage->outerMin = vantage->split < end ? tree[vantage->split].distance : 0;
+    ebrBuildTree(tree, start + 1, vantage->split);
+    ebrBuildTree(tree, vantage->split, end);
+}
+
+/**
+ * This function looks for paradigm blocks closer than the best one so far in a vantage point tree.
+ *
+ * The distance is a metric, so a node at distance d from the vantage point is at least |distance - d| from the
+ * image block. A group of children is skipped when that bound shows none of them can beat the best one,
+ * which takes being closer, or as close with a lower index.
+ *
+ * @param job The search, holding the tree
+ * @param nodeIndex The node to start at
+ * @param end One past the last node under nodeIndex
+ * @param lane The image block, as a lane
+ * @param bestDistance The distance to the closest paradigm block so far, updated
+ * @param bestMatchPBIndex The index of the closest paradigm block so far, updated
+ */
+static void ebrSearchTree(const EbrMatchJob *job, int nodeIndex, int end, const unsigned char *lane, int *bestDistance, int *bestMatchPBIndex)
+{
+    if (end - nodeIndex <= EBR_TREE_LEAF)
+    { // A run that was not split, compare every node
+        int distances[EBR_TREE_LEAF]; // The distance to every node of the run
+        ebrDistancesKernel(lane, job->treeLanes + nodeIndex, end - nodeIndex, distances);
+        for (int leafIndex = 0; leafIndex < end - nodeIndex; leafIndex++)
+        {
+            int pbIndex = job->tree[nodeIndex + leafIndex].index; // The index of the paradigm block in the file
+            if (distances[leafIndex] < *bestDistance || (distances[leafIndex] == *bestDistance && pbIndex < *bestMatchPBIndex))
+            { // Closer, or as close with a lower index
+                *bestDistance = distances[leafIndex];
+                *bestMatchPBIndex = pbIndex;
             }
         }
-        if (randBuffer != -1)
-        {                                                                                   // check if the random number is valid
-            randomSeries[randGenerated] = randBuffer;                                       // add the random number to the random series if the random number is valid
-            paradigmBlock[randGenerated].height = BLOCK_HEIGHT;                             // set the height of the paradigm block
-            paradigmBlock[randGenerated].width = BLOCK_WIDTH;                               // set the width of the paradigm block
-            paradigmBlock[randGenerated].data = ebCreate2DArray(BLOCK_HEIGHT, BLOCK_WIDTH); // allocate memory for the paradigm block data
-            if (paradigmBlock[randGenerated].data == NULL)
-            {                // check if the memory allocation failed
-                return NULL; // return NULL if the memory allocation failed
+        return;
+    }
+    const EbrTreeNode *vantage = &job->tree[nodeIndex]; // The vantage point
+    int distance;                                       // The distance from the image block to the vantage point
+    ebrDistancesKernel(lane, job->treeLanes + nodeIndex, 1, &distance);
+    if (distance < *bestDistance || (distance == *bestDistance && vantage->index < *bestMatchPBIndex))
+    { // Closer, or as close with a lower index
+        *bestDistance = distance;
+        *bestMatchPBIndex = vantage->index;
+    }
+
+    int innerFirst = distance <= vantage->innerMax; // The image block is among the inner children, look there first
+    for (int pass = 0; pass < 2; pass++)
+    {
+        if ((pass == 0) == innerFirst)
+        {
+            if (distance - vantage->innerMax <= *bestDistance)
+            { // An inner child may still be close enough
+                ebrSearchTree(job, nodeIndex + 1, vantage->split, lane, bestDistance, bestMatchPBIndex);
             }
-            for (int blockY = 0; blockY < BLOCK_HEIGHT; blockY++)
-            { // loop through the rows of the paradigm block
-                for (int blockX = 0; blockX < BLOCK_WIDTH; blockX++)
-                {                                                                                                    // loop through the columns of the paradigm block
-                    paradigmBlock[randGenerated].data[blockY][blockX] = imageBlock[randBuffer].data[blockY][blockX]; // copy the data from the image block to the paradigm block
-                }
+        }
+        else if (vantage->outerMin - distance <= *bestDistance)
+        { // An outer child may still be close enough
+            ebrSearchTree(job, vantage->split, vantage->end, lane, bestDistance, bestMatchPBIndex);
+        }
+    }
+}
+
+/**
+ * This function finds the index of the closest paradigm block to one image block using the vantage point tree.
+ *
+ * @param job The search, holding the tree
+ * @param lane The image block, as a lane
+ * @return The index of the closest paradigm block, the lowest one if several are equally close
+ */
+static int ebrNearestTree(const EbrMatchJob *job, const unsigned char *lane)
+{
+    int bestDistance = INT_MAX; // The distance to the closest paradigm block so far
+    int bestMatchPBIndex = 0;   // The index of the closest paradigm block so far
+    ebrSearchTree(job, 0, job->paradigmBlockAmount, lane, &bestDistance, &bestMatchPBIndex);
+    return bestMatchPBIndex;
+}
+
+/**
+ * This function finds the index of the closest paradigm block to one image block the way the search asks for.
+ *
+ * @param job The search
+ * @param lane The image block, as a lane
+ * @param distances Scratch space for the distance to every paradigm block
+ * @return The index of the closest paradigm block, the lowest one if several are equally close
+ */
+static int ebrNearest(const EbrMatchJob *job, const unsigned char *lane, int *distances)
+{
+    switch (job->search)
+    {
+    case EBR_SEARCH_PRUNED:
+        return ebrNearestPruned(job, lane);
+    case EBR_SEARCH_TABLE:
+        return ebrNearestTable(job, lane, distances);
+    case EBR_SEARCH_TREE:
+        return ebrNearestTree(job, lane);
+    default:
+        return ebrNearestFull(job, lane, distances);
+    }
+}
+
+/**
+ * This function finds the index of the closest paradigm block to one image block, asking the cache of the thread first.
+ *
+ * The cache is an open addressing hash table keyed by the 45 bits of the image block. An image block that is
+ * not in it is searched for and added, unless the table is half full or every entry it could go in is taken.
+ * On images with few repeated blocks the lookups only cost time, so a thread that hits fewer than 1 in 8 of its
+ * first EBR_CACHE_TRIAL lookups drops its cache. The cache only ever holds what a search returned, so the result
+ * is the same as without it.
+ *
+ * @param worker The thread, holding its cache
+ * @param lane The image block, as a lane
+ * @return The index of the closest paradigm block, the lowest one if several are equally close
+ */
+static int ebrNearestCached(EbrWorker *worker, const unsigned char *lane)
+{
+    if (worker->cache != NULL && worker->cacheLookups == EBR_CACHE_TRIAL && worker->cacheHits * 8 < worker->cacheLookups)
+    { // Too few hits to be worth the lookups
+        free(worker->cache);
+        worker->cache = NULL;
+    }
+    if (worker->cache == NULL)
+    {
+        return ebrNearest(worker->job, lane, worker->distances);
+    }
+
+    unsigned long long key = ebrLaneKey(lane);                  // The pixels of the image block packed side by side
+    unsigned long slot = ebrKeyHome(key, worker->cacheSize - 1); // Where the key is looked for first
+    worker->cacheLookups++;
+    for (int probe = 0; probe < EBR_CACHE_PROBES; probe++)
+    { // Look through the entries after the home of the key
+        EbrCacheEntry *entry = &worker->cache[(slot + probe) & (worker->cacheSize - 1)];
+        if (entry->key == key)
+        {
+            worker->cacheHits++;
+            return entry->pbIndex; // Found, no search needed
+        }
+        if (entry->key == EBR_CACHE_EMPTY)
+        { // Not in the cache, search for it and keep the result while there is room
+            int pbIndex = ebrNearest(worker->job, lane, worker->distances);
+            if (worker->cacheUsed < worker->cacheSize / 2)
+            {
+                entry->key = key;
+                entry->pbIndex = pbIndex;
+                worker->cacheUsed++;
             }
-            randGenerated++; // increment the number of random numbers generated and added to the random series
+            return pbIndex;
         }
     }
-    free(randomSeries); // free the random series array as it is no longer needed
-    return paradigmBlock;
+    return ebrNearest(worker->job, lane, worker->distances); // Every entry it could go in is taken
 }
 
 /**
- * This function finds the best paradigm block for a given image block
+ * This function is run by every thread of the paradigm search.
+ *
+ * The threads share one counter of the rows of blocks that are left. Each thread takes the next
+ * EBR_TASK_ROWS rows whenever it is free, so a thread stuck on slow rows never holds up the others.
+ * Every block is written to its own place in the compressed image, so the result does not depend
+ * on which thread handled which rows.
  *
- * @param imageBlock The image block to find the best paradigm block for
+ * @param argument The EbrWorker of the thread
+ * @return NULL
+ */
+static void *ebrMatchWorker(void *argument)
+{
+    EbrWorker *worker = (EbrWorker *)argument;
+    EbrMatchJob *job = worker->job;
+    int width = job->compressedImage->width; // The number of blocks in a row
+    for (;;)
+    {
+        pthread_mutex_lock(&job->lock);
+        int firstRow = job->nextRow; // The first row of this task
+        job->nextRow += EBR_TASK_ROWS;
+        pthread_mutex_unlock(&job->lock);
+        if (firstRow >= job->rowAmount)
+        {
+            break; // Every row has been taken
+        }
+
+        long firstBlock = (long)firstRow * width;                   // The first block of this task
+        long lastBlock = (long)(firstRow + EBR_TASK_ROWS) * width; // One past the last block of this task
+        if (lastBlock > job->imageBlockAmount)
+        {
+            lastBlock = job->imageBlockAmount;
+        }
+        for (long currentBlockIndex = firstBlock; currentBlockIndex < lastBlock; currentBlockIndex++)
+        { // loop through the image blocks of the task
+            int compressedImageY = (int)(currentBlockIndex / width); // Calculate the y coordinate of the compressed image to store the found paradigm block index
+            int compressedImageX = (int)(currentBlockIndex % width); // Calculate the x coordinate of the compressed image to store the found paradigm block index
+            unsigned char lane[EBR_LANE_SIZE];                      // The image block as a lane
+            ebrLoadLane(&job->imageBlock[currentBlockIndex], lane);
+            job->compressedImage->indices[compressedImageY][compressedImageX] = (EbIndex)ebrNearestCached(worker, lane);
+        }
+        if (job->writer != NULL)
+        { // Let the writing thread know the rows are there
+            pthread_mutex_lock(&job->lock);
+            job->taskDone[firstRow / EBR_TASK_ROWS] = 1;
+            pthread_cond_signal(&job->taskFinished);
+            pthread_mutex_unlock(&job->lock);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * This function writes the rows of indices of a paradigm search in order, each one as soon as it has been found.
+ *
+ * It is run on a thread of its own next to the search threads. If writing fails no more rows are handed out,
+ * so the search stops early.
+ *
+ * @param argument The search whose rows to write, as an EbrMatchJob
+ * @return NULL, the result is kept in writeCheck
+ */
+static void *ebrWriteWorker(void *argument)
+{
+    EbrMatchJob *job = (EbrMatchJob *)argument;
+    for (int firstRow = 0; firstRow < job->rowAmount && job->writeCheck == SUCCESS; firstRow += EBR_TASK_ROWS)
+    { // Write the rows task by task, in the order they are in the image
+        pthread_mutex_lock(&job->lock);
+        while (!job->taskDone[firstRow / EBR_TASK_ROWS])
+        {
+            pthread_cond_wait(&job->taskFinished, &job->lock);
+        }
+        pthread_mutex_unlock(&job->lock);
+        for (int row = firstRow; row < firstRow + EBR_TASK_ROWS && row < job->rowAmount && job->writeCheck == SUCCESS; row++)
+        {
+            job->writeCheck = ebcWriteIndexRow(job->writer, job->compressedImage->indices[row]);
+        }
+    }
+    if (job->writeCheck != SUCCESS)
+    { // Nobody needs the rest of the rows
+        pthread_mutex_lock(&job->lock);
+        job->nextRow = job->rowAmount;
+        pthread_mutex_unlock(&job->lock);
+    }
+    return NULL;
+}
+
+/**
+ * This function orders paradigm blocks by their sums for qsort(), paradigm blocks with equal sums keep their order.
+ *
+ * @param first The first paradigm block, as an EbrSortedParadigm
+ * @param second The second paradigm block, as an EbrSortedParadigm
+ * @return Less than, equal to or more than 0 if the first paradigm block goes before, with or after the second
+ */
+static int ebrCompareParadigmSums(const void *first, const void *second)
+{
+    const EbrSortedParadigm *firstParadigm = (const EbrSortedParadigm *)first;
+    const EbrSortedParadigm *secondParadigm = (const EbrSortedParadigm *)second;
+    if (firstParadigm->sum != secondParadigm->sum)
+    {
+        return firstParadigm->sum < secondParadigm->sum ? -1 : 1;
+    }
+    return firstParadigm->index - secondParadigm->index;
+}
+
+/**
+ * This function finds the best paradigm block for every image block
+ *
+ * The best paradigm block is the one with the lowest sum of absolute differences to the image block,
+ * which is the one with the lowest average difference. If several are equally close the first one wins.
+ * Every block is laid out as a lane of EBR_LANE_SIZE bytes so a whole block is compared in one vector operation.
+ * The rows of blocks are shared out between the threads asked for, the output is the same for any thread count.
+ * With EBR_SEARCH_PRUNED the paradigm blocks are also sorted by their sums so most of them can be skipped.
+ * With EBR_SEARCH_TABLE the row tables are built first, which pays off once there are many image blocks,
+ * unless there are more than EBR_TABLE_MAX_PARADIGMS paradigm blocks, when the full search is used.
+ * With EBR_SEARCH_TREE a vantage point tree is built over the paradigm blocks, which pays off once there are many of them.
+ * Unless the cache is off, every thread remembers what it found so repeated image blocks are only searched for once.
+ * With a writer, one more thread writes every row of indices as soon as it and the rows above it have been found,
+ * so the compressed image is written while the search goes on rather than after it.
+ *
+ * @param imageBlock The array of image blocks
+ * @param imageBlockAmount The number of image blocks
  * @param paradigmBlock The array of paradigm blocks
- * @param paradigmBlockAmount The number of paradigm blocks
+ * @param compressedImage The compressed image, its indices are filled with the index of the best paradigm block of every image block
+ * @param options The number of threads to search with, including the calling thread, and how to search
+ * @param writer The writer to write the rows of indices to, already past the paradigm blocks; NULL to only fill in compressedImage
+ * @return 0 on success; BAD_MALLOC if memory allocation fails; BAD_OUTPUT if the rows cannot be written
  */
-int ebrFindBestParadigmBlock(Block *imageBlock, int imageBlockAmount, Block *paradigmBlock, Image *compressedImage)
-{
-    // Loop through the image and find the best match with the paradigm blocks by calculating the difference each pixel in the block and the paradigm block
-    // and averaging the difference. The paradigm block with the lowest average difference is the best match.
-
-    DiffBlock currentDifference;                                                 // the current difference between the image block and the paradigm block (DiffBlock is a struct like Block but with int data instead of unsigned int data so that negative values can be stored)
-    currentDifference.height = BLOCK_HEIGHT;                                     // set the height of the current difference block
-    currentDifference.width = BLOCK_WIDTH;                                       // set the width of the current difference block
-    currentDifference.data = (int **)ebCreate2DArray(BLOCK_HEIGHT, BLOCK_WIDTH); // allocate memory for the current difference block
-    if (currentDifference.data == NULL)
-    {                      // check if the memory allocation failed
-        return BAD_MALLOC; // return BAD_MALLOC if the memory allocation failed
-    }
-    int bestMatchPBIndex = 0;      // The index of the current lowest average difference paradigm block
-    double avgDifferenceBuff = 0;  // Buffer for the average difference between the image block and the paradigm block
-    double bestAvgDifference = 32; // The current lowest average difference (32 is 1 + maximum average between two blocks)
-
-    for (int currentBlockIndex = 0; currentBlockIndex < imageBlockAmount; currentBlockIndex++)
-    { // loop through the image blocks
-        for (int pbIndex = 0; pbIndex < compressedImage->paradigmBlockAmount; pbIndex++)
-        { // loop through the paradigm blocks
-            for (int blockY = 0; blockY < BLOCK_HEIGHT; blockY++)
-            { // loop through the elements of the current difference block
-                for (int blockX = 0; blockX < BLOCK_WIDTH; blockX++)
-                {
-                    currentDifference.data[blockY][blockX] = abs(((int)imageBlock[currentBlockIndex].data[blockY][blockX]) - ((int)paradigmBlock[pbIndex].data[blockY][blockX])); // calculate the difference between the image block and the paradigm block
-                }
+int ebrFindBestParadigmBlock(Block *imageBlock, int imageBlockAmount, Block *paradigmBlock, Image *compressedImage, const EbrOptions *options, EbcWriter *writer)
+{
+    int threadAmount = options->threadAmount; // The number of threads to search with
+    int search = options->search;             // How to search, the row tables are only built while they are small enough
+    int paradigmBlockAmount = compressedImage->paradigmBlockAmount;                                                    // The number of paradigm blocks
+    if (search == EBR_SEARCH_TABLE && paradigmBlockAmount > EBR_TABLE_MAX_PARADIGMS)
+    { // Every search finds the same blocks, so the full one stands in
+        search = EBR_SEARCH_FULL;
+    }
+    unsigned char (*paradigmLanes)[EBR_LANE_SIZE] = malloc(sizeof(*paradigmLanes) * (size_t)paradigmBlockAmount); // The paradigm blocks as lanes
+    int *distances = (int *)malloc(sizeof(int) * (size_t)paradigmBlockAmount * threadAmount);                       // The distance to every paradigm block, for every thread
+    EbrWorker *worker = (EbrWorker *)malloc(sizeof(EbrWorker) * (size_t)threadAmount);                             // The state of every thread
+    EbrSortedParadigm *sorted = (EbrSortedParadigm *)malloc(sizeof(EbrSortedParadigm) * (size_t)paradigmBlockAmount); // The paradigm blocks sorted by their sums
+    if (paradigmLanes == NULL || distances == NULL || worker == NULL || sorted == NULL)
+    {
+        free(paradigmLanes);
+        free(distances);
+        free(worker);
+        free(sorted);
+        return BAD_MALLOC; // Return if memory allocation failed
+    }
+    for (int pbIndex = 0; pbIndex < paradigmBlockAmount; pbIndex++)
+    {
+        ebrLoadLane(&paradigmBlock[pbIndex], paradigmLanes[pbIndex]);
+        memcpy(sorted[pbIndex].lane, paradigmLanes[pbIndex], EBR_LANE_SIZE);
+        sorted[pbIndex].sum = ebrLaneSum(paradigmLanes[pbIndex]);
+        sorted[pbIndex].index = pbIndex;
+    }
+    if (search == EBR_SEARCH_PRUNED)
+    {
+        qsort(sorted, paradigmBlockAmount, sizeof(EbrSortedParadigm), ebrCompareParadigmSums);
+    }
+    ebrSelectKernels();
+    unsigned char *rowTables = NULL; // The row tables, only built for EBR_SEARCH_TABLE
+    EbrTreeNode *tree = NULL;        // The vantage point tree, only built for EBR_SEARCH_TREE
+    unsigned char (*treeLanes)[EBR_LANE_SIZE] = NULL; // The lanes of the tree nodes in tree order
+    if (search == EBR_SEARCH_TABLE)
+    {
+        rowTables = ebrBuildRowTables((const unsigned char (*)[EBR_LANE_SIZE])paradigmLanes, paradigmBlockAmount);
+        if (rowTables == NULL)
+        {
+            free(paradigmLanes);
+            free(distances);
+            free(worker);
+            free(sorted);
+            return BAD_MALLOC; // Return if memory allocation failed
+        }
+    }
+    if (search == EBR_SEARCH_TREE)
+    {
+        tree = (EbrTreeNode *)malloc(sizeof(EbrTreeNode) * (size_t)paradigmBlockAmount);
+        treeLanes = malloc(sizeof(*treeLanes) * (size_t)paradigmBlockAmount);
+        if (tree == NULL || treeLanes == NULL)
+        {
+            free(tree);
+            free(treeLanes);
+            free(paradigmLanes);
+            free(distances);
+            free(worker);
+            free(sorted);
+            return BAD_MALLOC; // Return if memory allocation failed
+        }
+        for (int pbIndex = 0; pbIndex < paradigmBlockAmount; pbIndex++)
+        {
+            memcpy(tree[pbIndex].lane, paradigmLanes[pbIndex], EBR_LANE_SIZE);
+            tree[pbIndex].index = pbIndex;
+        }
+        ebrBuildTree(tree, 0, paradigmBlockAmount);
+        for (int nodeIndex = 0; nodeIndex < paradigmBlockAmount; nodeIndex++)
+        {
+            memcpy(treeLanes[nodeIndex], tree[nodeIndex].lane, EBR_LANE_SIZE);
+        }
+    }
+
+    EbrMatchJob job; // The search shared by all the threads
+    job.imageBlock = imageBlock;
+    job.imageBlockAmount = imageBlockAmount;
+    job.paradigmLanes = (const unsigned char (*)[EBR_LANE_SIZE])paradigmLanes;
+    job.paradigmBlockAmount = paradigmBlockAmount;
+    job.compressedImage = compressedImage;
+    job.search = search;
+    job.sorted = sorted;
+    job.rowTables = rowTables;
+    job.tree = tree;
+    job.treeLanes = (const unsigned char (*)[EBR_LANE_SIZE])treeLanes;
+    job.nextRow = 0;
+    job.rowAmount = compressedImage->width > 0 ? (imageBlockAmount + compressedImage->width - 1) / compressedImage->width : 0;
+    job.writer = writer;
+    job.taskDone = NULL;
+    job.writeCheck = SUCCESS;
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.taskFinished, NULL);
+    if (writer != NULL)
+    {
+        job.taskDone = (unsigned char *)calloc((size_t)job.rowAmount / EBR_TASK_ROWS + 1, sizeof(unsigned char));
+        if (job.taskDone == NULL)
+        {
+            pthread_cond_destroy(&job.taskFinished);
+            pthread_mutex_destroy(&job.lock);
+            free(paradigmLanes);
+            free(distances);
+            free(worker);
+            free(sorted);
+            free(rowTables);
+            free(tree);
+            free(treeLanes);
+            return BAD_MALLOC; // Return if memory allocation failed
+        }
+    }
+
+    int cacheSize = EBR_CACHE_SIZE; // The entries in the cache of every thread, no more than a small image can fill
+    while (cacheSize > EBR_CACHE_MIN_SIZE && cacheSize / 4 >= imageBlockAmount)
+    {
+        cacheSize /= 2;
+    }
+    int threadsStarted = 0; // The number of extra threads that are running
+    pthread_t writeThread;  // Writes the rows of indices as they are found
+    int writerStarted = 0;  // Whether the writing thread is running
+    for (int threadIndex = 0; threadIndex < threadAmount; threadIndex++)
+    {
+        worker[threadIndex].job = &job;
+        worker[threadIndex].cacheSize = cacheSize;
+        worker[threadIndex].distances = distances + (size_t)threadIndex * paradigmBlockAmount;
+        worker[threadIndex].cache = NULL;
+        worker[threadIndex].cacheUsed = 0;
+        worker[threadIndex].cacheLookups = 0;
+        worker[threadIndex].cacheHits = 0;
+        if (options->cache != EBR_CACHE_OFF)
+        { // Without memory for a cache the thread simply searches for every image block
+            worker[threadIndex].cache = (EbrCacheEntry *)malloc(sizeof(EbrCacheEntry) * (size_t)cacheSize);
+        }
+        if (worker[threadIndex].cache != NULL)
+        {
+            for (int entryIndex = 0; entryIndex < cacheSize; entryIndex++)
+            {
+                worker[threadIndex].cache[entryIndex].key = EBR_CACHE_EMPTY;
+            }
+        }
+    }
+    if (writer != NULL)
+    { // Without a thread of its own the rows are written once they have all been found
+        writerStarted = pthread_create(&writeThread, NULL, ebrWriteWorker, &job) == 0;
+    }
+    for (int threadIndex = 1; threadIndex < threadAmount; threadIndex++)
+    { // The calling thread is worker 0, start the others
+        if (pthread_create(&worker[threadIndex].thread, NULL, ebrMatchWorker, &worker[threadIndex]) != 0)
+        {
+            break; // Carry on with the threads that did start, the rows are shared out all the same
+        }
+        threadsStarted++;
+    }
+    ebrMatchWorker(&worker[0]);
+    for (int threadIndex = 1; threadIndex <= threadsStarted; threadIndex++)
+    {
+        pthread_join(worker[threadIndex].thread, NULL);
+    }
+    if (writerStarted)
+    {
+        pthread_join(writeThread, NULL);
+    }
+    else if (writer != NULL)
+    {
+        ebrWriteWorker(&job);
+    }
+    pthread_cond_destroy(&job.taskFinished);
+    pthread_mutex_destroy(&job.lock);
+
+    long cacheLookups = 0; // The image blocks looked up in the caches of all the threads
+    long cacheHits = 0;    // The image blocks found in the caches of all the threads
+    for (int threadIndex = 0; threadIndex < threadAmount; threadIndex++)
+    {
+        cacheLookups += worker[threadIndex].cacheLookups;
+        cacheHits += worker[threadIndex].cacheHits;
+        free(worker[threadIndex].cache);
+    }
+    if (options->cache == EBR_CACHE_STATS)
+    { // Report on stderr so the output of the program stays the same
+        fprintf(stderr, "Cache: %ld hits of %ld lookups (%.1f%%)\n", cacheHits, cacheLookups, cacheLookups > 0 ? 100.0 * cacheHits / cacheLookups : 0.0);
+    }
+
+    free(paradigmLanes);
+    free(distances);
+    free(worker);
+    free(sorted);
+    free(rowTables);
+    free(tree);
+    free(treeLanes);
+    free(job.taskDone);
+    return job.writeCheck;
+}
+
+/**
+ * This function compresses an ebc file with random paradigm blocks.
+ *
+ * The image, its blocks and the compressed image are kept in the workspace, so compressing file after
+ * file with one workspace only allocates when a file is larger than any before it. Nothing is printed,
+ * so many files can be compressed at the same time.
+ *
+ * @param inputFilename The name of the ebc file to compress
+ * @param outputFilename The name of the file to write
+ * @param seed The seed the paradigm blocks are picked with
+ * @param options How to search and how many paradigm blocks to use, which must suit the magic number
+ * @param magicNumber The magic number to write, MAGIC_NUMBER_EBCR32, MAGIC_NUMBER_EBCR128 or MAGIC_NUMBER_EBCR,
+ * MAGIC_NUMBER_EBCRA is written instead when the options ask for entropy coded indices
+ * @param workspace Where the image, its blocks and the compressed image are kept, and where the files may already be in memory
+ * @param failedFilename Where to store the name of the file to blame when something goes wrong
+ * @return 0 on success; one of the error codes in ebConstants.h on failure
+ */
+int ebrCompress(char *inputFilename, char *outputFilename, int seed, const EbrOptions *options, int magicNumber, EbcWorkspace *workspace, char **failedFilename)
+{
+    *failedFilename = inputFilename;                        // The file to blame if something goes wrong
+    int paradigmBlockAmount = options->paradigmBlockAmount; // The number of paradigm blocks to compress with
+    if (options->entropyCoded)
+    { // Any number of paradigm blocks can be entropy coded, the file records how many
+        magicNumber = MAGIC_NUMBER_EBCRA;
+    }
+
+    // Read the input file
+    Image image;
+    EbcReader reader; // Reads the image, from memory if it is already in the workspace
+    int check = ebcOpenInput(&reader, &image, inputFilename, MAGIC_NUMBER_EBC, workspace);
+    if (check == SUCCESS)
+    {
+        check = ebcReadOpened(&reader, &image, options->threadAmount, &workspace->pixels);
+    }
+    if (check != SUCCESS)
+    {
+        return check;
+    }
+
+    // Uniform Blockerize the image
+    int heightBlockLength = floor((((double)image.height) / BLOCK_HEIGHT)); // The number of blocks in the height
+    int widthBlockLength = floor((((double)image.width) / BLOCK_WIDTH));    // The number of blocks in the width
+    int blockAmount = heightBlockLength * widthBlockLength;                 // How many blocks are needed
+
+    workspace->blocks = blockReuseArena(workspace->blocks, &workspace->blockCapacity, blockAmount); // Make room for the blocks
+    Block *imageBlock = workspace->blocks;
+    if (imageBlock == NULL)
+    { // Check if the memory allocation failed
+        return BAD_MALLOC; // return if memory allocation failed
+    }
+
+    check = uniformBlockerize(&image, imageBlock); // Blockerize the image and store it in the imageBlock array
+    if (check != SUCCESS)
+    { // Check if the blockerization failed
+        return check; // Return the error code
+    }
+
+    // Create the paradigm blocks
+    Block *paradigmBlock = generateParadigmBlocks(imageBlock, blockAmount, paradigmBlockAmount, seed);
+    if (paradigmBlock == NULL)
+    { // Check if the paradigm block generation failed
+        return BAD_PARADIGM_GENERATION; // Return the error code
+    }
+
+    // Create the compressed image struct
+    Image compressedImage;
+    compressedImage.height = heightBlockLength; // Set the height of the compressed image
+    compressedImage.width = widthBlockLength;   // Set the width of the compressed image
+    compressedImage.paradigmBlockAmount = paradigmBlockAmount; // Set the number of paradigm blocks in the compressed image
+
+    compressedImage.indices = ebReuseIndexArray(&workspace->indices, heightBlockLength, widthBlockLength); // Make room for the compressed image
+    compressedImage.paradigm = ebCreate2DArray(BLOCK_HEIGHT, paradigmBlockAmount * BLOCK_WIDTH);            // Allocate the memory for the paradigm blocks
+    if (compressedImage.indices == NULL || compressedImage.paradigm == NULL)
+    { // Check if the memory allocation failed
+        if (compressedImage.paradigm != NULL)
+        {
+            ebFree2DArray(compressedImage.paradigm);
+        }
+        blockFreeArena(paradigmBlock);
+        return BAD_MALLOC; // Return the error code
+    }
+
+    check = unblockerize(compressedImage.paradigm, paradigmBlock, BLOCK_HEIGHT, paradigmBlockAmount * BLOCK_WIDTH); // Put the paradigm blocks into the compressed image struct
+    EbcWriter writer; // Writes the compressed image while the paradigm blocks are being found
+    if (check == SUCCESS)
+    { // Write the header and paradigm blocks before searching
+        check = ebcOpenOutput(&writer, &compressedImage, outputFilename, magicNumber, workspace);
+        if (check != SUCCESS)
+        {
+            *failedFilename = outputFilename; // The compressed image could not be opened
+        }
+        else
+        { // Find the best paradigm block for each block in the image, writing each row of indices as it is found
+            check = ebrFindBestParadigmBlock(imageBlock, blockAmount, paradigmBlock, &compressedImage, options, &writer);
+            int closeCheck = ebcCloseWriter(&writer); // Write out the end of the compressed image
+            if (check == SUCCESS)
+            {
+                check = closeCheck;
             }
-            avgDifferenceBuff = diffBlockAverage(currentDifference); // calculate the average difference between the image block and the paradigm block
-            if (avgDifferenceBuff < bestAvgDifference)
-            {                                          // check if the average difference is lower than the current lowest average difference
-                bestAvgDifference = avgDifferenceBuff; // set the current lowest average difference to the average difference
-                bestMatchPBIndex = pbIndex;            // set the index of the current lowest average difference to the new lowest average difference paradigm block
+            if (check != SUCCESS)
+            {
+                *failedFilename = outputFilename;
+                ebcDiscardOutput(outputFilename, workspace); // Do not leave a partial compressed image behind
             }
         }
-        int compressedImageY = floor(currentBlockIndex / compressedImage->width);     // Calculate the y coordinate of the compressed image to store the found paradigm block index
-        int compressedImageX = currentBlockIndex % compressedImage->width;            // Calculate the x coordinate of the compressed image to store the found paradigm block index
-        compressedImage->data[compressedImageY][compressedImageX] = bestMatchPBIndex; // Set the value of the compressed image data to the index of the best match paradigm block
-        bestAvgDifference = 32;                                                       // Reset the best average difference
     }
 
-    ebFree2DArray((unsigned int **)currentDifference.data); // free the current difference block data
+    // Free the memory that is not kept in the workspace
+    blockFreeArena(paradigmBlock);           // Free the memory for the paradigm blocks
+    ebFree2DArray(compressedImage.paradigm); // Free the memory for the paradigm blocks in the compressed image
+    return check;
+}
+
+/**
+ * This function compresses an ebc file with random paradigm blocks, the whole of an ebcR program.
+ *
+ * Prints COMPRESSED on success or the error message on failure.
+ *
+ * @param inputFilename The name of the ebc file to compress
+ * @param outputFilename The name of the file to write
+ * @param seed The seed the paradigm blocks are picked with
+ * @param options How to search and how many paradigm blocks to use, which must suit the magic number
+ * @param magicNumber The magic number to write, MAGIC_NUMBER_EBCR32, MAGIC_NUMBER_EBCR128 or MAGIC_NUMBER_EBCR
+ * @return 0 on success; one of the error codes in ebConstants.h on failure
+ */
+int ebrCompressFile(char *inputFilename, char *outputFilename, int seed, const EbrOptions *options, int magicNumber)
+{
+    ebSetMessageStream(outputFilename); // Keep the messages out of the compressed image when it goes to stdout
+    EbcWorkspace workspace;             // The memory for this one file
+    ebcInitWorkspace(&workspace);
+    char *failedFilename = inputFilename; // The file to blame if something goes wrong
+    int check = ebrCompress(inputFilename, outputFilename, seed, options, magicNumber, &workspace, &failedFilename);
+    ebcFreeWorkspace(&workspace);
+    if (check != SUCCESS)
+    {
+        return ebErrorHandle(check, failedFilename); // Print the error message
+    }
+
+    fprintf(ebMessageStream(), "COMPRESSED\n"); // If we got here, the compression was successful
     return SUCCESS;
 }
 
 /**
- * This function matches an ebrImage data to the correct paradigm block
+ * This function finds the largest paradigm block index of a compressed image.
  *
- * @param ebrImage The image to match
- * @param paradigmBlocks The array of paradigm blocks
- * @param targetImage The image to store the matched data in
+ * The loop has no branch, so the compiler turns it into vector maximums.
+ *
+ * @param indices The indices, one after another
+ * @param indexAmount The number of indices
+ * @return The largest index; 0 if there are none
+ */
+static EbIndex ebrMaxIndex(const EbIndex *indices, long indexAmount)
+{
+    EbIndex maxIndex = 0; // The largest index so far
+    for (long indexPosition = 0; indexPosition < indexAmount; indexPosition++)
+    {
+        maxIndex = indices[indexPosition] > maxIndex ? indices[indexPosition] : maxIndex;
+    }
+    return maxIndex;
+}
+
+/**
+ * This function builds the packed row fragments of the paradigm blocks for decompression.
+ *
+ * A fragment is one row of a paradigm block packed as it is in an ebc file, EBR_FRAGMENT_BITS bits,
+ * so a row of the decompressed image is the fragments of its paradigm blocks one after another.
+ *
+ * @param paradigm The paradigm blocks side by side, as read from the compressed file
  * @param paradigmBlockAmount The number of paradigm blocks
- * @return 0 on success; BAD_DATA if any of the arguments are invalid or invalid data is detected; BAD_MALLOC if a malloc fails
+ * @return The fragments, BLOCK_HEIGHT rows of paradigmBlockAmount each; NULL if memory allocation fails
  */
-int ebrMatch(Image *ebrImage, Block *paradigmBlocks, Image *targetImage, int paradigmBlockAmount)
+static uint32_t *ebrBuildFragments(Pixel **paradigm, int paradigmBlockAmount)
 {
-    // Safety checks
-    if (ebrImage == NULL)
-    {                    // Check if the ebrImage is NULL
-        return BAD_DATA; // Return BAD_DATA if the ebrImage is NULL
+    uint32_t *fragments = (uint32_t *)malloc(sizeof(uint32_t) * BLOCK_HEIGHT * (size_t)paradigmBlockAmount);
+    if (fragments == NULL)
+    {
+        return NULL; // Return if memory allocation failed
     }
-    if (paradigmBlocks == NULL)
-    {                    // Check if the paradigmBlocks is NULL
-        return BAD_DATA; // Return BAD_DATA if the paradigmBlocks is NULL
+    for (int blockY = 0; blockY < BLOCK_HEIGHT; blockY++)
+    {
+        for (int pbIndex = 0; pbIndex < paradigmBlockAmount; pbIndex++)
+        {
+            uint32_t fragment = 0; // The row of the paradigm block, first pixel in the most significant bits
+            for (int blockX = 0; blockX < BLOCK_WIDTH; blockX++)
+            { // Only the 5 bits an ebc file keeps of a pixel are used
+                fragment = (fragment << 5) | (paradigm[blockY][pbIndex * BLOCK_WIDTH + blockX] & MAX_GREY_VALUE);
+            }
+            fragments[blockY * paradigmBlockAmount + pbIndex] = fragment;
+        }
     }
+    return fragments;
+}
 
-    if (paradigmBlockAmount < 1)
-    {                    // Check if the paradigm block amount is less than 1
-        return BAD_DATA; // Return BAD_DATA if the paradigm block amount is less than 1
-    }
-
-    // Check if all the paradigm blocks are the same size
-    for (int i = 0; i < paradigmBlockAmount; i++)
-    { // Loop through the paradigm blocks
-        if (paradigmBlocks[i].height != paradigmBlocks[0].height || paradigmBlocks[i].width != paradigmBlocks[0].width)
-        {                    // Check if the current paradigm block is the same size as the first paradigm block
-            return BAD_DATA; // Return BAD_DATA if the current paradigm block is not the same size as the first paradigm block
-        }
-    }
-    // Allocate memory for the target image
-    targetImage->height = ebrImage->height * paradigmBlocks[0].height;            // Set the height of the target image
-    targetImage->width = ebrImage->width * paradigmBlocks[0].width;               // Set the width of the target image
-    targetImage->data = ebCreate2DArray(targetImage->height, targetImage->width); // Allocate memory for the target image data
-    if (targetImage->data == NULL)
-    {                      // Check if the memory allocation failed
-        return BAD_MALLOC; // Return BAD_MALLOC if the memory allocation failed
-    }
-
-    // Match the image data to the paradigm blocks
-    int buffer = 0; // Buffer for the current paradigm block index
-    for (int imageY = 0; imageY < ebrImage->height; imageY++)
-    { // Loop through the image
-        for (int imageX = 0; imageX < ebrImage->width; imageX++)
-        {
-            for (int blockY = 0; blockY < paradigmBlocks[0].height; blockY++)
-            { // Loop through the size of the paradigm blocks
-                for (int blockX = 0; blockX < paradigmBlocks[0].width; blockX++)
-                {
-                    buffer = paradigmBlocks[ebrImage->data[imageY][imageX]].data[blockY][blockX]; // Get the current paradigm block data
-                    if (buffer > paradigmBlockAmount || buffer < 0)
-                    {                    // Check if the current paradigm block index is valid
-                        return BAD_DATA; // Return BAD_DATA if the current paradigm block index is invalid
-                    }
-                    targetImage->data[imageY * paradigmBlocks[0].height + blockY][imageX * paradigmBlocks[0].width + blockX] = buffer; // Set the target image data to the current paradigm block data
-                }
-            }
+/**
+ * This function packs a row of a decompressed image from the row fragments of the paradigm blocks, for ebcWritePackedRows().
+ *
+ * Each row of a block is the matching fragment of every paradigm block in the row of the compressed image.
+ *
+ * @param source The fragments and indices, an EbrFragmentRows
+ * @param y The row of the decompressed image, counting from source->firstRow
+ * @param packed Where to store the packed row, with EBC_PACKED_ROW_SLACK bytes to spare
+ */
+static void ebrPackFragmentRow(const void *source, int y, unsigned char *packed)
+{
+    const EbrFragmentRows *rows = (const EbrFragmentRows *)source;
+    int row = rows->firstRow + y; // The row counting from the top of the image
+    bpuPackGathered(rows->fragments + (size_t)(row % BLOCK_HEIGHT) * rows->paradigmBlockAmount, rows->indices[row / BLOCK_HEIGHT], rows->width, EBR_FRAGMENT_BITS, packed);
+}
+
+/**
+ * This function decompresses an R family file.
+ *
+ * The indices are checked once, then every row of the decompressed image is packed straight from the
+ * row fragments of the paradigm blocks. A band of rows at a time is packed in chunks on
+ * workspace->threadAmount threads by ebcWritePackedRows() and written, so the decompressed image is
+ * never held in memory. The indices and the packed rows are kept in the workspace. Nothing is printed.
+ *
+ * @param inputFilename The name of the compressed file
+ * @param outputFilename The name of the ebc file to write
+ * @param magicNumber The magic number the compressed file should have, MAGIC_NUMBER_EBCR32, MAGIC_NUMBER_EBCR128 or MAGIC_NUMBER_EBCR,
+ * or MAGIC_NUMBER_EBCR_FAMILY for whichever of them it is
+ * @param workspace Where the indices and the packed rows are kept, how many threads to pack with, and where the files may already be in memory
+ * @param failedFilename Where to store the name of the file to blame when something goes wrong
+ * @return 0 on success; one of the error codes in ebConstants.h on failure
+ */
+int ebrDecompress(char *inputFilename, char *outputFilename, int magicNumber, EbcWorkspace *workspace, char **failedFilename)
+{
+    *failedFilename = inputFilename; // The file to blame if something goes wrong
+
+    // Read the input file
+    Image image;      // Create a new image to store the compressed data
+    EbcReader reader; // Reads the compressed data, from memory if it is already in the workspace
+    int check = ebcOpenInput(&reader, &image, inputFilename, magicNumber, workspace);
+    if (check == SUCCESS)
+    {
+        check = ebcReadIndicesOpened(&reader, &image, &workspace->indices); // Read the compressed data into the image
+    }
+    if (check != SUCCESS)
+    {                 // Check if the read failed
+        return check; // Return the error if the read failed
+    }
+
+    // Check every index points at a paradigm block
+    int paradigmBlockAmount = image.paradigmBlockAmount; // How many paradigm blocks the file holds
+    if (ebrMaxIndex(image.indices[0], (long)image.height * image.width) >= paradigmBlockAmount)
+    {
+        ebFree2DArray(image.paradigm); // Free the memory for the image paradigm if an index is invalid
+        return BAD_DATA;               // Return the error
+    }
+
+    // Pack the rows of the paradigm blocks
+    Image imageDecompressed;                                // The header of the decompressed image
+    imageDecompressed.height = image.height * BLOCK_HEIGHT; // Every index stands for a whole block
+    imageDecompressed.width = image.width * BLOCK_WIDTH;
+    uint32_t *fragments = ebrBuildFragments(image.paradigm, paradigmBlockAmount); // The packed rows of the paradigm blocks
+    if (fragments == NULL)
+    {
+        free(fragments);
+        ebFree2DArray(image.paradigm); // Free the memory for the image paradigm if malloc failed
+        return BAD_MALLOC;             // Return the error
+    }
+
+    // Write the decompressed image a band of rows at a time
+    EbcWriter writer; // Writes the decompressed image band by band
+    check = ebcOpenOutput(&writer, &imageDecompressed, outputFilename, MAGIC_NUMBER_EBC, workspace);
+    int writerOpen = check == SUCCESS; // Whether the writer has to be closed
+    EbrFragmentRows rows;              // What the rows are packed from
+    rows.fragments = fragments;
+    rows.indices = image.indices;
+    rows.width = image.width;
+    rows.paradigmBlockAmount = paradigmBlockAmount;
+    int bandHeight = ebcPackingBandHeight(imageDecompressed.width, workspace->threadAmount); // The rows in a band
+    for (rows.firstRow = 0; rows.firstRow < imageDecompressed.height && check == SUCCESS; rows.firstRow += bandHeight)
+    {
+        int bandRows = imageDecompressed.height - rows.firstRow; // The last band may be short
+        check = ebcWritePackedRows(&writer, bandRows < bandHeight ? bandRows : bandHeight, ebrPackFragmentRow, &rows, workspace);
+    }
+    if (writerOpen)
+    { // The writer was opened, write out the end of the decompressed image
+        int closeCheck = ebcCloseWriter(&writer);
+        check = check == SUCCESS ? closeCheck : check;
+    }
+    if (check != SUCCESS)
+    { // Only the decompressed image can fail once the compressed data has been read and checked
+        *failedFilename = outputFilename;
+        if (writerOpen)
+        {
+            ebcDiscardOutput(outputFilename, workspace); // Do not leave a partial decompressed image behind
         }
     }
 
+    free(fragments);               // Free the memory for the fragments
+    ebFree2DArray(image.paradigm); // Free the memory for the image paradigm
+    return check;
+}
+
+/**
+ * This function decompresses an R family file, the whole of an ebcU program.
+ *
+ * Prints DECOMPRESSED on success or the error message on failure.
+ *
+ * @param inputFilename The name of the compressed file
+ * @param outputFilename The name of the ebc file to write
+ * @param magicNumber The magic number the compressed file should have, MAGIC_NUMBER_EBCR32, MAGIC_NUMBER_EBCR128 or MAGIC_NUMBER_EBCR,
+ * or MAGIC_NUMBER_EBCR_FAMILY for whichever of them it is
+ * @return 0 on success; one of the error codes in ebConstants.h on failure
+ */
+int ebrDecompressFile(char *inputFilename, char *outputFilename, int magicNumber)
+{
+    ebSetMessageStream(outputFilename); // Keep the messages out of the decompressed image when it goes to stdout
+    EbcWorkspace workspace;             // The memory for this one file
+    ebcInitWorkspace(&workspace);
+    workspace.threadAmount = ebcProcessorAmount(); // Pack the decompressed image on every processor
+    char *failedFilename = inputFilename; // The file to blame if something goes wrong
+    int check = ebrDecompress(inputFilename, outputFilename, magicNumber, &workspace, &failedFilename);
+    ebcFreeWorkspace(&workspace);
+    if (check != SUCCESS)
+    {
+        return ebErrorHandle(check, failedFilename); // Print the error message
+    }
+
+    // If we got here, then the image was decompressed successfully
+    fprintf(ebMessageStream(), "DECOMPRESSED\n"); // Print that the image was decompressed successfully
     return SUCCESS;
 }
\ No newline at end of file
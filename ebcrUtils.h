@@ -2,15 +2,119 @@
 #define EBCR_UTILS_H
 
 #include "ebUniversalUtils.h"
+#include "ebcUtils.h"
 #include "bitTwiddlingUtils.h"
 #include <math.h>
+#include <string.h>
+#include <pthread.h>
+#include <limits.h>
 #include "blockUtils.h"
 
+#define EBR_LANE_SIZE 16    // The bytes a block takes when laid out for the vector distance kernels
+#define EBR_MAX_THREADS EBC_MAX_THREADS // The most threads the paradigm search can be spread over
+#define EBR_TASK_ROWS 4      // The rows of blocks a thread of the paradigm search takes at a time
+#define EBR_SEARCH_FULL 0    // Compare every image block with every paradigm block
+#define EBR_SEARCH_PRUNED 1  // Skip the paradigm blocks whose sums show they cannot be closest
+#define EBR_SEARCH_TABLE 2   // Look the distance of every row up in tables built from the paradigm blocks
+#define EBR_SEARCH_TREE 3    // Walk a vantage point tree built over the paradigm blocks
+#define EBR_ROW_KEYS 32768   // The number of different rows of three 5 bit pixels
+#define EBR_TREE_LEAF 16     // Runs of this many paradigm blocks or fewer are not split further, they are compared one after another
+#define EBR_CACHE_OFF 0      // Search for every image block
+#define EBR_CACHE_ON 1       // Remember the paradigm block found for every different image block
+#define EBR_CACHE_STATS 2    // As EBR_CACHE_ON, and print how often the cache was hit
+#define EBR_CACHE_SIZE 65536 // The number of entries in the cache of every thread, a power of 2
+#define EBR_CACHE_MIN_SIZE 64 // The fewest entries a cache is cut down to for a small image, a power of 2
+#define EBR_CACHE_EMPTY 0xFFFFFFFFFFFFFFFFull // The key of an unused cache entry, no block has it
+#define EBR_KEY_SET_EMPTY 0xFFFFFFFFFFFFFFFFull // The key of an unused slot of the set of kept paradigm blocks, no block has it
+#define EBR_CACHE_PROBES 8   // How many entries past its home a key is looked for
+#define EBR_CACHE_TRIAL 8192 // After this many lookups a thread drops its cache if fewer than 1 in 8 were hits
+#define EBR_RANDOM_STREAM 54ull // The PCG32 stream the paradigm blocks are drawn with
+#define EBR_DEFAULT_PARADIGMS 128 // The number of paradigm blocks ebcR uses without --paradigms
+#define EBR_FRAGMENT_BITS (BLOCK_WIDTH * 5) // The bits a row of a block takes in an ebc file
+#define EBR_TABLE_MAX_PARADIGMS 256 // Beyond this many paradigm blocks the row tables would not fit in memory, the full search is used instead
+
+typedef struct ebrOptions{
+    int threadAmount; // The number of threads the paradigm search runs on
+    int search;       // How the closest paradigm block is found, one of the EBR_SEARCH constants
+    int cache;        // Whether repeated image blocks skip the search, one of the EBR_CACHE constants
+    int paradigmBlockAmount; // The number of paradigm blocks to compress with
+    int entropyCoded; // Whether the indices are entropy coded into an EA file rather than packed
+} EbrOptions;
+
+typedef struct ebrRandom{
+    uint64_t state;     // The state of the PCG32 generator
+    uint64_t increment; // The stream of the generator, always odd
+} EbrRandom;
+
+typedef struct ebrCacheEntry{
+    unsigned long long key; // The image block, its 9 pixels packed 5 bits each; EBR_CACHE_EMPTY if unused
+    int pbIndex;            // The index of the closest paradigm block to the image block
+} EbrCacheEntry;
+
+typedef struct ebrSortedParadigm{
+    unsigned char lane[EBR_LANE_SIZE]; // The paradigm block, as a lane
+    int sum;                           // The sum of the pixels of the paradigm block
+    int index;                         // The index of the paradigm block in the file
+} EbrSortedParadigm;
+
+typedef struct ebrTreeNode{
+    unsigned char lane[EBR_LANE_SIZE]; // The vantage point, a paradigm block as a lane
+    int index;                         // The index of the paradigm block in the file
+    int split;                         // Where the outer children start, the inner children lie between this node and split
+    int end;                           // One past the last node under this one
+    int innerMax;                      // The largest distance from the vantage point to an inner child
+    int outerMin;                      // The smallest distance from the vantage point to an outer child
+    int distance;                      // The distance to the vantage point above, only used while building
+} EbrTreeNode;
+
+typedef struct ebrMatchJob{
+    Block *imageBlock;                                  // The image blocks to match
+    int imageBlockAmount;                               // The number of image blocks
+    const unsigned char (*paradigmLanes)[EBR_LANE_SIZE]; // The paradigm blocks, one lane each
+    int paradigmBlockAmount;                            // The number of paradigm blocks
+    Image *compressedImage;                             // Where the index of the best paradigm block of every image block goes
+    int search;                                         // How the closest paradigm block is found
+    const EbrSortedParadigm *sorted;                    // The paradigm blocks sorted by their sums, for EBR_SEARCH_PRUNED
+    const unsigned char *rowTables;                     // The distance from every possible row to every paradigm block, for EBR_SEARCH_TABLE
+    const EbrTreeNode *tree;                            // The vantage point tree over the paradigm blocks, for EBR_SEARCH_TREE
+    const unsigned char (*treeLanes)[EBR_LANE_SIZE];    // The lanes of the tree nodes side by side, in tree order
+    int nextRow;                                        // The first row of blocks no thread has taken yet
+    int rowAmount;                                      // The number of rows of blocks
+    pthread_mutex_t lock;                               // Guards nextRow and taskDone
+    EbcWriter *writer;                                  // Where the rows of indices are written as soon as they are found, NULL to only fill in compressedImage
+    unsigned char *taskDone;                            // Whether the rows of every task have been found, only kept with a writer
+    int writeCheck;                                     // The result of writing the rows of indices
+    pthread_cond_t taskFinished;                        // Signalled whenever a task is finished, only used with a writer
+} EbrMatchJob;
+
+typedef struct ebrWorker{
+    pthread_t thread;  // The thread, unused for the calling thread
+    EbrMatchJob *job;  // The search the thread works on
+    int *distances;    // Scratch space for the distance to every paradigm block
+    EbrCacheEntry *cache; // The paradigm blocks found for the image blocks seen so far, NULL when the cache is off
+    int cacheSize;     // The number of entries in the cache, a power of 2
+    int cacheUsed;     // The number of cache entries in use
+    long cacheLookups; // The number of image blocks looked up in the cache
+    long cacheHits;    // The number of image blocks found in the cache
+} EbrWorker;
+
+typedef struct ebrFragmentRows{
+    const uint32_t *fragments; // The packed rows of the paradigm blocks, from ebrBuildFragments()
+    EbIndex **indices;         // The paradigm block indices of the compressed image
+    int width;                 // The width of the compressed image
+    int paradigmBlockAmount;   // The number of paradigm blocks
+    int firstRow;              // The row of the decompressed image the band being packed starts at
+} EbrFragmentRows;
+
 // function prototypes
 int randSeries(int * randomSeries, int seed, int n, int min, int max);
-int ebrCheckArgs(int argc, char * scriptName);
+int ebrCheckArgs(int argc, char ** argv, char * scriptName, int fixedParadigmAmount, EbrOptions * options);
+int ebrParseOptions(int argc, char ** argv, int firstOption, int fixedParadigmAmount, EbrOptions * options);
+int ebrCompress(char * inputFilename, char * outputFilename, int seed, const EbrOptions * options, int magicNumber, EbcWorkspace * workspace, char ** failedFilename);
+int ebrCompressFile(char * inputFilename, char * outputFilename, int seed, const EbrOptions * options, int magicNumber);
+int ebrDecompress(char * inputFilename, char * outputFilename, int magicNumber, EbcWorkspace * workspace, char ** failedFilename);
+int ebrDecompressFile(char * inputFilename, char * outputFilename, int magicNumber);
 Block * generateParadigmBlocks(Block * imageBlock, int imageBlockAmount, int paradigmBlockAmount, int seed);
-int ebrMatch(Image * ebrImage, Block * paradigmBlocks, Image * targetImage, int paradigmBlockAmount);
-int ebrFindBestParadigmBlock(Block * imageBlock, int imageBlockAmount, Block * paradigmBlock, Image * compressedImage);
+int ebrFindBestParadigmBlock(Block * imageBlock, int imageBlockAmount, Block * paradigmBlock, Image * compressedImage, const EbrOptions * options, EbcWriter * writer);
 
 #endif
\ No newline at end of file
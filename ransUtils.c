@@ -0,0 +1,368 @@
+#include "ransUtils.h"
+
+/**
+ * This function works out the most bytes ransEncode() can make.
+ *
+ * Every symbol makes at most one 16 bit word, on top of the frequency table and the final states.
+ *
+ * @param symbolAmount The number of different symbols there can be
+ * @param symbolCount The number of symbols coded
+ * @return The most bytes the coded symbols can take
+ */
+long ransMaxCodedSize(int symbolAmount, long symbolCount)
+{
+    return 1 + 3 * (long)symbolAmount + 4 * RANS_LANES + 2 * symbolCount;
+}
+
+/**
+ * This function scales how often every symbol appears so the frequencies add up to a power of 2.
+ *
+ * Every symbol that appears keeps a frequency of at least 1, and what rounding down leaves over goes to
+ * the most common symbol.
+ *
+ * @param counts How often every symbol appears
+ * @param symbolAmount The number of different symbols there can be
+ * @param symbolCount The number of symbols, the sum of counts
+ * @param scaleBits The number of bits the frequencies add up to
+ * @param freqs Where to store the frequency of every symbol
+ */
+static void ransScaleCounts(const long *counts, int symbolAmount, long symbolCount, int scaleBits, uint32_t *freqs)
+{
+    int usedAmount = 0;  // The number of symbols that appear
+    int mostCommon = 0;  // The symbol that appears most often
+    for (int symbol = 0; symbol < symbolAmount; symbol++)
+    {
+        usedAmount += counts[symbol] > 0;
+        if (counts[symbol] > counts[mostCommon])
+        {
+            mostCommon = symbol;
+        }
+    }
+
+    uint32_t total = 1u << scaleBits; // What the frequencies have to add up to
+    uint32_t spare = total - (uint32_t)usedAmount; // What is left after every symbol that appears gets 1
+    uint32_t sum = 0;
+    for (int symbol = 0; symbol < symbolAmount; symbol++)
+    { // Round down, so the sum never goes over
+        freqs[symbol] = counts[symbol] > 0 ? 1 + (uint32_t)((unsigned long long)counts[symbol] * spare / (unsigned long long)symbolCount) : 0;
+        sum += freqs[symbol];
+    }
+    freqs[mostCommon] += total - sum; // Give the rest to the most common symbol, or all of it when there are no symbols
+}
+
+/**
+ * This function codes symbols with an interleaved rANS coder and a frequency table made for them.
+ *
+ * The coded bytes are the number of bits the frequencies add up to, the frequency of every symbol as a
+ * little endian base 128 number, the final state of every lane as 32 bit little endian numbers, then the
+ * 16 bit little endian words of the stream in the order the decoder takes them. The symbols are coded back
+ * to front so they can be decoded front to back.
+ *
+ * The frequencies add up to RANS_MIN_SCALE_BITS bits unless more symbols appear than that leaves
+ * headroom for, which keeps the table of the decoder small for all but the largest sets of paradigm blocks.
+ *
+ * @param symbols The symbols to code, each less than symbolAmount
+ * @param symbolCount The number of symbols
+ * @param symbolAmount The number of different symbols there can be, at most 4096
+ * @param coded Where to store the coded bytes, which the caller frees
+ * @param codedSize Where to store the number of coded bytes
+ * @return 0 on success; BAD_MALLOC if memory allocation fails
+ */
+int ransEncode(const EbIndex *symbols, long symbolCount, int symbolAmount, unsigned char **coded, long *codedSize)
+{
+    long *counts = (long *)calloc((size_t)symbolAmount, sizeof(long));        // How often every symbol appears
+    uint32_t *freqs = (uint32_t *)calloc((size_t)symbolAmount, sizeof(uint32_t));     // The scaled frequency of every symbol
+    uint32_t *starts = (uint32_t *)malloc(sizeof(uint32_t) * (size_t)symbolAmount); // Where the slots of every symbol start
+    long maxSize = ransMaxCodedSize(symbolAmount, symbolCount);
+    unsigned char *bytes = (unsigned char *)malloc((size_t)maxSize);
+    if (counts == NULL || freqs == NULL || starts == NULL || bytes == NULL)
+    {
+        free(counts);
+        free(freqs);
+        free(starts);
+        free(bytes);
+        return BAD_MALLOC;
+    }
+
+    // Make the frequency table and write it
+    for (long index = 0; index < symbolCount; index++)
+    {
+        counts[symbols[index]]++;
+    }
+    long usedAmount = 0; // The number of symbols that appear
+    for (int symbol = 0; symbol < symbolAmount; symbol++)
+    {
+        usedAmount += counts[symbol] > 0;
+    }
+    int scaleBits = RANS_MIN_SCALE_BITS; // Enough bits that even a rare symbol costs little more than it should
+    while (scaleBits < RANS_MAX_SCALE_BITS && (1l << scaleBits) < RANS_HEADROOM * usedAmount)
+    {
+        scaleBits++;
+    }
+    ransScaleCounts(counts, symbolAmount, symbolCount, scaleBits, freqs);
+    long tableSize = 0; // The bytes the table takes
+    bytes[tableSize++] = (unsigned char)scaleBits;
+    uint32_t start = 0;
+    for (int symbol = 0; symbol < symbolAmount; symbol++)
+    {
+        starts[symbol] = start;
+        start += freqs[symbol];
+        uint32_t value = freqs[symbol];
+        do
+        { // 7 bits at a time, the top bit says more follow
+            bytes[tableSize++] = (unsigned char)((value & 0x7F) | (value > 0x7F ? 0x80 : 0));
+            value >>= 7;
+        } while (value > 0);
+    }
+
+    // Code the symbols back to front, putting the words at the end of the bytes
+    uint32_t state[RANS_LANES];
+    for (int lane = 0; lane < RANS_LANES; lane++)
+    {
+        state[lane] = RANS_LOW;
+    }
+    unsigned char *word = bytes + maxSize; // The last word written
+    for (long index = symbolCount - 1; index >= 0; index--)
+    {
+        uint32_t *x = &state[index % RANS_LANES];
+        uint32_t freq = freqs[symbols[index]];
+        unsigned long long limit = ((unsigned long long)(RANS_LOW >> scaleBits) << 16) * freq; // The state has to be below this to take the symbol
+        if (*x >= limit)
+        { // Move the low 16 bits out to the stream
+            word -= 2;
+            word[0] = (unsigned char)*x;
+            word[1] = (unsigned char)(*x >> 8);
+            *x >>= 16;
+        }
+        *x = ((*x / freq) << scaleBits) + (*x % freq) + starts[symbols[index]];
+    }
+    for (int lane = RANS_LANES - 1; lane >= 0; lane--)
+    { // The decoder starts from the final states
+        word -= 4;
+        for (int byteIndex = 0; byteIndex < 4; byteIndex++)
+        {
+            word[byteIndex] = (unsigned char)(state[lane] >> (8 * byteIndex));
+        }
+    }
+
+    // Put the stream straight after the table
+    long streamSize = (long)(bytes + maxSize - word);
+    memmove(bytes + tableSize, word, (size_t)streamSize);
+    free(counts);
+    free(freqs);
+    free(starts);
+    *coded = bytes;
+    *codedSize = tableSize + streamSize;
+    return SUCCESS;
+}
+
+/**
+ * This function reads the frequency table of symbols coded by ransEncode() and gets ready to decode them.
+ *
+ * @param decoder The decoder to open
+ * @param coded The coded bytes, which have to stay until the decoder is closed
+ * @param codedSize The number of coded bytes
+ * @param symbolAmount The number of different symbols there can be
+ * @return 0 on success; BAD_DATA if the table or the final states are not valid; BAD_MALLOC if memory allocation fails
+ */
+int ransOpenDecoder(RansDecoder *decoder, const unsigned char *coded, long codedSize, int symbolAmount)
+{
+    decoder->slots = NULL;
+    decoder->lane = 0;
+    decoder->next = NULL; // Nothing to decode until the table has been read
+    decoder->end = NULL;
+    memset(decoder->state, 0, sizeof(decoder->state));
+    long position = 0; // How far through the coded bytes the table has been read
+    if (codedSize < 1 || coded[0] < RANS_MIN_SCALE_BITS || coded[0] > RANS_MAX_SCALE_BITS)
+    {
+        return BAD_DATA;
+    }
+    decoder->scaleBits = coded[position++];
+    uint32_t total = 1u << decoder->scaleBits; // What the frequencies have to add up to
+    decoder->slots = (RansSlot *)malloc(sizeof(RansSlot) * (size_t)total);
+    if (decoder->slots == NULL)
+    {
+        return BAD_MALLOC;
+    }
+
+    // Read the frequencies, giving every symbol its run of slots
+    uint32_t start = 0; // The first slot of the next symbol
+    for (int symbol = 0; symbol < symbolAmount; symbol++)
+    {
+        uint32_t freq = 0;
+        for (int shift = 0;; shift += 7)
+        {
+            if (position >= codedSize || shift > 14)
+            { // The table ends early or a frequency is too big to be one
+                ransCloseDecoder(decoder);
+                return BAD_DATA;
+            }
+            freq |= (uint32_t)(coded[position] & 0x7F) << shift;
+            if (!(coded[position++] & 0x80))
+            {
+                break;
+            }
+        }
+        if (freq > total - start)
+        { // The frequencies add up to too much
+            ransCloseDecoder(decoder);
+            return BAD_DATA;
+        }
+        for (uint32_t offset = 0; offset < freq; offset++)
+        {
+            decoder->slots[start + offset].symbol = (uint16_t)symbol;
+            decoder->slots[start + offset].freq = (uint16_t)freq;
+            decoder->slots[start + offset].offset = (uint16_t)offset;
+            decoder->slots[start + offset].unused = 0;
+        }
+        start += freq;
+    }
+
+    // Read the final states of the encoder
+    if (start != total || codedSize - position < 4 * RANS_LANES || (codedSize - position) % 2 != 0)
+    { // Every slot has to belong to a symbol, and the stream is whole words
+        ransCloseDecoder(decoder);
+        return BAD_DATA;
+    }
+    for (int lane = 0; lane < RANS_LANES; lane++)
+    {
+        decoder->state[lane] = 0;
+        for (int byteIndex = 0; byteIndex < 4; byteIndex++)
+        {
+            decoder->state[lane] |= (uint32_t)coded[position++] << (8 * byteIndex);
+        }
+        if (decoder->state[lane] < RANS_LOW)
+        { // A state never drops that low
+            ransCloseDecoder(decoder);
+            return BAD_DATA;
+        }
+    }
+    decoder->next = coded + position;
+    decoder->end = coded + codedSize;
+    return SUCCESS;
+}
+
+/**
+ * This function decodes one symbol with one lane of the decoder.
+ *
+ * @param state The state of the lane
+ * @param slots The slots of the decoder
+ * @param scaleBits The number of bits the frequencies add up to
+ * @param next The next word of the stream, moved past the word if one is taken
+ * @param end One past the last word of the stream
+ * @param store Where to store the symbol
+ * @return 0 on success; BAD_DATA if the stream runs out
+ */
+static inline int ransStep(uint32_t *state, const RansSlot *slots, int scaleBits, const unsigned char **next, const unsigned char *end, EbIndex *store)
+{
+    uint32_t x = *state;
+    const RansSlot *slot = &slots[x & ((1u << scaleBits) - 1)]; // The low bits pick the slot
+    x = slot->freq * (x >> scaleBits) + slot->offset;
+    if (x < RANS_LOW)
+    { // Take the next 16 bits from the stream
+        if (*next >= end)
+        {
+            return BAD_DATA;
+        }
+        x = (x << 16) | (uint32_t)(*next)[0] | ((uint32_t)(*next)[1] << 8);
+        *next += 2;
+    }
+    *state = x;
+    *store = slot->symbol;
+    return SUCCESS;
+}
+
+/**
+ * This function decodes one symbol with one lane of the decoder, without checking for the end of the stream.
+ *
+ * A lane takes at most one word per symbol, so this is safe while a word is left for every lane that steps.
+ *
+ * @param state The state of the lane
+ * @param slots The slots of the decoder
+ * @param scaleBits The number of bits the frequencies add up to
+ * @param next The next word of the stream, moved past the word if one is taken
+ * @param store Where to store the symbol
+ */
+static inline void ransStepUnchecked(uint32_t *state, const RansSlot *slots, int scaleBits, const unsigned char **next, EbIndex *store)
+{
+    uint32_t x = *state;
+    const RansSlot *slot = &slots[x & ((1u << scaleBits) - 1)]; // The low bits pick the slot
+    x = slot->freq * (x >> scaleBits) + slot->offset;
+    if (x < RANS_LOW)
+    { // Take the next 16 bits from the stream
+        x = (x << 16) | (uint32_t)(*next)[0] | ((uint32_t)(*next)[1] << 8);
+        *next += 2;
+    }
+    *state = x;
+    *store = slot->symbol;
+}
+
+/**
+ * This function decodes the next symbols.
+ *
+ * Symbols can be decoded a few at a time, the decoder carries on where it left off.
+ *
+ * @param decoder The decoder, opened with ransOpenDecoder()
+ * @param store Where to store the symbols
+ * @param count The number of symbols to decode
+ * @return 0 on success; BAD_DATA if the stream runs out
+ */
+int ransDecode(RansDecoder *decoder, EbIndex *store, long count)
+{
+    const RansSlot *slots = decoder->slots;
+    int scaleBits = decoder->scaleBits;
+    const unsigned char *next = decoder->next;
+    const unsigned char *end = decoder->end;
+    uint32_t state[RANS_LANES]; // Kept in registers while decoding
+    memcpy(state, decoder->state, sizeof(state));
+    int check = SUCCESS;
+    long index = 0;
+    for (; index < count && decoder->lane != 0 && check == SUCCESS; index++)
+    { // Decode one at a time until the first lane is next
+        check = ransStep(&state[decoder->lane], slots, scaleBits, &next, end, &store[index]);
+        decoder->lane = (decoder->lane + 1) % RANS_LANES;
+    }
+    for (; index + RANS_LANES <= count && check == SUCCESS && end - next >= 2 * RANS_LANES; index += RANS_LANES)
+    { // While there is a word for every lane the stream cannot run out, so it is not checked
+        ransStepUnchecked(&state[0], slots, scaleBits, &next, &store[index]);
+        ransStepUnchecked(&state[1], slots, scaleBits, &next, &store[index + 1]);
+        ransStepUnchecked(&state[2], slots, scaleBits, &next, &store[index + 2]);
+        ransStepUnchecked(&state[3], slots, scaleBits, &next, &store[index + 3]);
+    }
+    for (; index + RANS_LANES <= count && check == SUCCESS; index += RANS_LANES)
+    { // Decode a symbol with every lane near the end of the stream, the lanes do not wait on each other
+        check = ransStep(&state[0], slots, scaleBits, &next, end, &store[index]) |
+                ransStep(&state[1], slots, scaleBits, &next, end, &store[index + 1]) |
+                ransStep(&state[2], slots, scaleBits, &next, end, &store[index + 2]) |
+                ransStep(&state[3], slots, scaleBits, &next, end, &store[index + 3]);
+    }
+    for (; index < count && check == SUCCESS; index++)
+    { // Decode what is left of the symbols
+        check = ransStep(&state[decoder->lane], slots, scaleBits, &next, end, &store[index]);
+        decoder->lane = (decoder->lane + 1) % RANS_LANES;
+    }
+    memcpy(decoder->state, state, sizeof(state));
+    decoder->next = next;
+    return check != SUCCESS ? BAD_DATA : SUCCESS;
+}
+
+/**
+ * This function closes a decoder, checking that it decoded exactly what was coded.
+ *
+ * @param decoder The decoder to close
+ * @return 0 if every lane is back where the encoder started and the stream is used up; BAD_DATA otherwise
+ */
+int ransCloseDecoder(RansDecoder *decoder)
+{
+    int check = decoder->next == decoder->end ? SUCCESS : BAD_DATA;
+    for (int lane = 0; lane < RANS_LANES; lane++)
+    {
+        if (decoder->state[lane] != RANS_LOW)
+        {
+            check = BAD_DATA;
+        }
+    }
+    free(decoder->slots);
+    decoder->slots = NULL;
+    return check;
+}
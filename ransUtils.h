@@ -0,0 +1,36 @@
+#ifndef RANSUTILS_H
+#define RANSUTILS_H
+
+#include "ebUniversalUtils.h"
+#include <string.h>
+
+#define RANS_LANES 4              // The number of interleaved coder states, symbol i is coded by state i % RANS_LANES
+#define RANS_LOW (1u << 16)       // The smallest a coder state can be between symbols, states stay below 2^32
+#define RANS_MIN_SCALE_BITS 12    // The fewest bits the frequencies of a table add up to
+#define RANS_MAX_SCALE_BITS 15    // The most bits the frequencies of a table add up to, so every frequency fits in 16 bits
+#define RANS_HEADROOM 16          // The frequencies add up to at least this many times the number of symbols that appear, to keep rare symbols cheap
+
+typedef struct ransSlot{
+    uint16_t symbol; // The symbol the slot decodes to
+    uint16_t freq;   // The frequency of the symbol
+    uint16_t offset; // How far the slot is past the first slot of the symbol
+    uint16_t unused; // Pads the slot to 8 bytes
+} RansSlot;
+
+typedef struct ransDecoder{
+    RansSlot *slots;                // One slot for every value the low scaleBits bits of a state can have
+    int scaleBits;                  // The number of bits the frequencies add up to
+    uint32_t state[RANS_LANES];     // The interleaved coder states
+    int lane;                       // The state that decodes the next symbol
+    const unsigned char *next;      // The next 16 bit word of the stream
+    const unsigned char *end;       // One past the last word of the stream
+} RansDecoder;
+
+// function prototypes
+long ransMaxCodedSize(int symbolAmount, long symbolCount);
+int ransEncode(const EbIndex *symbols, long symbolCount, int symbolAmount, unsigned char **coded, long *codedSize);
+int ransOpenDecoder(RansDecoder *decoder, const unsigned char *coded, long codedSize, int symbolAmount);
+int ransDecode(RansDecoder *decoder, EbIndex *store, long count);
+int ransCloseDecoder(RansDecoder *decoder);
+
+#endif